@@ -0,0 +1,349 @@
+#include "binlog.h"
+#include "pico/stdlib.h"
+#include "crc.h"
+#include "diskio.h"
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+// ========================== Auxiliary functions ==========================
+
+// Computes the block CRC over everything but the CRC field itself
+static uint16_t block_crc(const void* data, size_t length) {
+    return crc16((const char*)data, (int)length);
+}
+
+// Stamps the current block with its sequence, tag and CRC
+static void seal_block(binlog_writer* writer) {
+    binlog_block* block = &writer->block;
+    block->header.sequence = writer->sequence;
+    block->header.file_tag = writer->file_tag;
+    block->crc = block_crc(block, offsetof(binlog_block, crc));
+}
+
+// Seals the current block with its CRC, appends it and starts the next one
+static bool emit_block(binlog_writer* writer) {
+    binlog_block* block = &writer->block;
+    seal_block(writer);
+
+    bool ok = sd_logger_write(writer->logger, block, sizeof(*block));
+
+    writer->sequence++;
+    writer->synced_count = 0;
+    memset(block, 0, sizeof(*block));
+    return ok;
+}
+
+// ========================== Recovery ==========================
+
+// State of the scan of an existing log; static, as a FIL and a block would
+// not fit the stack
+typedef struct {
+    FIL file;                   // The log, opened for reading
+    binlog_block block;         // Last block read
+    uint16_t file_tag;          // Tag of the file header
+    uint32_t blocks;            // Whole blocks in the file
+    LBA_t extent_lba;           // Blocks below extent_blocks are read by LBA from here
+    uint32_t extent_blocks;
+    uint32_t reads;             // Blocks read so far
+    bool read_error;            // A read failed: the end found cannot be trusted
+#if FF_USE_FASTSEEK
+    DWORD link_map[BINLOG_RECOVERY_LINK_MAP]; // Cluster runs of the file, for f_lseek
+#endif
+} journal_scan;
+
+// Outcome of the recovery of an existing log
+typedef enum {
+    RECOVER_NO_LOG,             // No file, or an empty one: create the log
+    RECOVER_UNUSABLE,           // The file header is not a log of this format
+    RECOVER_DONE,               // Log found; writer->resumed says whether it reopened
+    RECOVER_ERROR               // The file could not be read; leave it as it is
+} recover_result;
+
+static journal_scan scan;
+
+// Reads block index of the log into scan.block
+static bool read_block(uint32_t index) {
+    bool ok;
+    scan.reads++;
+    if (index < scan.extent_blocks) {
+        // Contiguous: no FAT lookups, however large the file
+        ok = disk_read(scan.file.obj.fs->pdrv, (BYTE*)&scan.block, scan.extent_lba + index, 1) == RES_OK;
+    } else {
+        // With the link map the seek is a table lookup instead of a FAT walk
+        UINT read = 0;
+        ok = f_lseek(&scan.file, (FSIZE_t)index * BINLOG_BLOCK_SIZE) == FR_OK &&
+             f_read(&scan.file, &scan.block, sizeof(scan.block), &read) == FR_OK && read == sizeof(scan.block);
+    }
+    if (!ok) scan.read_error = true;
+    return ok;
+}
+
+// True when block index belongs to the journal
+static bool block_valid(uint32_t index) {
+    if (!read_block(index)) return false;
+    const binlog_block_header* header = &scan.block.header;
+    return scan.block.crc == block_crc(&scan.block, offsetof(binlog_block, crc)) &&
+           header->file_tag == scan.file_tag && header->sequence == index - 1 &&
+           header->record_count > 0 && header->record_count <= BINLOG_RECORDS_PER_BLOCK;
+}
+
+// Index of the last block of the journal (0 = only the header). Blocks are
+// valid up to it and invalid past it, so a binary search takes about
+// log2(blocks) reads; then a few blocks past the end are probed for a hole.
+static uint32_t find_last_block(void) {
+    // Appending with FatFs the file size only covers synced blocks, so the
+    // last one is usually the end
+    if (scan.blocks > 1 && block_valid(scan.blocks - 1)) return scan.blocks - 1;
+
+    uint32_t low = 0;               // Known valid (the header)
+    uint32_t high = scan.blocks;    // Known invalid, or past the end
+    for (;;) {
+        while (high - low > 1) {
+            uint32_t middle = low + (high - low) / 2;
+            if (block_valid(middle)) {
+                low = middle;
+            } else {
+                high = middle;
+            }
+        }
+        uint32_t probe = low + 2;
+        while (probe < scan.blocks && probe <= low + BINLOG_RECOVERY_PROBE_BLOCKS && !block_valid(probe)) {
+            probe++;
+        }
+        if (probe >= scan.blocks || probe > low + BINLOG_RECOVERY_PROBE_BLOCKS) return low;
+        // The journal goes on after the hole
+        low = probe;
+        high = scan.blocks;
+    }
+}
+
+// Looks for an existing log at path. When its header is valid the log is
+// reopened after its last valid block (writer->resumed) and RECOVER_DONE is
+// returned, so the caller never recreates it, even if reopening fails.
+static recover_result recover(binlog_writer* writer, sd_logger* logger, const char* path) {
+    uint64_t start_us = time_us_64();
+    FRESULT fr = f_open(&scan.file, path, FA_READ | FA_OPEN_EXISTING);
+    if (fr == FR_NO_FILE) return RECOVER_NO_LOG;
+    if (fr != FR_OK) {
+        printf("Binary log open failed: %d\n", fr);
+        return RECOVER_ERROR;
+    }
+    if (f_size(&scan.file) == 0) {
+        // Created, but the power went before the header: nothing to keep
+        f_close(&scan.file);
+        return RECOVER_NO_LOG;
+    }
+
+    // File header
+    uint8_t* first = (uint8_t*)&scan.block;
+    binlog_file_header header;
+    uint16_t crc;
+    UINT read = 0;
+    fr = f_read(&scan.file, first, BINLOG_BLOCK_SIZE, &read);
+    if (fr != FR_OK) {
+        printf("Binary log header read failed: %d\n", fr);
+        f_close(&scan.file);
+        return RECOVER_ERROR;
+    }
+    memcpy(&header, first, sizeof(header));
+    memcpy(&crc, &first[BINLOG_BLOCK_SIZE - 2], sizeof(crc));
+    bool valid = read == BINLOG_BLOCK_SIZE && memcmp(header.magic, BINLOG_MAGIC, sizeof(header.magic)) == 0 &&
+                 crc == block_crc(first, BINLOG_BLOCK_SIZE - 2) && header.version == BINLOG_VERSION &&
+                 header.records_per_block == BINLOG_RECORDS_PER_BLOCK;
+    if (!valid) {
+        f_close(&scan.file);
+        return RECOVER_UNUSABLE;
+    }
+
+    scan.file_tag = header.file_tag;
+    scan.blocks = (uint32_t)(f_size(&scan.file) / BINLOG_BLOCK_SIZE);
+    scan.extent_lba = 0;
+    scan.extent_blocks = 0;
+    scan.reads = 0;
+    scan.read_error = false;
+
+    // A preallocated file still starting where its header says is read by LBA;
+    // if it is still the whole extent (not cut to its data by a close), it is
+    // written by LBA again too
+    FATFS* fs = scan.file.obj.fs;
+    LBA_t start = fs->database + (LBA_t)fs->csize * (scan.file.obj.sclust - 2);
+    uint32_t resume_extent = 0;
+    if (header.extent_blocks && header.extent_lba == start) {
+        scan.extent_lba = start;
+        scan.extent_blocks = header.extent_blocks < scan.blocks ? header.extent_blocks : scan.blocks;
+        if (scan.blocks == header.extent_blocks) resume_extent = header.extent_blocks;
+    }
+#if FF_USE_FASTSEEK
+    if (scan.extent_blocks < scan.blocks) {
+        // One walk of the cluster chain here instead of one per block read
+        scan.link_map[0] = BINLOG_RECOVERY_LINK_MAP;
+        scan.file.cltbl = scan.link_map;
+        if (f_lseek(&scan.file, CREATE_LINKMAP) != FR_OK) scan.file.cltbl = NULL; // Too fragmented
+    }
+#endif
+
+    uint32_t last = find_last_block();
+    f_close(&scan.file);
+    if (scan.read_error) {
+        // Resuming before the real end would overwrite logged blocks
+        printf("Binary log read failed during recovery\n");
+        return RECOVER_ERROR;
+    }
+
+    writer->sequence = last;    // Block last + 1 carries sequence last
+    writer->file_tag = header.file_tag;
+    writer->resumed = sd_logger_resume(logger, path, (FSIZE_t)(last + 1) * BINLOG_BLOCK_SIZE, scan.extent_lba,
+                                       resume_extent);
+    writer->recovered_blocks = last;
+    writer->recovery_reads = scan.reads;
+    writer->recovery_us = (uint32_t)(time_us_64() - start_us);
+    return RECOVER_DONE;
+}
+
+// Moves a file that is not a usable log out of the way, so creating the log
+// does not destroy it
+static bool set_aside(const char* path) {
+    char aside[FF_MAX_LFN + 1];
+    for (unsigned n = 0; n < 100; n++) {
+        if (n == 0) {
+            snprintf(aside, sizeof(aside), "%s.bad", path);
+        } else {
+            snprintf(aside, sizeof(aside), "%s.%u.bad", path, n);
+        }
+        FRESULT fr = f_rename(path, aside);
+        if (fr == FR_OK) {
+            printf("%s is not a usable binary log, renamed to %s\n", path, aside);
+            return true;
+        }
+        if (fr != FR_EXIST) {
+            printf("Binary log rename failed: %d\n", fr);
+            return false;
+        }
+    }
+    printf("No free name to set %s aside\n", path);
+    return false;
+}
+
+// ========================== Opening ==========================
+
+bool binlog_open(binlog_writer* writer, sd_logger* logger, const char* path, uint32_t time_ms,
+                 uint32_t extent_bytes) {
+    writer->logger = logger;
+    writer->last_time_ms = time_ms;
+    writer->synced_count = 0;
+    writer->resumed = false;
+    writer->recovered_blocks = 0;
+    writer->recovery_reads = 0;
+    writer->recovery_us = 0;
+    memset(&writer->block, 0, sizeof(writer->block));
+
+    // An existing log is continued, never recreated
+    switch (recover(writer, logger, path)) {
+        case RECOVER_DONE:
+            return writer->resumed;
+        case RECOVER_ERROR:
+            return false;
+        case RECOVER_UNUSABLE:
+            if (!set_aside(path)) return false;
+            break;
+        case RECOVER_NO_LOG:
+            break;
+    }
+
+    bool opened = extent_bytes ? sd_logger_open_extent(logger, path, extent_bytes)
+                               : sd_logger_open(logger, path, true);
+    if (!opened) return false;
+
+    writer->sequence = 0;
+    // Distinguishes blocks of this file from stale sectors of older files
+    writer->file_tag = (uint16_t)(time_us_32() ^ (time_us_32() >> 16));
+
+    // The header fills a whole block so data blocks stay sector aligned
+    uint8_t first[BINLOG_BLOCK_SIZE] = {0};
+    binlog_file_header header = {
+        .magic = BINLOG_MAGIC,
+        .version = BINLOG_VERSION,
+        .block_size = BINLOG_BLOCK_SIZE,
+        .record_size = sizeof(binlog_record),
+        .records_per_block = BINLOG_RECORDS_PER_BLOCK,
+        .file_tag = writer->file_tag,
+        .start_time_ms = time_ms,
+        .extent_lba = logger->extent_sectors ? logger->extent_lba : 0,
+        .extent_blocks = logger->extent_sectors,
+    };
+    memcpy(first, &header, sizeof(header));
+    uint16_t crc = block_crc(first, sizeof(first) - 2);
+    memcpy(&first[sizeof(first) - 2], &crc, sizeof(crc));
+    // Synced at once: a file without its header is not recovered but recreated
+    return sd_logger_write(logger, first, sizeof(first)) && sd_logger_sync(logger);
+}
+
+// ========================== Appending ==========================
+
+bool binlog_append(binlog_writer* writer, uint32_t time_ms, uint16_t distance_mm,
+                   uint8_t range_status, uint8_t gate_state) {
+    binlog_block* block = &writer->block;
+    uint32_t delta = time_ms - writer->last_time_ms;
+
+    // A delta that does not fit in 16 bits starts a new block with a new base time
+    if (block->header.record_count > 0 && delta > UINT16_MAX) {
+        if (!emit_block(writer)) return false;
+    }
+
+    if (block->header.record_count == 0) {
+        block->header.base_time_ms = time_ms;
+        delta = 0;
+    }
+
+    binlog_record* record = &block->records[block->header.record_count++];
+    record->delta_ms = (uint16_t)delta;
+    record->distance_mm = distance_mm;
+    record->range_status = range_status;
+    record->gate_state = gate_state;
+    writer->last_time_ms = time_ms;
+
+    if (block->header.record_count == BINLOG_RECORDS_PER_BLOCK) {
+        return emit_block(writer);
+    }
+    return true;
+}
+
+// ========================== Checkpoints ==========================
+
+bool binlog_sync(binlog_writer* writer) {
+    binlog_block* block = &writer->block;
+    sd_logger* logger = writer->logger;
+    if (block->header.record_count == 0) return sd_logger_sync(logger);
+
+    // The block goes to its slot as it is now; the write position then moves
+    // back over it, so the next checkpoint or the full block replaces it
+    seal_block(writer);
+    bool ok = sd_logger_write(logger, block, sizeof(*block));
+    if (ok && logger->bytes_since_sync > 0) ok = sd_logger_sync(logger); // Unless the byte policy just did
+    ok = ok && sd_logger_rewind_sector(logger);
+    if (ok) writer->synced_count = block->header.record_count;
+    return ok;
+}
+
+bool binlog_poll(binlog_writer* writer) {
+    sd_logger* logger = writer->logger;
+    if (!logger || !logger->is_open || logger->sync_interval_ms == 0) return true;
+    if (logger->bytes_since_sync == 0 && writer->block.header.record_count == writer->synced_count) return true;
+
+    // Time based sync policy of the logger, with the block being filled included
+    if (to_ms_since_boot(get_absolute_time()) - logger->last_sync_ms >= logger->sync_interval_ms) {
+        return binlog_sync(writer);
+    }
+    return true;
+}
+
+// ========================== Closing ==========================
+
+bool binlog_close(binlog_writer* writer) {
+    bool ok = true;
+    if (writer->block.header.record_count > 0) {
+        ok = emit_block(writer);
+    }
+    return sd_logger_close(writer->logger) && ok;
+}
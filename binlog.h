@@ -0,0 +1,64 @@
+#ifndef BINLOG_H
+#define BINLOG_H
+
+// Inclusion of standard libraries for boolean and fixed-length integer types
+#include <stdbool.h>     // Allows the use of the bool type (true/false)
+#include <stdint.h>      // Allows the use of types like uint8_t, uint16_t, etc.
+
+#include "binlog_format.h"
+#include "sd_logger.h"
+
+// Blocks probed past the end found by the recovery scan: a hole this short
+// (sectors of one multi-sector write that did not all land) is stepped over
+#ifndef BINLOG_RECOVERY_PROBE_BLOCKS
+#define BINLOG_RECOVERY_PROBE_BLOCKS 4
+#endif
+
+// Entries of the cluster link map (FF_USE_FASTSEEK) the recovery scan builds
+// for a log that is not a preallocated extent: 2 per fragment plus 1. A more
+// fragmented file is scanned by following the FAT at every seek.
+#ifndef BINLOG_RECOVERY_LINK_MAP
+#define BINLOG_RECOVERY_LINK_MAP 64
+#endif
+
+// Structure representing an open binary log; records are packed into a RAM
+// block that is handed to the sd_logger once it is full (or on close)
+typedef struct {
+    sd_logger* logger;          // Open log file the blocks are appended to
+    binlog_block block;         // Block being filled
+    uint32_t sequence;          // Sequence number of the block being filled
+    uint32_t last_time_ms;      // Time of the last appended record
+    uint16_t file_tag;          // Tag written in the file header and every block
+    uint16_t synced_count;      // Records of the block already in its checkpoint
+    bool resumed;               // binlog_open continued an existing log
+    uint32_t recovered_blocks;  // Data blocks it kept
+    uint32_t recovery_reads;    // Blocks it read to find their end
+    uint32_t recovery_us;       // Time that scan took
+} binlog_writer;
+
+// Function to open the binary log. An existing log is recovered: its last
+// valid block is found by binary search (O(log n) sector reads, by LBA when
+// the file is a preallocated extent) and appending resumes after it, without
+// truncation. A missing or empty file is created with its header; a nonzero
+// extent_bytes preallocates it as one contiguous extent (sd_logger_open_extent).
+// A file whose header is not a usable log is renamed to path.bad (path.N.bad
+// if taken) first. Read errors fail the open and leave the file alone.
+bool binlog_open(binlog_writer* writer, sd_logger* logger, const char* path, uint32_t time_ms,
+                 uint32_t extent_bytes);
+
+// Function to append one reading; no float formatting involved
+bool binlog_append(binlog_writer* writer, uint32_t time_ms, uint16_t distance_mm,
+                   uint8_t range_status, uint8_t gate_state);
+
+// Function to checkpoint: the partially filled block is written to its slot
+// and the log synced, so every record appended so far survives a power loss
+bool binlog_sync(binlog_writer* writer);
+
+// Function to run the time based sync policy of the logger with checkpoints;
+// call it from the main loop instead of sd_logger_poll
+bool binlog_poll(binlog_writer* writer);
+
+// Function to write the partially filled block and close the file
+bool binlog_close(binlog_writer* writer);
+
+#endif // BINLOG_H
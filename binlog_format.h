@@ -0,0 +1,79 @@
+#ifndef BINLOG_FORMAT_H
+#define BINLOG_FORMAT_H
+
+// On-card layout of the binary distance log (distance.bin).
+// Shared by the firmware writer (binlog.c) and the host decoder (tools/binlog2csv.c),
+// so it only depends on the standard integer types. All fields are little-endian.
+//
+// The file is a sequence of 512-byte blocks, one SD sector each:
+//   block 0      binlog_file_header, zero padded, CRC in the last two bytes
+//   block 1..n   binlog_block, records_per_block fixed-size records + CRC
+//
+// The file is an append journal: block i always carries sequence i - 1. A
+// checkpoint writes the block being filled to its slot and rewrites it there
+// once it has more records, so after a power loss the log is every block up to
+// the last one whose CRC, file tag and sequence check out; what follows (the
+// rest of an extent, a torn or stale sector) is not part of it. The firmware
+// finds that end on boot and appends after it, which leaves two kinds of
+// blocks in the middle of the journal:
+//   - short blocks (record_count < records_per_block): the checkpoint that
+//     ended the log before the restart, never filled afterwards
+//   - bad blocks (CRC, tag or sequence wrong): a torn sector that recovery
+//     stepped over because valid blocks follow it (BINLOG_RECOVERY_PROBE_BLOCKS);
+//     its sequence number is not reused
+// Readers take every valid block and skip the bad ones.
+#include <stdint.h>
+
+#define BINLOG_MAGIC "BDLBIN"       // First bytes of the file header
+#define BINLOG_VERSION 1            // Format version stored in the file header
+#define BINLOG_BLOCK_SIZE 512       // One SD sector
+#define BINLOG_RECORDS_PER_BLOCK 83 // (512 - 12 header - 2 CRC) / 6
+
+#define BINLOG_DISTANCE_INVALID 0xFFFF // distance_mm of a failed reading
+#define BINLOG_RANGE_VALID 0           // range_status of a good reading
+#define BINLOG_RANGE_NO_SAMPLE 0xFF    // range_status when the sensor gave no measurement
+                                       // (other values: VL53L0X device range status)
+#define BINLOG_GATE_CLOSED 0           // gate_state values
+#define BINLOG_GATE_OPEN 1
+
+// File header, stored in the first block
+typedef struct __attribute__((packed)) {
+    char magic[6];               // BINLOG_MAGIC, not NUL terminated
+    uint16_t version;            // BINLOG_VERSION
+    uint16_t block_size;         // BINLOG_BLOCK_SIZE
+    uint16_t record_size;        // sizeof(binlog_record)
+    uint16_t records_per_block;  // BINLOG_RECORDS_PER_BLOCK
+    uint16_t file_tag;           // Random tag repeated in every block of this file
+    uint32_t start_time_ms;      // Time since boot when the file was created
+    uint64_t extent_lba;         // First sector of the file when preallocated (0 = not)
+    uint32_t extent_blocks;      // Blocks in that contiguous extent
+} binlog_file_header;
+
+// One reading: 6 bytes instead of ~20 bytes of CSV text
+typedef struct __attribute__((packed)) {
+    uint16_t delta_ms;       // Time since the previous record (0 for the first of a block)
+    uint16_t distance_mm;    // Calibrated distance, or BINLOG_DISTANCE_INVALID
+    uint8_t range_status;    // Sensor range status, BINLOG_RANGE_VALID when good
+    uint8_t gate_state;      // BINLOG_GATE_OPEN or BINLOG_GATE_CLOSED
+} binlog_record;
+
+// Block header, followed by the records of the block
+typedef struct __attribute__((packed)) {
+    uint32_t sequence;       // 0 for the first data block, then +1 per block
+    uint32_t base_time_ms;   // Time since boot of the first record
+    uint16_t record_count;   // Used records (< BINLOG_RECORDS_PER_BLOCK only for the last block)
+    uint16_t file_tag;       // Copy of binlog_file_header.file_tag
+} binlog_block_header;
+
+// Data block; crc is CRC-16/XMODEM (poly 0x1021, init 0) of the preceding 510 bytes
+typedef struct __attribute__((packed)) {
+    binlog_block_header header;
+    binlog_record records[BINLOG_RECORDS_PER_BLOCK];
+    uint16_t crc;
+} binlog_block;
+
+_Static_assert(sizeof(binlog_record) == 6, "binlog_record must stay 6 bytes");
+_Static_assert(sizeof(binlog_block) == BINLOG_BLOCK_SIZE, "binlog_block must fill one sector");
+_Static_assert(sizeof(binlog_file_header) <= BINLOG_BLOCK_SIZE - 2, "binlog_file_header too large");
+
+#endif // BINLOG_FORMAT_H
@@ -0,0 +1,18 @@
+#include "distance_csv.h"
+#include <stdio.h>
+
+int distance_csv_line(char* line, size_t size, uint16_t distance_cm, const char* status, uint64_t time_ms) {
+    unsigned long minutes = time_ms / 60000;
+    unsigned long seconds = (time_ms / 1000) % 60;
+
+    if (distance_cm >= 100 && distance_cm < INVALID_DISTANCE) {
+        return snprintf(line, size, "%02lu:%02lu,%.2f,m,%s\n", 
+                minutes, seconds, distance_cm / 100.0f, status);
+    } else if (distance_cm == INVALID_DISTANCE) {
+        return snprintf(line, size, "%02lu:%02lu,ERROR,-,%s\n", 
+                minutes, seconds, status);
+    } else {
+        return snprintf(line, size, "%02lu:%02lu,%d,cm,%s\n", 
+                minutes, seconds, distance_cm, status);
+    }
+}
@@ -0,0 +1,21 @@
+#ifndef DISTANCE_CSV_H
+#define DISTANCE_CSV_H
+
+// Inclusion of standard libraries for sizes and fixed-length integer types
+#include <stddef.h>      // Allows the use of size_t
+#include <stdint.h>      // Allows the use of types like uint16_t, uint64_t, etc.
+
+// Lines of the CSV distance log (distance.txt), shared by the firmware and
+// the host test that checks tools/binlog2csv prints the same text
+
+#define INVALID_DISTANCE 2001 // Value to indicate invalid reading (>2m)
+
+// First line of a new log
+#define DISTANCE_CSV_HEADER "Time,Distance,Unit,Status\n"
+
+// Function to format one reading as "mm:ss,distance,unit,status\n": meters
+// from 1 m on, centimeters below, ERROR for INVALID_DISTANCE. Returns the
+// snprintf result
+int distance_csv_line(char* line, size_t size, uint16_t distance_cm, const char* status, uint64_t time_ms);
+
+#endif // DISTANCE_CSV_H
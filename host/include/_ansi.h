@@ -0,0 +1,13 @@
+#ifndef _ANSI_H_
+#define _ANSI_H_
+
+// Newlib header the SSD1306 library includes for its C linkage macros
+#ifdef __cplusplus
+#define _BEGIN_STD_C extern "C" {
+#define _END_STD_C }
+#else
+#define _BEGIN_STD_C
+#define _END_STD_C
+#endif
+
+#endif // _ANSI_H_
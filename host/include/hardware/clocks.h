@@ -0,0 +1,21 @@
+#ifndef _HARDWARE_CLOCKS_H
+#define _HARDWARE_CLOCKS_H
+
+#include "pico/types.h"
+
+enum clock_index {
+    clk_gpout0 = 0,
+    clk_ref = 4,
+    clk_sys = 5,
+    clk_peri = 6,
+    clk_usb = 7,
+    clk_adc = 8,
+    clk_rtc = 9,
+};
+
+// The host reports the default 125 MHz system clock
+static inline uint32_t clock_get_hz(enum clock_index clk_index) {
+    return clk_index == clk_sys || clk_index == clk_peri ? 125000000u : 48000000u;
+}
+
+#endif // _HARDWARE_CLOCKS_H
@@ -0,0 +1,144 @@
+#ifndef _HARDWARE_DMA_H
+#define _HARDWARE_DMA_H
+
+// Host stand-in for hardware/dma.h. A channel started with a peripheral data
+// register as destination runs at once through that peripheral's model;
+// channels reading from a peripheral complete as its RX FIFO fills up.
+#include "pico/types.h"
+
+#define NUM_DMA_CHANNELS 12
+
+enum dma_channel_transfer_size {
+    DMA_SIZE_8 = 0,
+    DMA_SIZE_16 = 1,
+    DMA_SIZE_32 = 2
+};
+
+// DREQ numbers only document the pacing; the host moves data without them
+#define DREQ_SPI0_TX 16
+#define DREQ_SPI0_RX 17
+#define DREQ_SPI1_TX 18
+#define DREQ_SPI1_RX 19
+#define DREQ_I2C0_TX 32
+#define DREQ_I2C0_RX 33
+#define DREQ_I2C1_TX 34
+#define DREQ_I2C1_RX 35
+#define DREQ_FORCE 0x3f
+
+typedef struct {
+    enum dma_channel_transfer_size data_size;
+    bool read_increment;
+    bool write_increment;
+    bool irq_quiet;
+    bool sniff_enable;
+    bool enable;
+    uint dreq;
+    uint chain_to;
+} dma_channel_config;
+
+// Interrupt status registers; writing a bit back acknowledges it (the host
+// clears whatever a handler leaves behind once it returns)
+typedef struct {
+    io_rw_32 intr;
+    io_rw_32 inte0;
+    io_rw_32 intf0;
+    io_rw_32 ints0;
+    io_rw_32 inte1;
+    io_rw_32 intf1;
+    io_rw_32 ints1;
+    io_rw_32 sniff_ctrl;
+    io_rw_32 sniff_data;
+} dma_hw_t;
+
+extern dma_hw_t host_dma_hw;
+#define dma_hw (&host_dma_hw)
+
+int dma_claim_unused_channel(bool required);
+void dma_channel_claim(uint channel);
+void dma_channel_unclaim(uint channel);
+
+dma_channel_config dma_channel_get_default_config(uint channel);
+
+static inline void channel_config_set_transfer_data_size(dma_channel_config* c, enum dma_channel_transfer_size size) {
+    c->data_size = size;
+}
+
+static inline void channel_config_set_read_increment(dma_channel_config* c, bool incr) {
+    c->read_increment = incr;
+}
+
+static inline void channel_config_set_write_increment(dma_channel_config* c, bool incr) {
+    c->write_increment = incr;
+}
+
+static inline void channel_config_set_dreq(dma_channel_config* c, uint dreq) {
+    c->dreq = dreq;
+}
+
+static inline void channel_config_set_chain_to(dma_channel_config* c, uint chain_to) {
+    c->chain_to = chain_to;
+}
+
+static inline void channel_config_set_irq_quiet(dma_channel_config* c, bool irq_quiet) {
+    c->irq_quiet = irq_quiet;
+}
+
+static inline void channel_config_set_sniff_enable(dma_channel_config* c, bool sniff_enable) {
+    c->sniff_enable = sniff_enable;
+}
+
+static inline void channel_config_set_enable(dma_channel_config* c, bool enable) {
+    c->enable = enable;
+}
+
+void dma_channel_set_config(uint channel, const dma_channel_config* config, bool trigger);
+void dma_channel_set_read_addr(uint channel, const volatile void* read_addr, bool trigger);
+void dma_channel_set_write_addr(uint channel, volatile void* write_addr, bool trigger);
+void dma_channel_set_trans_count(uint channel, uint32_t trans_count, bool trigger);
+void dma_channel_configure(uint channel, const dma_channel_config* config, volatile void* write_addr,
+                           const volatile void* read_addr, uint transfer_count, bool trigger);
+
+void dma_channel_start(uint channel);
+void dma_start_channel_mask(uint32_t chan_mask);
+void dma_channel_abort(uint channel);
+bool dma_channel_is_busy(uint channel);
+void dma_channel_wait_for_finish_blocking(uint channel);
+
+void dma_channel_set_irq0_enabled(uint channel, bool enabled);
+void dma_channel_set_irq1_enabled(uint channel, bool enabled);
+
+// Sniffer: of the calculations only CRC-16-CCITT is modelled, over the bytes
+// a sniffing channel moves (in memory order for 16 and 32 bit transfers)
+#define DMA_SNIFF_CTRL_EN_BITS 0x00000001u
+#define DMA_SNIFF_CTRL_DMACH_LSB 1
+#define DMA_SNIFF_CTRL_CALC_LSB 5
+#define DMA_SNIFF_CTRL_CALC_VALUE_CRC16 0x2
+
+void dma_sniffer_enable(uint channel, uint mode, bool force_channel_enable);
+void dma_sniffer_disable(void);
+
+static inline void dma_sniffer_set_data_accumulator(uint32_t seed_value) {
+    dma_hw->sniff_data = seed_value;
+}
+
+static inline uint32_t dma_sniffer_get_data_accumulator(void) {
+    return dma_hw->sniff_data;
+}
+
+static inline bool dma_channel_get_irq0_status(uint channel) {
+    return dma_hw->ints0 & (1u << channel);
+}
+
+static inline bool dma_channel_get_irq1_status(uint channel) {
+    return dma_hw->ints1 & (1u << channel);
+}
+
+static inline void dma_channel_acknowledge_irq0(uint channel) {
+    dma_hw->ints0 &= ~(1u << channel);
+}
+
+static inline void dma_channel_acknowledge_irq1(uint channel) {
+    dma_hw->ints1 &= ~(1u << channel);
+}
+
+#endif // _HARDWARE_DMA_H
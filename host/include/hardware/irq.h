@@ -0,0 +1,31 @@
+#ifndef _HARDWARE_IRQ_H
+#define _HARDWARE_IRQ_H
+
+// Host stand-in for hardware/irq.h. Peripherals raise interrupts through
+// host_irq_raise; handlers run as soon as the raising thread is outside any
+// critical section (see hardware/sync.h).
+#include "pico/types.h"
+
+enum irq_num_rp2040 {
+    TIMER_IRQ_0 = 0,
+    DMA_IRQ_0 = 11,
+    DMA_IRQ_1 = 12,
+    IO_IRQ_BANK0 = 13,
+    SPI0_IRQ = 18,
+    SPI1_IRQ = 19,
+    I2C0_IRQ = 23,
+    I2C1_IRQ = 24,
+    NUM_IRQS = 32,
+};
+
+#define PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY 0x80
+
+typedef void (*irq_handler_t)(void);
+
+void irq_set_exclusive_handler(uint num, irq_handler_t handler);
+void irq_add_shared_handler(uint num, irq_handler_t handler, uint8_t order_priority);
+void irq_remove_handler(uint num, irq_handler_t handler);
+void irq_set_enabled(uint num, bool enabled);
+bool irq_is_enabled(uint num);
+
+#endif // _HARDWARE_IRQ_H
@@ -0,0 +1,13 @@
+#ifndef _HARDWARE_RTC_H
+#define _HARDWARE_RTC_H
+
+// Host stand-in for hardware/rtc.h: the calendar starts at a fixed date and
+// follows the virtual clock, so FAT timestamps are reproducible
+#include "pico/types.h"
+
+void rtc_init(void);
+bool rtc_set_datetime(datetime_t* t);
+bool rtc_get_datetime(datetime_t* t);
+bool rtc_running(void);
+
+#endif // _HARDWARE_RTC_H
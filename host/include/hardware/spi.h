@@ -0,0 +1,65 @@
+#ifndef _HARDWARE_SPI_H
+#define _HARDWARE_SPI_H
+
+// Host stand-in for hardware/spi.h. The device selected by its CS pin (see
+// host_spi_attach) answers every byte; the bus time advances the virtual clock.
+#include "pico/types.h"
+#include "hardware/gpio.h"
+
+typedef enum {
+    SPI_CPHA_0 = 0,
+    SPI_CPHA_1 = 1
+} spi_cpha_t;
+
+typedef enum {
+    SPI_CPOL_0 = 0,
+    SPI_CPOL_1 = 1
+} spi_cpol_t;
+
+typedef enum {
+    SPI_LSB_FIRST = 0,
+    SPI_MSB_FIRST = 1
+} spi_order_t;
+
+typedef struct {
+    io_rw_32 cr0;
+    io_rw_32 cr1;
+    io_rw_32 dr;
+    io_ro_32 sr;
+    io_rw_32 cpsr;
+    io_rw_32 imsc;
+    io_ro_32 ris;
+    io_ro_32 mis;
+    io_rw_32 icr;
+    io_rw_32 dmacr;
+} spi_hw_t;
+
+typedef struct spi_inst {
+    spi_hw_t hw;
+} spi_inst_t;
+
+extern spi_inst_t spi0_inst;
+extern spi_inst_t spi1_inst;
+
+#define spi0 (&spi0_inst)
+#define spi1 (&spi1_inst)
+
+uint spi_init(spi_inst_t* spi, uint baudrate);
+void spi_deinit(spi_inst_t* spi);
+uint spi_set_baudrate(spi_inst_t* spi, uint baudrate);
+uint spi_get_baudrate(const spi_inst_t* spi);
+void spi_set_format(spi_inst_t* spi, uint data_bits, spi_cpol_t cpol, spi_cpha_t cpha, spi_order_t order);
+
+int spi_write_read_blocking(spi_inst_t* spi, const uint8_t* src, uint8_t* dst, size_t len);
+int spi_write_blocking(spi_inst_t* spi, const uint8_t* src, size_t len);
+int spi_read_blocking(spi_inst_t* spi, uint8_t repeated_tx_data, uint8_t* dst, size_t len);
+
+static inline uint spi_get_index(const spi_inst_t* spi) {
+    return spi == spi1 ? 1 : 0;
+}
+
+static inline spi_hw_t* spi_get_hw(spi_inst_t* spi) {
+    return &spi->hw;
+}
+
+#endif // _HARDWARE_SPI_H
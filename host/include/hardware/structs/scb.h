@@ -0,0 +1,17 @@
+#ifndef _HARDWARE_STRUCTS_SCB_H
+#define _HARDWARE_STRUCTS_SCB_H
+
+#include "pico/types.h"
+
+typedef struct {
+    io_ro_32 cpuid;
+    io_rw_32 icsr;
+    io_rw_32 vtor;
+    io_rw_32 aircr;
+    io_rw_32 scr;
+} armv6m_scb_hw_t;
+
+extern armv6m_scb_hw_t host_scb_hw;
+#define scb_hw (&host_scb_hw)
+
+#endif // _HARDWARE_STRUCTS_SCB_H
@@ -0,0 +1,38 @@
+#ifndef _HARDWARE_SYNC_H
+#define _HARDWARE_SYNC_H
+
+// Host stand-in for hardware/sync.h. "Disabling interrupts" defers the
+// delivery of raised interrupts on the calling thread; spin locks are pthread
+// mutexes so the core1 thread is excluded as on the chip.
+#include <pthread.h>
+#include "pico/types.h"
+
+#define NUM_SPIN_LOCKS 32
+
+typedef struct {
+    pthread_mutex_t lock;
+} spin_lock_t;
+
+uint32_t save_and_disable_interrupts(void);
+void restore_interrupts(uint32_t status);
+
+spin_lock_t* spin_lock_instance(uint lock_num);
+int spin_lock_claim_unused(bool required);
+void spin_lock_unclaim(uint lock_num);
+uint32_t spin_lock_blocking(spin_lock_t* lock);
+void spin_unlock(spin_lock_t* lock, uint32_t saved_irq);
+
+// Event register: __sev wakes every thread sleeping in __wfe
+void __wfe(void);
+void __sev(void);
+void __dmb(void);
+
+static inline void __mem_fence_acquire(void) {
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+}
+
+static inline void __mem_fence_release(void) {
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+#endif // _HARDWARE_SYNC_H
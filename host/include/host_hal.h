@@ -0,0 +1,119 @@
+#ifndef HOST_HAL_H
+#define HOST_HAL_H
+
+// Linux stand-in for the RP2040 peripherals used by the firmware, built only
+// with -DBITDOGLAB_HOST=ON. Time is virtual: it moves with sleeps, busy waits,
+// __wfe and the bus time of every I2C/SPI transfer, so a minute of logging runs
+// in a fraction of a second and the same inputs always give the same outputs.
+#include <stdbool.h>     // Allows the use of the bool type (true/false)
+#include <stddef.h>      // Allows the use of size_t
+#include <stdint.h>      // Allows the use of types like uint8_t, uint16_t, etc.
+#include <stdio.h>       // FILE for the reports
+
+#include "pico/types.h"
+#include "hardware/i2c.h"
+#include "hardware/spi.h"
+
+// ========================== Virtual clock ==========================
+
+// Function called after every clock advance (devices use it to finish work in time)
+typedef void (*host_clock_listener)(uint64_t now_ns, void* context);
+
+// Function to read the virtual time in nanoseconds since boot
+uint64_t host_clock_ns(void);
+
+// Function to let virtual time pass for the calling core. With core1 running,
+// time only moves while both cores wait, so neither can run ahead of the other.
+void host_clock_advance_ns(uint64_t ns);
+
+// Function to make the clock stop at a given time, so listeners see it exactly
+void host_clock_wake_at(uint64_t ns);
+
+// Function to register a listener; returns false when the table is full
+bool host_clock_add_listener(host_clock_listener listener, void* context);
+
+// Function to end the run (exit status 0) once the virtual clock reaches the given time; 0 = never
+void host_clock_set_deadline_us(uint64_t deadline_us);
+
+// ========================== Interrupts ==========================
+
+// Function to flag an interrupt; its handlers run once the caller leaves its critical sections
+void host_irq_raise(uint num);
+
+// Function to run the handlers of flagged interrupts (no-op inside a critical section)
+void host_irq_service(void);
+
+// ========================== GPIO and PWM recorders ==========================
+
+// Everything the firmware did to one pin
+typedef struct {
+    uint8_t function;          // enum gpio_function
+    bool output;               // Direction set by gpio_set_dir
+    bool out_level;            // Level written by gpio_put
+    bool in_level;             // Level driven from outside (host_gpio_drive)
+    bool driven;               // True once host_gpio_drive was used on the pin
+    bool pull_up, pull_down;
+    uint32_t rises, falls;     // Output transitions
+    uint64_t high_ns;          // Time spent with the output high
+    uint64_t changed_ns;       // Time of the last output change
+} host_gpio_record;
+
+// Everything the firmware did to one PWM slice
+typedef struct {
+    bool enabled;
+    uint16_t wrap;
+    uint8_t div_int, div_frac;
+    uint16_t level[2];         // Channel A and B compare levels
+    uint32_t level_changes[2];
+    uint64_t active_ns[2];     // Time spent enabled with a non-zero level
+    uint64_t changed_ns;
+} host_pwm_record;
+
+// Function to read the record of one pin
+const host_gpio_record* host_gpio_get_record(uint gpio);
+
+// Function to read the record of one PWM slice
+const host_pwm_record* host_pwm_get_record(uint slice);
+
+// Function to drive an input pin from outside (fires the GPIO interrupt on matching edges)
+void host_gpio_drive(uint gpio, bool level);
+
+// Function to read the level seen on a pin, whoever drives it
+bool host_gpio_level(uint gpio);
+
+// ========================== Bus devices ==========================
+
+// One device on a simulated I2C bus. write/read return false to NACK the address.
+typedef struct host_i2c_device {
+    uint8_t address;
+    bool (*write)(struct host_i2c_device* device, const uint8_t* data, size_t length);
+    bool (*read)(struct host_i2c_device* device, uint8_t* data, size_t length);
+    uint32_t transactions;     // Addressed transfers (writes and reads)
+    uint64_t bytes;            // Data bytes moved
+    struct host_i2c_device* next;
+} host_i2c_device;
+
+// One device on a simulated SPI bus, selected while its CS pin is low
+typedef struct host_spi_device {
+    uint cs_gpio;
+    uint8_t (*exchange)(struct host_spi_device* device, uint8_t mosi);
+    uint64_t bytes;            // Bytes clocked while selected
+    struct host_spi_device* next;
+} host_spi_device;
+
+// Function to put a device on an I2C bus
+void host_i2c_attach(i2c_inst_t* i2c, host_i2c_device* device);
+
+// Function to put a device on an SPI bus
+void host_spi_attach(spi_inst_t* spi, host_spi_device* device);
+
+// Function to read the bytes clocked on a bus since boot (address bytes included for I2C)
+uint64_t host_i2c_bus_bytes(i2c_inst_t* i2c);
+uint64_t host_spi_bus_bytes(spi_inst_t* spi);
+
+// ========================== Report ==========================
+
+// Function to print the recorders and the device statistics
+void host_report(FILE* out);
+
+#endif // HOST_HAL_H
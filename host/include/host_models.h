@@ -0,0 +1,105 @@
+#ifndef HOST_MODELS_H
+#define HOST_MODELS_H
+
+// Register-level models of the BitDogLab peripherals, attached to the host
+// buses by host_board.c
+#include "host_hal.h"
+
+// ========================== VL53L0X ==========================
+
+// Function returning the distance seen by the sensor, in millimeters
+typedef uint16_t (*host_distance_source)(uint64_t now_us, void* context);
+
+// Time-of-flight sensor: a 256-byte register file with auto-incrementing
+// index, continuous ranging timed from the programmed budget and GPIO1
+typedef struct {
+    host_i2c_device i2c;
+    uint8_t regs[256];
+    uint8_t index;             // Register index for the next access
+    bool ranging;              // Continuous mode started through SYSRANGE_START
+    uint64_t next_result_ns;   // When the running measurement completes
+    int gpio1_pin;             // Pin driven by GPIO1 (active low), -1 = not wired
+    host_distance_source source;
+    void* source_context;
+    uint32_t measurements;     // Completed measurements
+    uint32_t overwritten;      // Results replaced before the firmware read them
+} host_vl53l0x;
+
+// Function to power up a sensor at the default address 0x29 on a bus
+void host_vl53l0x_init(host_vl53l0x* sensor, i2c_inst_t* i2c, host_distance_source source, void* context);
+
+// Function to wire GPIO1 to a pin
+void host_vl53l0x_set_gpio1(host_vl53l0x* sensor, int pin);
+
+// Function to read the measurement time the registers currently program, in microseconds
+uint32_t host_vl53l0x_measurement_us(const host_vl53l0x* sensor);
+
+// ========================== SSD1306 ==========================
+
+// 128x64 OLED controller: command decoder and display RAM
+typedef struct {
+    host_i2c_device i2c;
+    uint8_t ram[8][128];       // GDDRAM, one byte = 8 vertical pixels
+    uint8_t mode;              // Memory addressing mode (0 horizontal, 1 vertical, 2 page)
+    uint8_t col_start, col_end, page_start, page_end;
+    uint8_t col, page;         // Write pointer
+    bool display_on;
+    uint8_t pending[8];        // Command being assembled with its arguments
+    uint8_t pending_length, pending_needed;
+    uint32_t commands;         // Command bytes received
+    uint64_t data_bytes;       // Display RAM bytes written
+} host_ssd1306;
+
+// Function to attach a display at the given address
+void host_ssd1306_init(host_ssd1306* display, i2c_inst_t* i2c, uint8_t address);
+
+// Function to print the display RAM as text art
+void host_ssd1306_dump(const host_ssd1306* display, FILE* out);
+
+// ========================== SD card ==========================
+
+// Counters of the SD card model
+typedef struct {
+    uint32_t commands;         // Commands received (CMD55 prefixes included)
+    uint32_t blocks_read;
+    uint32_t blocks_written;
+    uint32_t multi_reads;      // CMD18 transfers
+    uint32_t multi_writes;     // CMD25 transfers
+    uint64_t busy_ns;          // Time spent programming blocks
+    uint32_t erases;           // CMD38 erases
+    uint64_t blocks_erased;
+} host_sd_stats;
+
+// SDHC card in SPI mode backed by an image file: CMD0/8/9/10/12/13/16/17/18/
+// 24/25/32/33/38/55/58/59 and ACMD13/23/41, CRC16 on the read data, busy time
+// after writes and erases. Erased blocks read back as zeros.
+typedef struct {
+    host_spi_device spi;
+    int fd;                    // Image file
+    uint64_t sectors;
+    uint8_t command[6];
+    uint8_t command_length;
+    uint8_t out[600];          // Bytes queued on MISO
+    uint16_t out_head, out_tail;
+    int state;                 // Internal protocol state
+    bool idle;                 // R1 idle bit (until ACMD41 completes)
+    bool app_command;          // Last command was CMD55
+    bool crc_on;               // CMD59: CRC16 of written blocks is checked
+    bool busy;                 // MISO held low until ready_ns
+    uint8_t acmd41_polls;
+    uint64_t address;          // Next block of a transfer
+    uint64_t erase_start;      // CMD32 and CMD33 addresses (UINT64_MAX = not set)
+    uint64_t erase_end;
+    uint8_t block[514];        // Write data being received, with its CRC
+    uint16_t block_length;
+    uint64_t ready_ns;         // Card busy (or data not ready) until then
+    uint32_t access_ns;        // Read access time before the data token
+    uint32_t program_ns;       // Programming time of one block
+    host_sd_stats stats;
+} host_sd_card;
+
+// Function to open (creating it with default_bytes when missing) the image behind a card
+bool host_sd_card_init(host_sd_card* card, spi_inst_t* spi, uint cs_gpio, const char* path,
+                       uint64_t default_bytes);
+
+#endif // HOST_MODELS_H
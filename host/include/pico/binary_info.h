@@ -0,0 +1,8 @@
+#ifndef _PICO_BINARY_INFO_H
+#define _PICO_BINARY_INFO_H
+
+// Binary info only exists in firmware images
+#define bi_decl(_decl)
+#define bi_2pins_with_func(p0, p1, func)
+
+#endif // _PICO_BINARY_INFO_H
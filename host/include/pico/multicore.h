@@ -0,0 +1,10 @@
+#ifndef _PICO_MULTICORE_H
+#define _PICO_MULTICORE_H
+
+// Host stand-in for pico/multicore.h: core1 is a pthread
+#include "pico/types.h"
+
+void multicore_launch_core1(void (*entry)(void));
+void multicore_reset_core1(void);
+
+#endif // _PICO_MULTICORE_H
@@ -0,0 +1,26 @@
+#ifndef _PICO_MUTEX_H
+#define _PICO_MUTEX_H
+
+// Host stand-in for pico/mutex.h over pthreads (core1 runs as a second thread)
+#include <pthread.h>
+#include "pico/types.h"
+#include "pico/time.h"
+
+typedef struct {
+    pthread_mutex_t lock;
+    bool initialized;
+} mutex_t;
+
+#define auto_init_mutex(name) static mutex_t name = {PTHREAD_MUTEX_INITIALIZER, true}
+
+void mutex_init(mutex_t* mtx);
+void mutex_enter_blocking(mutex_t* mtx);
+bool mutex_try_enter(mutex_t* mtx, uint32_t* owner_out);
+bool mutex_enter_timeout_ms(mutex_t* mtx, uint32_t timeout_ms);
+void mutex_exit(mutex_t* mtx);
+
+static inline bool mutex_is_initialized(mutex_t* mtx) {
+    return mtx->initialized;
+}
+
+#endif // _PICO_MUTEX_H
@@ -0,0 +1,26 @@
+#ifndef _PICO_PLATFORM_H
+#define _PICO_PLATFORM_H
+
+// Host stand-in for pico/platform.h: section placement macros and helpers the
+// SDK makes visible through every header
+#define count_of(a) (sizeof(a) / sizeof((a)[0]))
+#define __not_in_flash(group)
+#define __not_in_flash_func(func_name) func_name
+#define __time_critical_func(func_name) func_name
+
+// Vector table slot of IRQ 0
+#define VTABLE_FIRST_IRQ 16
+
+// Exception number being handled by the calling thread: 0 in thread mode,
+// VTABLE_FIRST_IRQ + the IRQ number inside an interrupt handler of the shim
+unsigned int __get_current_exception(void);
+
+enum pico_error_codes {
+    PICO_OK = 0,
+    PICO_ERROR_NONE = 0,
+    PICO_ERROR_TIMEOUT = -1,
+    PICO_ERROR_GENERIC = -2,
+    PICO_ERROR_NO_DATA = -3,
+};
+
+#endif // _PICO_PLATFORM_H
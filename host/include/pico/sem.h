@@ -0,0 +1,24 @@
+#ifndef _PICO_SEM_H
+#define _PICO_SEM_H
+
+// Host stand-in for pico/sem.h. The names clash with POSIX <semaphore.h>, which
+// is therefore never included next to this header.
+#include <pthread.h>
+#include "pico/types.h"
+#include "pico/time.h"
+
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    int16_t permits;
+    int16_t max_permits;
+} semaphore_t;
+
+void sem_init(semaphore_t* sem, int16_t initial_permits, int16_t max_permits);
+int sem_available(semaphore_t* sem);
+bool sem_release(semaphore_t* sem);
+void sem_reset(semaphore_t* sem, int16_t permits);
+void sem_acquire_blocking(semaphore_t* sem);
+bool sem_acquire_timeout_ms(semaphore_t* sem, uint32_t timeout_ms);
+
+#endif // _PICO_SEM_H
@@ -0,0 +1,6 @@
+#ifndef _PICO_STDIO_H
+#define _PICO_STDIO_H
+
+#include "pico/stdlib.h"
+
+#endif // _PICO_STDIO_H
@@ -0,0 +1,15 @@
+#ifndef _PICO_STDLIB_H
+#define _PICO_STDLIB_H
+
+// Host stand-in for pico/stdlib.h
+#include <stdio.h>
+#include "pico/types.h"
+#include "pico/time.h"
+#include "hardware/gpio.h"
+
+// ========================== stdio ==========================
+
+bool stdio_init_all(void);
+bool stdio_usb_connected(void);
+
+#endif // _PICO_STDLIB_H
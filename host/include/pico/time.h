@@ -0,0 +1,48 @@
+#ifndef _PICO_TIME_H
+#define _PICO_TIME_H
+
+// Host stand-in for pico/time.h: everything runs on the virtual clock of
+// host/src/host_clock.c, so sleeps and timeouts cost no wall-clock time
+#include "pico/types.h"
+
+// ========================== Time ==========================
+
+uint64_t time_us_64(void);
+uint32_t time_us_32(void);
+
+static inline absolute_time_t get_absolute_time(void) {
+    return time_us_64();
+}
+
+static inline uint32_t to_ms_since_boot(absolute_time_t t) {
+    return (uint32_t)(t / 1000);
+}
+
+static inline uint64_t to_us_since_boot(absolute_time_t t) {
+    return t;
+}
+
+static inline absolute_time_t make_timeout_time_us(uint64_t us) {
+    return get_absolute_time() + us;
+}
+
+static inline absolute_time_t make_timeout_time_ms(uint32_t ms) {
+    return get_absolute_time() + (uint64_t)ms * 1000;
+}
+
+static inline int64_t absolute_time_diff_us(absolute_time_t from, absolute_time_t to) {
+    return (int64_t)(to - from);
+}
+
+void sleep_us(uint64_t us);
+void sleep_ms(uint32_t ms);
+void busy_wait_us(uint64_t us);
+void busy_wait_ms(uint32_t ms);
+
+// Returns true once the deadline has passed; otherwise lets the virtual clock run
+bool best_effort_wfe_or_timeout(absolute_time_t timeout_timestamp);
+
+// Lets pending interrupts run and the virtual clock move on
+void tight_loop_contents(void);
+
+#endif // _PICO_TIME_H
@@ -0,0 +1,30 @@
+#ifndef _PICO_TYPES_H
+#define _PICO_TYPES_H
+
+// Host stand-in for the Pico SDK basic types
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "pico/platform.h"
+
+typedef unsigned int uint;
+
+typedef volatile uint32_t io_rw_32;
+typedef const volatile uint32_t io_ro_32;
+typedef volatile uint32_t io_wo_32;
+
+// Microseconds since boot of the virtual clock
+typedef uint64_t absolute_time_t;
+
+typedef struct {
+    int16_t year;
+    int8_t month;
+    int8_t day;
+    int8_t dotw;
+    int8_t hour;
+    int8_t min;
+    int8_t sec;
+} datetime_t;
+
+#endif // _PICO_TYPES_H
@@ -0,0 +1,6 @@
+#ifndef _PICO_UTIL_DATETIME_H
+#define _PICO_UTIL_DATETIME_H
+
+#include "pico/types.h"
+
+#endif // _PICO_UTIL_DATETIME_H
@@ -0,0 +1,111 @@
+// BitDogLab wiring of the host build: VL53L0X on i2c0, SSD1306 on i2c1 and the
+// SD card on spi0, configured from the environment before main() runs
+//
+//   BITDOGLAB_SD_IMAGE        card image (default bitdoglab_sd.img, created sparse)
+//   BITDOGLAB_SD_MB           size of a new image in MiB (default 256)
+//   BITDOGLAB_HOST_SECONDS    virtual run time before exiting (default 60, 0 = forever)
+//   BITDOGLAB_DISTANCE_TRACE  file with one distance in mm per line, replayed at the sensor rate
+//   BITDOGLAB_DISTANCE_GPIO1  pin wired to the sensor GPIO1 output (default not wired)
+//   BITDOGLAB_OLED_DUMP       when set, the final display RAM is printed as text art
+#include <stdlib.h>
+
+#include "host_internal.h"
+#include "host_models.h"
+
+#define SD_CS_PIN 17
+#define SSD1306_ADDRESS 0x3C
+
+static host_vl53l0x sensor;
+static host_ssd1306 display;
+static host_sd_card card;
+
+static struct {
+    uint16_t* values;
+    size_t count;
+    size_t next;
+} trace;
+
+// ========================== Distance sources ==========================
+
+// Triangle sweep between 40 mm and 1600 mm over 20 s
+static uint16_t sweep_source(uint64_t now_us, void* context) {
+    (void)context;
+    uint64_t phase = now_us % 20000000;
+    uint64_t half = 10000000;
+    uint64_t pos = phase < half ? phase : 2 * half - phase;
+    return (uint16_t)(40 + pos * (1600 - 40) / half);
+}
+
+// One value per measurement, wrapping at the end of the file
+static uint16_t trace_source(uint64_t now_us, void* context) {
+    (void)now_us;
+    (void)context;
+    uint16_t value = trace.values[trace.next];
+    trace.next = (trace.next + 1) % trace.count;
+    return value;
+}
+
+static bool load_trace(const char* path) {
+    FILE* file = fopen(path, "r");
+    if (!file) return false;
+    size_t capacity = 0;
+    unsigned value;
+    while (fscanf(file, "%u", &value) == 1) {
+        if (trace.count == capacity) {
+            capacity = capacity ? capacity * 2 : 256;
+            uint16_t* values = realloc(trace.values, capacity * sizeof(*values));
+            if (!values) break;
+            trace.values = values;
+        }
+        trace.values[trace.count++] = (uint16_t)value;
+    }
+    fclose(file);
+    return trace.count > 0;
+}
+
+// ========================== Report ==========================
+
+static void board_report(void) {
+    fflush(stdout);
+    fprintf(stderr, "\n==== host report ====\n");
+    host_report(stderr);
+    fprintf(stderr, "vl53l0x: %lu measurements (%lu us each), %lu overwritten, %lu transfers\n",
+            (unsigned long)sensor.measurements, (unsigned long)host_vl53l0x_measurement_us(&sensor),
+            (unsigned long)sensor.overwritten, (unsigned long)sensor.i2c.transactions);
+    fprintf(stderr, "ssd1306: %lu commands, %llu data bytes, %lu transfers\n", (unsigned long)display.commands,
+            (unsigned long long)display.data_bytes, (unsigned long)display.i2c.transactions);
+    fprintf(stderr, "sd card: %lu commands, %lu blocks read, %lu blocks written, %lu multi reads, "
+            "%lu multi writes, busy %.3f s, %lu erases of %llu blocks\n", (unsigned long)card.stats.commands,
+            (unsigned long)card.stats.blocks_read, (unsigned long)card.stats.blocks_written,
+            (unsigned long)card.stats.multi_reads, (unsigned long)card.stats.multi_writes,
+            card.stats.busy_ns / 1e9, (unsigned long)card.stats.erases,
+            (unsigned long long)card.stats.blocks_erased);
+    if (getenv("BITDOGLAB_OLED_DUMP")) host_ssd1306_dump(&display, stderr);
+}
+
+// ========================== Setup ==========================
+
+static const char* env_or(const char* name, const char* fallback) {
+    const char* value = getenv(name);
+    return value && *value ? value : fallback;
+}
+
+__attribute__((constructor(200))) static void board_setup(void) {
+    const char* trace_path = getenv("BITDOGLAB_DISTANCE_TRACE");
+    bool traced = trace_path && load_trace(trace_path);
+    if (trace_path && !traced) fprintf(stderr, "host: cannot read distance trace %s\n", trace_path);
+    host_vl53l0x_init(&sensor, i2c0, traced ? trace_source : sweep_source, NULL);
+    const char* gpio1 = getenv("BITDOGLAB_DISTANCE_GPIO1");
+    if (gpio1) host_vl53l0x_set_gpio1(&sensor, atoi(gpio1));
+
+    host_ssd1306_init(&display, i2c1, SSD1306_ADDRESS);
+
+    const char* image = env_or("BITDOGLAB_SD_IMAGE", "bitdoglab_sd.img");
+    uint64_t megabytes = strtoull(env_or("BITDOGLAB_SD_MB", "256"), NULL, 10);
+    if (!host_sd_card_init(&card, spi0, SD_CS_PIN, image, megabytes << 20)) {
+        fprintf(stderr, "host: cannot open SD image %s\n", image);
+    }
+
+    host_clock_set_deadline_us(strtoull(env_or("BITDOGLAB_HOST_SECONDS", "60"), NULL, 10) * 1000000);
+    atexit(board_report);
+}
@@ -0,0 +1,303 @@
+// Virtual clock, sleeps, events, stdio and RTC of the host HAL
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "pico/stdlib.h"
+#include "hardware/rtc.h"
+#include "hardware/sync.h"
+#include "host_internal.h"
+
+#define MAX_LISTENERS 8
+#define MAX_ALARMS 16
+#define MAX_CORES 2
+
+// Time a polling loop gives away per iteration
+#define POLL_STEP_NS 100
+// Longest __wfe: on the chip the 1 kHz USB SOF interrupt wakes the core at least that often
+#define WFE_WAKE_NS 1000000
+
+static _Atomic uint64_t now_ns;
+static uint64_t deadline_ns;
+
+static struct {
+    host_clock_listener listener;
+    void* context;
+} listeners[MAX_LISTENERS];
+static int listener_count;
+
+static uint64_t alarms[MAX_ALARMS];
+static int alarm_count;
+
+// Scheduler state: time only moves while every started core waits for it
+static pthread_mutex_t time_lock;
+static pthread_once_t time_lock_once = PTHREAD_ONCE_INIT;
+static pthread_cond_t time_cond = PTHREAD_COND_INITIALIZER;
+static struct {
+    bool started;
+    bool waiting;
+    bool wake_on_event;        // Waiting in __wfe: an event wakes the core too
+    uint32_t event_mark;       // Event count when the wait started
+    uint64_t target_ns;        // Time the waiting core wakes up at
+} cores[MAX_CORES] = {{.started = true}};
+static uint32_t event_count;   // Bumped by __sev and by interrupts
+
+static _Thread_local uint core_num;
+static _Thread_local uint32_t event_seen;
+// Time the core spent inside critical sections or the HAL lock, where it
+// cannot wait for the other core; it is paid when the core leaves them
+static _Thread_local uint64_t debt_ns;
+
+// ========================== Scheduler ==========================
+
+static void time_lock_init(void) {
+    // Recursive: listeners raise interrupts, which signal events
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&time_lock, &attr);
+    pthread_mutexattr_destroy(&attr);
+}
+
+static void lock_time(void) {
+    pthread_once(&time_lock_once, time_lock_init);
+    pthread_mutex_lock(&time_lock);
+}
+
+// True when a waiting core has what it waits for and only needs the lock to go on
+static bool core_due(int i) {
+    return atomic_load(&now_ns) >= cores[i].target_ns ||
+           (cores[i].wake_on_event && cores[i].event_mark != event_count);
+}
+
+// Moves the clock to the next wake-up time and runs the listeners (time_lock
+// held). Returns false when some core is still running or due to run.
+static bool step(void) {
+    for (int i = 0; i < MAX_CORES; i++) {
+        if (cores[i].started && (!cores[i].waiting || core_due(i))) return false;
+    }
+
+    uint64_t now = atomic_load(&now_ns);
+    uint64_t next = UINT64_MAX;
+    for (int i = 0; i < MAX_CORES; i++) {
+        if (cores[i].started && cores[i].target_ns < next) next = cores[i].target_ns;
+    }
+    for (int i = 0; i < alarm_count; i++) {
+        if (alarms[i] > now && alarms[i] < next) next = alarms[i];
+    }
+    if (deadline_ns && next > deadline_ns) next = deadline_ns;
+    if (next <= now) return false;
+
+    atomic_store(&now_ns, next);
+    for (int i = 0; i < alarm_count;) {
+        if (alarms[i] <= next) alarms[i] = alarms[--alarm_count];
+        else i++;
+    }
+    host_lock();
+    for (int i = 0; i < listener_count; i++) {
+        listeners[i].listener(next, listeners[i].context);
+    }
+    host_unlock();
+    pthread_cond_broadcast(&time_cond);
+
+    if (deadline_ns && next >= deadline_ns) exit(0);
+    return true;
+}
+
+// Blocks the calling core until the clock reaches target_ns (or an event, when asked).
+// Interrupt handlers run by the listeners of step() may wait in turn: the inner
+// wait puts back the state of the outer one when it returns.
+static void wait_until(uint64_t target_ns, bool wake_on_event) {
+    lock_time();
+    bool outer_waiting = cores[core_num].waiting;
+    bool outer_wake_on_event = cores[core_num].wake_on_event;
+    uint32_t outer_event_mark = cores[core_num].event_mark;
+    uint64_t outer_target_ns = cores[core_num].target_ns;
+    cores[core_num].waiting = true;
+    cores[core_num].wake_on_event = wake_on_event;
+    cores[core_num].event_mark = event_seen;
+    cores[core_num].target_ns = target_ns;
+    while (!core_due((int)core_num)) {
+        if (!step()) pthread_cond_wait(&time_cond, &time_lock);
+    }
+    cores[core_num].waiting = outer_waiting;
+    cores[core_num].wake_on_event = outer_wake_on_event;
+    cores[core_num].event_mark = outer_event_mark;
+    cores[core_num].target_ns = outer_waiting ? outer_target_ns : UINT64_MAX;
+    pthread_cond_broadcast(&time_cond);
+    pthread_mutex_unlock(&time_lock);
+}
+
+void host_clock_settle(void) {
+    if (debt_ns == 0 || host_in_critical()) return;
+    uint64_t ns = debt_ns;
+    debt_ns = 0;
+    wait_until(atomic_load(&now_ns) + ns, false);
+}
+
+void host_clock_start_core(uint core) {
+    lock_time();
+    cores[core].started = true;
+    cores[core].waiting = false;
+    cores[core].target_ns = UINT64_MAX;
+    pthread_mutex_unlock(&time_lock);
+}
+
+void host_clock_enter_core(uint core) {
+    core_num = core;
+}
+
+// ========================== Virtual clock ==========================
+
+uint64_t host_clock_ns(void) {
+    return atomic_load(&now_ns) + debt_ns;
+}
+
+void host_clock_advance_ns(uint64_t ns) {
+    debt_ns += ns;
+    host_clock_settle();
+    host_irq_service();
+}
+
+bool host_clock_add_listener(host_clock_listener listener, void* context) {
+    if (listener_count == MAX_LISTENERS) return false;
+    listeners[listener_count].listener = listener;
+    listeners[listener_count].context = context;
+    listener_count++;
+    return true;
+}
+
+void host_clock_wake_at(uint64_t ns) {
+    lock_time();
+    if (alarm_count < MAX_ALARMS) alarms[alarm_count++] = ns;
+    pthread_mutex_unlock(&time_lock);
+}
+
+void host_clock_set_deadline_us(uint64_t deadline_us) {
+    deadline_ns = deadline_us * 1000;
+}
+
+uint64_t time_us_64(void) {
+    return host_clock_ns() / 1000;
+}
+
+uint32_t time_us_32(void) {
+    return (uint32_t)time_us_64();
+}
+
+// ========================== Sleeping ==========================
+
+void sleep_us(uint64_t us) {
+    host_clock_advance_ns(us * 1000);
+}
+
+void sleep_ms(uint32_t ms) {
+    host_clock_advance_ns((uint64_t)ms * 1000000);
+}
+
+void busy_wait_us(uint64_t us) {
+    host_clock_advance_ns(us * 1000);
+}
+
+void busy_wait_ms(uint32_t ms) {
+    host_clock_advance_ns((uint64_t)ms * 1000000);
+}
+
+void tight_loop_contents(void) {
+    host_clock_advance_ns(POLL_STEP_NS);
+}
+
+bool best_effort_wfe_or_timeout(absolute_time_t timeout_timestamp) {
+    if (get_absolute_time() >= timeout_timestamp) return true;
+    host_idle_until(timeout_timestamp * 1000);
+    return get_absolute_time() >= timeout_timestamp;
+}
+
+// ========================== Events ==========================
+
+void host_idle_until(uint64_t target_ns) {
+    host_clock_settle();
+    if (!host_in_critical()) {
+        uint64_t cap_ns = atomic_load(&now_ns) + WFE_WAKE_NS;
+        wait_until(target_ns < cap_ns ? target_ns : cap_ns, true);
+    }
+    lock_time();
+    event_seen = event_count;
+    pthread_mutex_unlock(&time_lock);
+    host_irq_service();
+}
+
+void host_idle(void) {
+    host_idle_until(UINT64_MAX);
+}
+
+void __wfe(void) {
+    lock_time();
+    bool pending = event_seen != event_count;
+    event_seen = event_count;
+    pthread_mutex_unlock(&time_lock);
+    if (!pending) host_idle();
+}
+
+void __sev(void) {
+    lock_time();
+    event_count++;
+    pthread_cond_broadcast(&time_cond);
+    pthread_mutex_unlock(&time_lock);
+}
+
+void __dmb(void) {
+    atomic_thread_fence(memory_order_seq_cst);
+}
+
+// ========================== stdio ==========================
+
+bool stdio_init_all(void) {
+    setvbuf(stdout, NULL, _IOLBF, 0);
+    return true;
+}
+
+bool stdio_usb_connected(void) {
+    return true;
+}
+
+// ========================== RTC ==========================
+
+// The calendar starts at 2025-01-01 00:00:00 and follows the virtual clock
+static int64_t rtc_offset_s = 1735689600;
+
+void rtc_init(void) {
+}
+
+bool rtc_running(void) {
+    return true;
+}
+
+bool rtc_set_datetime(datetime_t* t) {
+    struct tm tm = {
+        .tm_year = t->year - 1900,
+        .tm_mon = t->month - 1,
+        .tm_mday = t->day,
+        .tm_hour = t->hour,
+        .tm_min = t->min,
+        .tm_sec = t->sec,
+    };
+    rtc_offset_s = (int64_t)timegm(&tm) - (int64_t)(host_clock_ns() / 1000000000);
+    return true;
+}
+
+bool rtc_get_datetime(datetime_t* t) {
+    time_t seconds = (time_t)(rtc_offset_s + (int64_t)(host_clock_ns() / 1000000000));
+    struct tm tm;
+    gmtime_r(&seconds, &tm);
+    t->year = (int16_t)(tm.tm_year + 1900);
+    t->month = (int8_t)(tm.tm_mon + 1);
+    t->day = (int8_t)tm.tm_mday;
+    t->dotw = (int8_t)tm.tm_wday;
+    t->hour = (int8_t)tm.tm_hour;
+    t->min = (int8_t)tm.tm_min;
+    t->sec = (int8_t)tm.tm_sec;
+    return true;
+}
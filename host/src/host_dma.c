@@ -0,0 +1,274 @@
+// DMA controller of the host HAL. Transfers move instantly; the peripherals
+// behind the data registers account for the bus time.
+#include <stdlib.h>
+#include <string.h>
+
+#include "pico/stdlib.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+#include "host_internal.h"
+
+#define MAX_PORTS 8
+// CPU time to program a channel and start it (register writes, SDK checks)
+#define START_NS 1000
+
+dma_hw_t host_dma_hw;
+
+typedef struct {
+    bool claimed;
+    bool busy;
+    dma_channel_config config;
+    const volatile uint8_t* read_addr;
+    volatile uint8_t* write_addr;
+    uint32_t count;            // Transfers left
+    uint32_t trans_count;      // Count reloaded by the next trigger
+    bool irq0, irq1;
+} channel_state;
+
+static channel_state channels[NUM_DMA_CHANNELS];
+static host_dma_port ports[MAX_PORTS];
+static int port_count;
+
+static void run_channel(uint channel);
+
+// ========================== Auxiliary functions ==========================
+
+static const host_dma_port* find_port(const volatile void* reg) {
+    for (int i = 0; i < port_count; i++) {
+        if (ports[i].reg == reg) return &ports[i];
+    }
+    return NULL;
+}
+
+static uint32_t load(const volatile uint8_t* addr, enum dma_channel_transfer_size size) {
+    switch (size) {
+        case DMA_SIZE_8: return *addr;
+        case DMA_SIZE_16: return *(const volatile uint16_t*)addr;
+        default: return *(const volatile uint32_t*)addr;
+    }
+}
+
+static void store(volatile uint8_t* addr, enum dma_channel_transfer_size size, uint32_t value) {
+    switch (size) {
+        case DMA_SIZE_8: *addr = (uint8_t)value; break;
+        case DMA_SIZE_16: *(volatile uint16_t*)addr = (uint16_t)value; break;
+        default: *(volatile uint32_t*)addr = value; break;
+    }
+}
+
+// Feeds one transfer to the sniffer when it watches this channel
+static void sniff(uint channel, enum dma_channel_transfer_size size, uint32_t value) {
+    uint32_t ctrl = host_dma_hw.sniff_ctrl;
+    if (!(ctrl & DMA_SNIFF_CTRL_EN_BITS) || ((ctrl >> DMA_SNIFF_CTRL_DMACH_LSB) & 0xF) != channel) return;
+    if (((ctrl >> DMA_SNIFF_CTRL_CALC_LSB) & 0xF) != DMA_SNIFF_CTRL_CALC_VALUE_CRC16) return;
+    uint16_t crc = (uint16_t)host_dma_hw.sniff_data;
+    for (uint32_t i = 0; i < (1u << size); i++) {
+        crc ^= (uint16_t)(((value >> (8 * i)) & 0xFF) << 8);
+        for (int bit = 0; bit < 8; bit++) crc = crc & 0x8000 ? (uint16_t)(crc << 1) ^ 0x1021 : (uint16_t)(crc << 1);
+    }
+    host_dma_hw.sniff_data = crc;
+}
+
+static void complete(uint channel) {
+    channel_state* ch = &channels[channel];
+    ch->busy = false;
+    if (ch->config.chain_to != channel) {
+        channels[ch->config.chain_to].count = channels[ch->config.chain_to].trans_count;
+        run_channel(ch->config.chain_to);
+    }
+    if (ch->config.irq_quiet) return;
+    if (ch->irq0) {
+        host_dma_hw.ints0 |= 1u << channel;
+        host_irq_raise(DMA_IRQ_0);
+    }
+    if (ch->irq1) {
+        host_dma_hw.ints1 |= 1u << channel;
+        host_irq_raise(DMA_IRQ_1);
+    }
+}
+
+// Moves as much as possible of a started channel
+static void run_channel(uint channel) {
+    channel_state* ch = &channels[channel];
+    uint32_t step = 1u << ch->config.data_size;
+    const host_dma_port* sink = find_port(ch->write_addr);
+    const host_dma_port* source = find_port(ch->read_addr);
+    ch->busy = true;
+
+    while (ch->count > 0) {
+        uint32_t value;
+        if (source) {
+            if (!source->read(source->context, &value)) return;  // Waits for more RX data
+        } else {
+            value = load(ch->read_addr, ch->config.data_size);
+        }
+        if (ch->config.sniff_enable) sniff(channel, ch->config.data_size, value);
+        if (sink) {
+            sink->write(sink->context, value);
+        } else {
+            store(ch->write_addr, ch->config.data_size, value);
+        }
+        if (ch->config.read_increment) ch->read_addr += step;
+        if (ch->config.write_increment) ch->write_addr += step;
+        ch->count--;
+    }
+    complete(channel);
+
+    // What the sink received may be what another channel is waiting for
+    if (sink) host_dma_service();
+}
+
+// ========================== Host side ==========================
+
+void host_dma_add_port(const host_dma_port* port) {
+    if (port_count < MAX_PORTS) ports[port_count++] = *port;
+}
+
+void host_dma_service(void) {
+    for (uint channel = 0; channel < NUM_DMA_CHANNELS; channel++) {
+        if (channels[channel].busy && find_port(channels[channel].read_addr)) run_channel(channel);
+    }
+}
+
+// Snapshot and acknowledge of the DMA interrupts: the handlers write the bits
+// back to clear them, which plain memory cannot emulate, so whatever was
+// pending when they started is cleared once they return
+static uint32_t dma_irq_snapshot(uint num) {
+    return num == DMA_IRQ_0 ? host_dma_hw.ints0 : host_dma_hw.ints1;
+}
+
+static void dma_irq_ack(uint num, uint32_t snapshot) {
+    if (num == DMA_IRQ_0) host_dma_hw.ints0 &= ~snapshot;
+    else host_dma_hw.ints1 &= ~snapshot;
+}
+
+__attribute__((constructor)) static void dma_setup(void) {
+    host_irq_set_ack(DMA_IRQ_0, dma_irq_snapshot, dma_irq_ack);
+    host_irq_set_ack(DMA_IRQ_1, dma_irq_snapshot, dma_irq_ack);
+}
+
+// ========================== Channels ==========================
+
+int dma_claim_unused_channel(bool required) {
+    host_lock();
+    for (int channel = 0; channel < NUM_DMA_CHANNELS; channel++) {
+        if (!channels[channel].claimed) {
+            channels[channel].claimed = true;
+            host_unlock();
+            return channel;
+        }
+    }
+    host_unlock();
+    if (required) abort();
+    return -1;
+}
+
+void dma_channel_claim(uint channel) {
+    channels[channel].claimed = true;
+}
+
+void dma_channel_unclaim(uint channel) {
+    channels[channel].claimed = false;
+}
+
+dma_channel_config dma_channel_get_default_config(uint channel) {
+    dma_channel_config config = {
+        .data_size = DMA_SIZE_32,
+        .read_increment = true,
+        .write_increment = false,
+        .irq_quiet = false,
+        .sniff_enable = false,
+        .enable = true,
+        .dreq = DREQ_FORCE,
+        .chain_to = channel,
+    };
+    return config;
+}
+
+static void trigger(uint channel) {
+    host_clock_advance_ns(START_NS);
+    host_lock();
+    channels[channel].count = channels[channel].trans_count;
+    run_channel(channel);
+    host_unlock();
+    host_irq_service();
+}
+
+void dma_channel_set_config(uint channel, const dma_channel_config* config, bool start) {
+    channels[channel].config = *config;
+    if (start) trigger(channel);
+}
+
+void dma_channel_set_read_addr(uint channel, const volatile void* read_addr, bool start) {
+    channels[channel].read_addr = read_addr;
+    if (start) trigger(channel);
+}
+
+void dma_channel_set_write_addr(uint channel, volatile void* write_addr, bool start) {
+    channels[channel].write_addr = write_addr;
+    if (start) trigger(channel);
+}
+
+void dma_channel_set_trans_count(uint channel, uint32_t trans_count, bool start) {
+    channels[channel].trans_count = trans_count;
+    if (start) trigger(channel);
+}
+
+void dma_channel_configure(uint channel, const dma_channel_config* config, volatile void* write_addr,
+                           const volatile void* read_addr, uint transfer_count, bool start) {
+    channels[channel].config = *config;
+    channels[channel].write_addr = write_addr;
+    channels[channel].read_addr = read_addr;
+    channels[channel].trans_count = transfer_count;
+    if (start) trigger(channel);
+}
+
+void dma_channel_start(uint channel) {
+    trigger(channel);
+}
+
+void dma_start_channel_mask(uint32_t chan_mask) {
+    host_clock_advance_ns(START_NS);
+    host_lock();
+    for (uint channel = 0; channel < NUM_DMA_CHANNELS; channel++) {
+        if (chan_mask & (1u << channel)) channels[channel].count = channels[channel].trans_count;
+    }
+    for (uint channel = 0; channel < NUM_DMA_CHANNELS; channel++) {
+        if (chan_mask & (1u << channel)) run_channel(channel);
+    }
+    host_unlock();
+    host_irq_service();
+}
+
+void dma_sniffer_enable(uint channel, uint mode, bool force_channel_enable) {
+    if (force_channel_enable) channels[channel].config.sniff_enable = true;
+    host_dma_hw.sniff_ctrl = DMA_SNIFF_CTRL_EN_BITS | (channel << DMA_SNIFF_CTRL_DMACH_LSB) |
+                             (mode << DMA_SNIFF_CTRL_CALC_LSB);
+}
+
+void dma_sniffer_disable(void) {
+    host_dma_hw.sniff_ctrl = 0;
+}
+
+void dma_channel_abort(uint channel) {
+    host_lock();
+    channels[channel].busy = false;
+    channels[channel].count = 0;
+    host_unlock();
+}
+
+bool dma_channel_is_busy(uint channel) {
+    return channels[channel].busy;
+}
+
+void dma_channel_wait_for_finish_blocking(uint channel) {
+    while (dma_channel_is_busy(channel)) tight_loop_contents();
+}
+
+void dma_channel_set_irq0_enabled(uint channel, bool enabled) {
+    channels[channel].irq0 = enabled;
+}
+
+void dma_channel_set_irq1_enabled(uint channel, bool enabled) {
+    channels[channel].irq1 = enabled;
+}
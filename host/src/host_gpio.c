@@ -0,0 +1,246 @@
+// GPIO and PWM recorders of the host HAL
+#include "hardware/gpio.h"
+#include "hardware/irq.h"
+#include "hardware/pwm.h"
+#include "host_internal.h"
+
+static host_gpio_record pins[NUM_BANK0_GPIOS];
+static bool pin_used[NUM_BANK0_GPIOS];
+static host_pwm_record slices[NUM_PWM_SLICES];
+
+// GPIO interrupt state
+static gpio_irq_callback_t irq_callback;
+static uint32_t irq_events[NUM_BANK0_GPIOS];     // Enabled events per pin
+static uint32_t pending_events[NUM_BANK0_GPIOS]; // Events waiting for the handler
+
+// ========================== Auxiliary functions ==========================
+
+static host_gpio_record* touch(uint gpio) {
+    pin_used[gpio] = true;
+    return &pins[gpio];
+}
+
+// Accounts the time spent high up to now
+static void close_interval(host_gpio_record* pin, uint64_t now) {
+    if (pin->output && pin->out_level) pin->high_ns += now - pin->changed_ns;
+    pin->changed_ns = now;
+}
+
+// Accounts the time each channel spent active up to now
+static void close_pwm_interval(host_pwm_record* slice, uint64_t now) {
+    for (int chan = 0; chan < 2; chan++) {
+        if (slice->enabled && slice->level[chan]) slice->active_ns[chan] += now - slice->changed_ns;
+    }
+    slice->changed_ns = now;
+}
+
+static void gpio_irq_handler(void) {
+    for (uint gpio = 0; gpio < NUM_BANK0_GPIOS; gpio++) {
+        host_lock();
+        uint32_t events = pending_events[gpio];
+        pending_events[gpio] = 0;
+        host_unlock();
+        if (events && irq_callback) irq_callback(gpio, events);
+    }
+}
+
+// ========================== GPIO ==========================
+
+void gpio_init(uint gpio) {
+    host_lock();
+    host_gpio_record* pin = touch(gpio);
+    close_interval(pin, host_clock_ns());
+    pin->function = GPIO_FUNC_SIO;
+    pin->output = false;
+    pin->out_level = false;
+    host_unlock();
+}
+
+void gpio_deinit(uint gpio) {
+    gpio_set_function(gpio, GPIO_FUNC_NULL);
+}
+
+void gpio_set_function(uint gpio, enum gpio_function fn) {
+    host_lock();
+    touch(gpio)->function = (uint8_t)fn;
+    host_unlock();
+}
+
+enum gpio_function gpio_get_function(uint gpio) {
+    return (enum gpio_function)pins[gpio].function;
+}
+
+void gpio_set_dir(uint gpio, bool out) {
+    host_lock();
+    host_gpio_record* pin = touch(gpio);
+    close_interval(pin, host_clock_ns());
+    pin->output = out;
+    host_unlock();
+}
+
+void gpio_put(uint gpio, bool value) {
+    host_lock();
+    host_gpio_record* pin = touch(gpio);
+    if (pin->out_level != value) {
+        close_interval(pin, host_clock_ns());
+        pin->out_level = value;
+        if (pin->output) {
+            if (value) pin->rises++;
+            else pin->falls++;
+        }
+    }
+    host_unlock();
+}
+
+bool gpio_get(uint gpio) {
+    return host_gpio_level(gpio);
+}
+
+void gpio_set_pulls(uint gpio, bool up, bool down) {
+    host_lock();
+    host_gpio_record* pin = touch(gpio);
+    pin->pull_up = up;
+    pin->pull_down = down;
+    host_unlock();
+}
+
+void gpio_set_slew_rate(uint gpio, enum gpio_slew_rate slew) {
+    (void)gpio;
+    (void)slew;
+}
+
+void gpio_set_drive_strength(uint gpio, enum gpio_drive_strength drive) {
+    (void)gpio;
+    (void)drive;
+}
+
+enum gpio_drive_strength gpio_get_drive_strength(uint gpio) {
+    (void)gpio;
+    return GPIO_DRIVE_STRENGTH_4MA;
+}
+
+void gpio_set_irq_enabled(uint gpio, uint32_t event_mask, bool enabled) {
+    host_lock();
+    if (enabled) irq_events[gpio] |= event_mask;
+    else irq_events[gpio] &= ~event_mask;
+    host_unlock();
+}
+
+void gpio_set_irq_enabled_with_callback(uint gpio, uint32_t event_mask, bool enabled,
+                                        gpio_irq_callback_t callback) {
+    gpio_set_irq_enabled(gpio, event_mask, enabled);
+    irq_callback = callback;
+    irq_set_exclusive_handler(IO_IRQ_BANK0, gpio_irq_handler);
+    irq_set_enabled(IO_IRQ_BANK0, true);
+}
+
+// ========================== PWM ==========================
+
+void pwm_set_clkdiv_int_frac(uint slice_num, uint8_t integer, uint8_t fract) {
+    host_lock();
+    slices[slice_num].div_int = integer;
+    slices[slice_num].div_frac = fract;
+    host_unlock();
+}
+
+void pwm_set_wrap(uint slice_num, uint16_t wrap) {
+    host_lock();
+    slices[slice_num].wrap = wrap;
+    host_unlock();
+}
+
+void pwm_set_chan_level(uint slice_num, uint chan, uint16_t level) {
+    host_lock();
+    host_pwm_record* slice = &slices[slice_num];
+    if (slice->level[chan] != level) {
+        close_pwm_interval(slice, host_clock_ns());
+        slice->level[chan] = level;
+        slice->level_changes[chan]++;
+    }
+    host_unlock();
+}
+
+void pwm_set_enabled(uint slice_num, bool enabled) {
+    host_lock();
+    close_pwm_interval(&slices[slice_num], host_clock_ns());
+    slices[slice_num].enabled = enabled;
+    host_unlock();
+}
+
+// ========================== Host side ==========================
+
+const host_gpio_record* host_gpio_get_record(uint gpio) {
+    return &pins[gpio];
+}
+
+const host_pwm_record* host_pwm_get_record(uint slice) {
+    return &slices[slice];
+}
+
+bool host_gpio_level(uint gpio) {
+    const host_gpio_record* pin = &pins[gpio];
+    if (pin->output) return pin->out_level;
+    if (pin->driven) return pin->in_level;
+    return pin->pull_up;
+}
+
+void host_gpio_drive(uint gpio, bool level) {
+    host_lock();
+    host_gpio_record* pin = &pins[gpio];
+    bool before = host_gpio_level(gpio);
+    pin->driven = true;
+    pin->in_level = level;
+
+    uint32_t events = 0;
+    if (before && !level) events |= GPIO_IRQ_EDGE_FALL;
+    if (!before && level) events |= GPIO_IRQ_EDGE_RISE;
+    events |= level ? GPIO_IRQ_LEVEL_HIGH : GPIO_IRQ_LEVEL_LOW;
+    events &= irq_events[gpio];
+    pending_events[gpio] |= events;
+    host_unlock();
+
+    if (events) host_irq_raise(IO_IRQ_BANK0);
+}
+
+// ========================== Report ==========================
+
+static const char* function_name(uint8_t function) {
+    switch (function) {
+        case GPIO_FUNC_SPI: return "spi";
+        case GPIO_FUNC_I2C: return "i2c";
+        case GPIO_FUNC_PWM: return "pwm";
+        case GPIO_FUNC_SIO: return "sio";
+        default: return "-";
+    }
+}
+
+void host_report(FILE* out) {
+    uint64_t now = host_clock_ns();
+    fprintf(out, "virtual time: %.3f s\n", now / 1e9);
+    fprintf(out, "i2c0: %llu bytes, i2c1: %llu bytes, spi0: %llu bytes\n",
+            (unsigned long long)host_i2c_bus_bytes(i2c0), (unsigned long long)host_i2c_bus_bytes(i2c1),
+            (unsigned long long)host_spi_bus_bytes(spi0));
+
+    for (uint gpio = 0; gpio < NUM_BANK0_GPIOS; gpio++) {
+        const host_gpio_record* pin = &pins[gpio];
+        if (!pin_used[gpio]) continue;
+        uint64_t high_ns = pin->high_ns;
+        if (pin->output && pin->out_level) high_ns += now - pin->changed_ns;
+        fprintf(out, "gpio %2u: %-3s %s level %d, %lu rises, %lu falls, high %.3f s\n", gpio,
+                function_name(pin->function), pin->output ? "out" : "in ", host_gpio_level(gpio),
+                (unsigned long)pin->rises, (unsigned long)pin->falls, high_ns / 1e9);
+    }
+
+    for (uint s = 0; s < NUM_PWM_SLICES; s++) {
+        const host_pwm_record* slice = &slices[s];
+        if (!slice->wrap && !slice->enabled) continue;
+        for (int chan = 0; chan < 2; chan++) {
+            uint64_t active_ns = slice->active_ns[chan];
+            if (slice->enabled && slice->level[chan]) active_ns += now - slice->changed_ns;
+            if (!slice->level_changes[chan] && !active_ns) continue;
+            fprintf(out, "pwm %u%c: wrap %u, level %u, %lu level changes, active %.3f s\n", s,
+                    chan ? 'B' : 'A', slice->wrap, slice->level[chan],
+                    (unsigned long)slice->level_changes[chan], active_ns / 1e9);
+        }
+    }
+}
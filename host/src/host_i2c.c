@@ -0,0 +1,209 @@
+// I2C controllers of the host HAL: the blocking SDK calls and the IC_DATA_CMD
+// command stream fed by DMA both end up in the attached device models
+#include "pico/stdlib.h"
+#include "hardware/i2c.h"
+#include "hardware/irq.h"
+#include "host_internal.h"
+
+#define MAX_PENDING 256
+
+i2c_inst_t i2c0_inst;
+i2c_inst_t i2c1_inst;
+
+typedef struct {
+    i2c_inst_t* inst;
+    uint baudrate;
+    host_i2c_device* devices;
+    uint64_t bytes;            // Bytes on the wire, address bytes included
+    // Command stream written to IC_DATA_CMD
+    uint8_t pending[MAX_PENDING];
+    size_t write_length;       // Data bytes waiting to be written
+    size_t read_length;        // Read commands waiting to be run
+    bool nacked;               // Address NACKed: the rest of the transaction is dropped
+    host_fifo rx;
+    bool in_handler;           // The interrupt handlers are running (between snapshot and ack)
+    uint32_t raised_in_handler; // Events of transactions the handlers started and that already ended
+} bus_state;
+
+static bus_state buses[2];
+
+// ========================== Auxiliary functions ==========================
+
+static bus_state* bus_of(i2c_inst_t* i2c) {
+    bus_state* bus = &buses[i2c_hw_index(i2c)];
+    bus->inst = i2c;
+    return bus;
+}
+
+static host_i2c_device* find_device(bus_state* bus, uint8_t address) {
+    for (host_i2c_device* device = bus->devices; device; device = device->next) {
+        if (device->address == address) return device;
+    }
+    return NULL;
+}
+
+// Accounts the bus time of one addressed transfer: address byte plus data, 9 clocks each
+static void clock_bytes(bus_state* bus, size_t length) {
+    uint baudrate = bus->baudrate ? bus->baudrate : 100000;
+    bus->bytes += length + 1;
+    host_clock_advance_ns((uint64_t)(length + 1) * 9 * 1000000000ull / baudrate);
+}
+
+static bool device_write(bus_state* bus, uint8_t address, const uint8_t* data, size_t length) {
+    host_i2c_device* device = find_device(bus, address);
+    clock_bytes(bus, device ? length : 0);
+    if (!device || !device->write(device, data, length)) return false;
+    device->transactions++;
+    device->bytes += length;
+    return true;
+}
+
+static bool device_read(bus_state* bus, uint8_t address, uint8_t* data, size_t length) {
+    host_i2c_device* device = find_device(bus, address);
+    clock_bytes(bus, device ? length : 0);
+    if (!device || !device->read(device, data, length)) return false;
+    device->transactions++;
+    device->bytes += length;
+    return true;
+}
+
+// ========================== Blocking API ==========================
+
+uint i2c_init(i2c_inst_t* i2c, uint baudrate) {
+    bus_of(i2c)->baudrate = baudrate;
+    i2c->hw.enable = I2C_IC_ENABLE_ENABLE_BITS;
+    return baudrate;
+}
+
+void i2c_deinit(i2c_inst_t* i2c) {
+    i2c->hw.enable = 0;
+}
+
+uint i2c_set_baudrate(i2c_inst_t* i2c, uint baudrate) {
+    bus_of(i2c)->baudrate = baudrate;
+    return baudrate;
+}
+
+int i2c_write_blocking(i2c_inst_t* i2c, uint8_t addr, const uint8_t* src, size_t len, bool nostop) {
+    (void)nostop;
+    host_lock();
+    bool ok = device_write(bus_of(i2c), addr, src, len);
+    host_unlock();
+    return ok ? (int)len : PICO_ERROR_GENERIC;
+}
+
+int i2c_read_blocking(i2c_inst_t* i2c, uint8_t addr, uint8_t* dst, size_t len, bool nostop) {
+    (void)nostop;
+    host_lock();
+    bool ok = device_read(bus_of(i2c), addr, dst, len);
+    host_unlock();
+    return ok ? (int)len : PICO_ERROR_GENERIC;
+}
+
+int i2c_write_timeout_us(i2c_inst_t* i2c, uint8_t addr, const uint8_t* src, size_t len, bool nostop,
+                         uint timeout_us) {
+    (void)timeout_us;
+    return i2c_write_blocking(i2c, addr, src, len, nostop);
+}
+
+int i2c_read_timeout_us(i2c_inst_t* i2c, uint8_t addr, uint8_t* dst, size_t len, bool nostop,
+                        uint timeout_us) {
+    (void)timeout_us;
+    return i2c_read_blocking(i2c, addr, dst, len, nostop);
+}
+
+// ========================== IC_DATA_CMD stream ==========================
+
+// Runs the writes or reads gathered so far as one addressed transfer
+static void flush(bus_state* bus) {
+    uint8_t address = bus->inst->hw.tar & 0x7F;
+    if (!bus->nacked && bus->write_length > 0) {
+        bus->nacked = !device_write(bus, address, bus->pending, bus->write_length);
+    }
+    if (!bus->nacked && bus->read_length > 0) {
+        bus->nacked = !device_read(bus, address, bus->pending, bus->read_length);
+        if (!bus->nacked) {
+            for (size_t i = 0; i < bus->read_length; i++) host_fifo_push(&bus->rx, bus->pending[i]);
+        }
+    }
+    bus->write_length = 0;
+    bus->read_length = 0;
+}
+
+static void data_cmd_write(void* context, uint32_t value) {
+    bus_state* bus = context;
+    bool read = value & I2C_IC_DATA_CMD_CMD_BITS;
+
+    // A RESTART or a change of direction closes the previous transfer
+    if ((value & I2C_IC_DATA_CMD_RESTART_BITS) || (read && bus->write_length) || (!read && bus->read_length)) {
+        flush(bus);
+    }
+    if (read) {
+        if (bus->read_length < MAX_PENDING) bus->read_length++;
+    } else if (bus->write_length < MAX_PENDING) {
+        bus->pending[bus->write_length++] = (uint8_t)value;
+    }
+
+    if (value & I2C_IC_DATA_CMD_STOP_BITS) {
+        flush(bus);
+        i2c_hw_t* hw = &bus->inst->hw;
+        uint32_t raw = I2C_IC_INTR_STAT_R_STOP_DET_BITS;
+        if (bus->nacked) raw |= I2C_IC_INTR_STAT_R_TX_ABRT_BITS;
+        bus->nacked = false;
+        if (bus->in_handler) bus->raised_in_handler |= raw;
+        *(volatile uint32_t*)&hw->raw_intr_stat = raw;
+        *(volatile uint32_t*)&hw->intr_stat = raw & hw->intr_mask;
+        if (hw->intr_stat) host_irq_raise(bus == &buses[0] ? I2C0_IRQ : I2C1_IRQ);
+    }
+}
+
+static bool data_cmd_read(void* context, uint32_t* value) {
+    bus_state* bus = context;
+    uint8_t byte;
+    if (!host_fifo_pop(&bus->rx, &byte)) return false;
+    *value = byte;
+    return true;
+}
+
+// The handler reads the clear registers to acknowledge; the host clears what it saw.
+// A transaction the handler starts ends at once here, so the events it raises
+// meanwhile are kept for the next run of the handler.
+static uint32_t i2c_irq_snapshot(uint num) {
+    bus_state* bus = &buses[num == I2C1_IRQ];
+    bus->in_handler = true;
+    bus->raised_in_handler = 0;
+    return bus->inst ? bus->inst->hw.intr_stat : 0;
+}
+
+static void i2c_irq_ack(uint num, uint32_t snapshot) {
+    bus_state* bus = &buses[num == I2C1_IRQ];
+    i2c_hw_t* hw = &(num == I2C1_IRQ ? i2c1 : i2c0)->hw;
+    uint32_t raised = bus->raised_in_handler;
+    bus->in_handler = false;
+    *(volatile uint32_t*)&hw->raw_intr_stat = (hw->raw_intr_stat & ~snapshot) | raised;
+    *(volatile uint32_t*)&hw->intr_stat = (hw->intr_stat & ~snapshot) | (raised & hw->intr_mask);
+}
+
+__attribute__((constructor)) static void i2c_setup(void) {
+    for (int i = 0; i < 2; i++) {
+        buses[i].inst = i ? i2c1 : i2c0;
+        host_dma_port port = {&buses[i].inst->hw.data_cmd, data_cmd_write, data_cmd_read, &buses[i]};
+        host_dma_add_port(&port);
+    }
+    host_irq_set_ack(I2C0_IRQ, i2c_irq_snapshot, i2c_irq_ack);
+    host_irq_set_ack(I2C1_IRQ, i2c_irq_snapshot, i2c_irq_ack);
+}
+
+// ========================== Host side ==========================
+
+void host_i2c_attach(i2c_inst_t* i2c, host_i2c_device* device) {
+    host_lock();
+    bus_state* bus = bus_of(i2c);
+    device->next = bus->devices;
+    bus->devices = device;
+    host_unlock();
+}
+
+uint64_t host_i2c_bus_bytes(i2c_inst_t* i2c) {
+    return buses[i2c_hw_index(i2c)].bytes;
+}
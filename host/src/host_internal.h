@@ -0,0 +1,62 @@
+#ifndef HOST_INTERNAL_H
+#define HOST_INTERNAL_H
+
+// Glue shared by the host HAL sources only
+#include "host_hal.h"
+
+// Global lock of the simulated hardware (recursive); interrupts never run under it
+void host_lock(void);
+void host_unlock(void);
+
+// True inside a critical section or the HAL lock, where the core cannot wait for time
+bool host_in_critical(void);
+
+// Pays the time the core accumulated inside critical sections (no-op while still inside one)
+void host_clock_settle(void);
+
+// Waits like __wfe: until an event or interrupt, the given time, or the next USB SOF
+void host_idle_until(uint64_t target_ns);
+void host_idle(void);
+
+// Registers core1 with the scheduler (before its thread starts) and tags the calling thread
+void host_clock_start_core(uint core);
+void host_clock_enter_core(uint core);
+
+// Function run after the handlers of an interrupt, to acknowledge what they serviced
+typedef void (*host_irq_ack)(uint num, uint32_t snapshot);
+// Function returning the status the handlers are about to service (passed back to the ack)
+typedef uint32_t (*host_irq_snapshot)(uint num);
+void host_irq_set_ack(uint num, host_irq_snapshot snapshot, host_irq_ack ack);
+
+// Peripheral data register reachable by DMA
+typedef struct {
+    const volatile void* reg;
+    void (*write)(void* context, uint32_t value);   // DMA writing to the register
+    bool (*read)(void* context, uint32_t* value);   // DMA reading; false when the RX FIFO is empty
+    void* context;
+} host_dma_port;
+
+void host_dma_add_port(const host_dma_port* port);
+
+// Lets channels waiting on a peripheral RX FIFO take the data that arrived
+void host_dma_service(void);
+
+// Small byte FIFO standing in for the peripheral RX FIFOs
+#define HOST_FIFO_SIZE 1024
+typedef struct {
+    uint8_t data[HOST_FIFO_SIZE];
+    uint32_t head, tail;
+} host_fifo;
+
+static inline void host_fifo_push(host_fifo* fifo, uint8_t value) {
+    if (fifo->head - fifo->tail == HOST_FIFO_SIZE) fifo->tail++;   // Overrun drops the oldest byte
+    fifo->data[fifo->head++ % HOST_FIFO_SIZE] = value;
+}
+
+static inline bool host_fifo_pop(host_fifo* fifo, uint8_t* value) {
+    if (fifo->head == fifo->tail) return false;
+    *value = fifo->data[fifo->tail++ % HOST_FIFO_SIZE];
+    return true;
+}
+
+#endif // HOST_INTERNAL_H
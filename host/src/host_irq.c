@@ -0,0 +1,295 @@
+// Interrupts, critical sections, spin locks, mutexes, semaphores and core1 of the host HAL
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+
+#include "pico/mutex.h"
+#include "pico/multicore.h"
+#include "pico/platform.h"
+#include "pico/sem.h"
+#include "hardware/irq.h"
+#include "hardware/structs/scb.h"
+#include "hardware/sync.h"
+#include "host_internal.h"
+
+#define MAX_SHARED_HANDLERS 4
+
+armv6m_scb_hw_t host_scb_hw;
+
+static pthread_mutex_t hal_lock;
+static pthread_once_t hal_lock_once = PTHREAD_ONCE_INIT;
+
+static struct {
+    irq_handler_t handlers[MAX_SHARED_HANDLERS];
+    int count;
+    bool enabled;
+    host_irq_snapshot snapshot;
+    host_irq_ack ack;
+} irqs[NUM_IRQS];
+
+static _Atomic uint32_t pending_irqs;
+
+// Critical section depth of the calling thread ("interrupts disabled" when > 0)
+static _Thread_local uint32_t critical_depth;
+// HAL lock depth of the calling thread; handlers wait until it is released
+static _Thread_local uint32_t lock_depth;
+// Exception the calling thread is handling (0 = thread mode), as in IPSR
+static _Thread_local uint32_t current_exception;
+
+// ========================== HAL lock ==========================
+
+static void hal_lock_init(void) {
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&hal_lock, &attr);
+    pthread_mutexattr_destroy(&attr);
+}
+
+void host_lock(void) {
+    pthread_once(&hal_lock_once, hal_lock_init);
+    pthread_mutex_lock(&hal_lock);
+    lock_depth++;
+}
+
+void host_unlock(void) {
+    lock_depth--;
+    pthread_mutex_unlock(&hal_lock);
+    if (lock_depth == 0) {
+        host_clock_settle();
+        host_irq_service();
+    }
+}
+
+bool host_in_critical(void) {
+    return critical_depth > 0 || lock_depth > 0;
+}
+
+// ========================== Interrupts ==========================
+
+void irq_set_exclusive_handler(uint num, irq_handler_t handler) {
+    irqs[num].handlers[0] = handler;
+    irqs[num].count = 1;
+}
+
+void irq_add_shared_handler(uint num, irq_handler_t handler, uint8_t order_priority) {
+    (void)order_priority;
+    if (irqs[num].count < MAX_SHARED_HANDLERS) irqs[num].handlers[irqs[num].count++] = handler;
+}
+
+void irq_remove_handler(uint num, irq_handler_t handler) {
+    for (int i = 0; i < irqs[num].count; i++) {
+        if (irqs[num].handlers[i] == handler) {
+            irqs[num].handlers[i] = irqs[num].handlers[--irqs[num].count];
+            return;
+        }
+    }
+}
+
+void irq_set_enabled(uint num, bool enabled) {
+    irqs[num].enabled = enabled;
+    if (enabled) host_irq_service();
+}
+
+bool irq_is_enabled(uint num) {
+    return irqs[num].enabled;
+}
+
+void host_irq_set_ack(uint num, host_irq_snapshot snapshot, host_irq_ack ack) {
+    irqs[num].snapshot = snapshot;
+    irqs[num].ack = ack;
+}
+
+void host_irq_raise(uint num) {
+    atomic_fetch_or(&pending_irqs, 1u << num);
+    __sev();    // An interrupt wakes a core sleeping in __wfe
+    host_irq_service();
+}
+
+void host_irq_service(void) {
+    if (critical_depth > 0 || lock_depth > 0) return;
+
+    // Handlers run like exceptions: nothing else is delivered until they return
+    critical_depth++;
+    for (;;) {
+        uint32_t enabled = 0;
+        for (uint num = 0; num < NUM_IRQS; num++) {
+            if (irqs[num].enabled) enabled |= 1u << num;
+        }
+        uint32_t ready = atomic_fetch_and(&pending_irqs, ~enabled) & enabled;
+        if (!ready) break;
+
+        for (uint num = 0; num < NUM_IRQS; num++) {
+            if (!(ready & (1u << num))) continue;
+            uint32_t snapshot = irqs[num].snapshot ? irqs[num].snapshot(num) : 0;
+            uint32_t interrupted = current_exception;
+            current_exception = VTABLE_FIRST_IRQ + num;
+            for (int i = 0; i < irqs[num].count; i++) irqs[num].handlers[i]();
+            current_exception = interrupted;
+            if (irqs[num].ack) irqs[num].ack(num, snapshot);
+        }
+    }
+    critical_depth--;
+    host_clock_settle();
+}
+
+unsigned int __get_current_exception(void) {
+    return current_exception;
+}
+
+uint32_t save_and_disable_interrupts(void) {
+    return critical_depth++;
+}
+
+void restore_interrupts(uint32_t status) {
+    critical_depth = status;
+    if (critical_depth == 0) {
+        host_clock_settle();
+        host_irq_service();
+    }
+}
+
+// ========================== Spin locks ==========================
+
+static spin_lock_t spin_locks[NUM_SPIN_LOCKS];
+static bool spin_lock_claimed[NUM_SPIN_LOCKS];
+static pthread_once_t spin_locks_once = PTHREAD_ONCE_INIT;
+
+static void spin_locks_init(void) {
+    for (int i = 0; i < NUM_SPIN_LOCKS; i++) pthread_mutex_init(&spin_locks[i].lock, NULL);
+}
+
+spin_lock_t* spin_lock_instance(uint lock_num) {
+    pthread_once(&spin_locks_once, spin_locks_init);
+    return &spin_locks[lock_num];
+}
+
+int spin_lock_claim_unused(bool required) {
+    // Locks 0-15 are reserved for the SDK on the chip
+    for (int i = 16; i < NUM_SPIN_LOCKS; i++) {
+        if (!spin_lock_claimed[i]) {
+            spin_lock_claimed[i] = true;
+            return i;
+        }
+    }
+    if (required) abort();
+    return -1;
+}
+
+void spin_lock_unclaim(uint lock_num) {
+    spin_lock_claimed[lock_num] = false;
+}
+
+uint32_t spin_lock_blocking(spin_lock_t* lock) {
+    uint32_t saved = save_and_disable_interrupts();
+    pthread_mutex_lock(&lock->lock);
+    return saved;
+}
+
+void spin_unlock(spin_lock_t* lock, uint32_t saved_irq) {
+    pthread_mutex_unlock(&lock->lock);
+    restore_interrupts(saved_irq);
+}
+
+// ========================== Mutexes ==========================
+
+void mutex_init(mutex_t* mtx) {
+    pthread_mutex_init(&mtx->lock, NULL);
+    mtx->initialized = true;
+}
+
+// Waits like the SDK does (__wfe until the owner's __sev), so a core blocked
+// here still lets the virtual clock move for the owner
+void mutex_enter_blocking(mutex_t* mtx) {
+    while (pthread_mutex_trylock(&mtx->lock) != 0) host_idle();
+}
+
+bool mutex_try_enter(mutex_t* mtx, uint32_t* owner_out) {
+    if (owner_out) *owner_out = 0;
+    return pthread_mutex_trylock(&mtx->lock) == 0;
+}
+
+bool mutex_enter_timeout_ms(mutex_t* mtx, uint32_t timeout_ms) {
+    uint64_t deadline_us = time_us_64() + (uint64_t)timeout_ms * 1000;
+    while (pthread_mutex_trylock(&mtx->lock) != 0) {
+        if (time_us_64() >= deadline_us) return false;
+        host_idle_until(deadline_us * 1000);
+    }
+    return true;
+}
+
+void mutex_exit(mutex_t* mtx) {
+    pthread_mutex_unlock(&mtx->lock);
+    __sev();
+}
+
+// ========================== Semaphores ==========================
+
+void sem_init(semaphore_t* sem, int16_t initial_permits, int16_t max_permits) {
+    pthread_mutex_init(&sem->lock, NULL);
+    pthread_cond_init(&sem->cond, NULL);
+    sem->permits = initial_permits;
+    sem->max_permits = max_permits;
+}
+
+int sem_available(semaphore_t* sem) {
+    pthread_mutex_lock(&sem->lock);
+    int permits = sem->permits;
+    pthread_mutex_unlock(&sem->lock);
+    return permits;
+}
+
+bool sem_release(semaphore_t* sem) {
+    pthread_mutex_lock(&sem->lock);
+    bool released = sem->permits < sem->max_permits;
+    if (released) sem->permits++;
+    pthread_mutex_unlock(&sem->lock);
+    __sev();
+    return released;
+}
+
+void sem_reset(semaphore_t* sem, int16_t permits) {
+    pthread_mutex_lock(&sem->lock);
+    sem->permits = permits;
+    pthread_mutex_unlock(&sem->lock);
+}
+
+static bool sem_try_acquire(semaphore_t* sem) {
+    pthread_mutex_lock(&sem->lock);
+    bool acquired = sem->permits > 0;
+    if (acquired) sem->permits--;
+    pthread_mutex_unlock(&sem->lock);
+    return acquired;
+}
+
+void sem_acquire_blocking(semaphore_t* sem) {
+    while (!sem_try_acquire(sem)) host_idle();
+}
+
+bool sem_acquire_timeout_ms(semaphore_t* sem, uint32_t timeout_ms) {
+    uint64_t deadline_ns = host_clock_ns() + (uint64_t)timeout_ms * 1000000;
+    while (!sem_try_acquire(sem)) {
+        if (host_clock_ns() >= deadline_ns) return false;
+        host_idle();
+    }
+    return true;
+}
+
+// ========================== Core1 ==========================
+
+static void* core1_thread(void* entry) {
+    host_clock_enter_core(1);
+    ((void (*)(void))entry)();
+    return NULL;
+}
+
+void multicore_launch_core1(void (*entry)(void)) {
+    pthread_t thread;
+    host_clock_start_core(1);
+    if (pthread_create(&thread, NULL, core1_thread, (void*)entry) != 0) abort();
+    pthread_detach(thread);
+}
+
+void multicore_reset_core1(void) {
+    // A thread cannot be reset; core1 keeps running until the process ends
+}
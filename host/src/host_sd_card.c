@@ -0,0 +1,415 @@
+// SD card model: an SDHC card in SPI mode backed by an image file
+#include <fcntl.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "host_internal.h"
+#include "host_models.h"
+
+#define BLOCK_SIZE 512
+#define OUT_SIZE sizeof(((host_sd_card*)0)->out)
+
+#define TOKEN_START_BLOCK 0xFE
+#define TOKEN_START_MULTI_WRITE 0xFC
+#define TOKEN_STOP_TRAN 0xFD
+
+#define DATA_ACCEPTED 0xE5
+#define DATA_CRC_ERROR 0xEB
+
+#define R1_IDLE 0x01
+#define R1_ILLEGAL_COMMAND 0x04
+#define R1_ERASE_SEQUENCE_ERROR 0x10
+#define R1_ADDRESS_ERROR 0x20
+
+// Busy time after CMD12 and the stop token
+#define STOP_BUSY_NS 20000
+
+// Allocation unit of the SD status (AU_SIZE 9 = 4 MiB) and the erase busy
+// time: a fixed part plus a part per allocation unit touched
+#define AU_SIZE_CODE 9
+#define AU_SECTORS 8192
+#define ERASE_BUSY_NS 1000000
+#define ERASE_AU_BUSY_NS 250000
+
+enum {
+    STATE_IDLE,
+    STATE_READ_SINGLE,
+    STATE_READ_MULTI,
+    STATE_WRITE_SINGLE_TOKEN,  // Waiting for the start token of a CMD24 block
+    STATE_WRITE_MULTI_TOKEN,   // Waiting for the next CMD25 token (or the stop token)
+    STATE_WRITE_SINGLE_DATA,
+    STATE_WRITE_MULTI_DATA,
+};
+
+// ========================== Auxiliary functions ==========================
+
+static uint16_t crc16(const uint8_t* data, size_t length) {
+    uint16_t crc = 0;
+    for (size_t i = 0; i < length; i++) {
+        crc ^= (uint16_t)data[i] << 8;
+        for (int bit = 0; bit < 8; bit++) crc = crc & 0x8000 ? (uint16_t)(crc << 1) ^ 0x1021 : (uint16_t)(crc << 1);
+    }
+    return crc;
+}
+
+static uint8_t crc7(const uint8_t* data, size_t length) {
+    uint8_t crc = 0;
+    for (size_t i = 0; i < length; i++) {
+        uint8_t byte = data[i];
+        for (int bit = 0; bit < 8; bit++) {
+            crc <<= 1;
+            if ((byte ^ crc) & 0x80) crc ^= 0x09;
+            byte <<= 1;
+        }
+    }
+    return crc & 0x7F;
+}
+
+static void push(host_sd_card* card, uint8_t byte) {
+    card->out[card->out_head] = byte;
+    card->out_head = (uint16_t)((card->out_head + 1) % OUT_SIZE);
+}
+
+static bool pop(host_sd_card* card, uint8_t* byte) {
+    if (card->out_head == card->out_tail) return false;
+    *byte = card->out[card->out_tail];
+    card->out_tail = (uint16_t)((card->out_tail + 1) % OUT_SIZE);
+    return true;
+}
+
+static void push_r1(host_sd_card* card, uint8_t flags) {
+    push(card, 0xFF);                            // NCR: one byte before the response
+    push(card, (uint8_t)(flags | (card->idle ? R1_IDLE : 0)));
+}
+
+// Queues a data block: start token, payload and CRC16
+static void push_block(host_sd_card* card, const uint8_t* data, size_t length) {
+    uint16_t crc = crc16(data, length);
+    push(card, TOKEN_START_BLOCK);
+    for (size_t i = 0; i < length; i++) push(card, data[i]);
+    push(card, (uint8_t)(crc >> 8));
+    push(card, (uint8_t)crc);
+}
+
+static void set_busy(host_sd_card* card, uint64_t ns) {
+    card->busy = true;
+    card->ready_ns = host_clock_ns() + ns;
+}
+
+// ========================== Registers ==========================
+
+static void push_csd(host_sd_card* card) {
+    uint32_t c_size = (uint32_t)(card->sectors / 1024) - 1;
+    uint8_t csd[16] = {
+        0x40, 0x0E, 0x00, 0x32, 0x5B, 0x59, 0x00,
+        (uint8_t)((c_size >> 16) & 0x3F), (uint8_t)(c_size >> 8), (uint8_t)c_size,
+        0x7F, 0x80, 0x0A, 0x40, 0x00, 0x00,
+    };
+    csd[15] = (uint8_t)(crc7(csd, 15) << 1) | 1;
+    push_block(card, csd, sizeof(csd));
+}
+
+static void push_cid(host_sd_card* card) {
+    uint8_t cid[16] = {0x03, 'S', 'D', 'H', 'O', 'S', 'T', '1', 0x10, 0x12, 0x34, 0x56, 0x78, 0x01, 0x91, 0x00};
+    cid[15] = (uint8_t)(crc7(cid, 15) << 1) | 1;
+    push_block(card, cid, sizeof(cid));
+}
+
+// SD status (ACMD13): 4 MiB allocation units, erased one at a time in at most 1 s
+static void push_sd_status(host_sd_card* card) {
+    uint8_t status[64] = {0};
+    status[10] = AU_SIZE_CODE << 4;              // AU_SIZE [431:428]
+    status[12] = 1;                              // ERASE_SIZE [423:408]: 1 AU
+    status[13] = 1 << 2;                         // ERASE_TIMEOUT [407:402]: 1 s, ERASE_OFFSET 0
+    push(card, 0x00);                            // Second byte of R2
+    push_block(card, status, sizeof(status));
+}
+
+// ========================== Commands ==========================
+
+// Erases the blocks selected by CMD32 and CMD33: they read back as zeros
+static void erase(host_sd_card* card) {
+    uint64_t start = card->erase_start, end = card->erase_end;
+    card->erase_start = card->erase_end = UINT64_MAX;
+    if (start == UINT64_MAX || end == UINT64_MAX) {
+        push_r1(card, R1_ERASE_SEQUENCE_ERROR);
+        return;
+    }
+    if (end < start || end >= card->sectors) {
+        push_r1(card, R1_ADDRESS_ERROR);
+        return;
+    }
+    off_t offset = (off_t)(start * BLOCK_SIZE);
+    off_t length = (off_t)((end - start + 1) * BLOCK_SIZE);
+    bool zeroed = false;
+#ifdef FALLOC_FL_PUNCH_HOLE
+    // Keeps the image sparse
+    zeroed = fallocate(card->fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, offset, length) == 0;
+#endif
+    if (!zeroed) {
+        static const uint8_t zeros[BLOCK_SIZE];
+        for (off_t at = offset; at < offset + length; at += BLOCK_SIZE) {
+            if (pwrite(card->fd, zeros, BLOCK_SIZE, at) != BLOCK_SIZE) break;
+        }
+    }
+    push_r1(card, 0);
+    uint64_t units = end / AU_SECTORS - start / AU_SECTORS + 1;
+    set_busy(card, ERASE_BUSY_NS + units * ERASE_AU_BUSY_NS);
+    card->stats.erases++;
+    card->stats.blocks_erased += end - start + 1;
+}
+
+static bool start_transfer(host_sd_card* card, uint32_t address, int state) {
+    if (address >= card->sectors) {
+        push_r1(card, R1_ADDRESS_ERROR);
+        return false;
+    }
+    push_r1(card, 0);
+    card->address = address;
+    card->state = state;
+    return true;
+}
+
+static void run_command(host_sd_card* card) {
+    uint8_t index = card->command[0] & 0x3F;
+    uint32_t arg = ((uint32_t)card->command[1] << 24) | ((uint32_t)card->command[2] << 16) |
+                   ((uint32_t)card->command[3] << 8) | card->command[4];
+    bool app = card->app_command;
+    card->app_command = false;
+    card->stats.commands++;
+
+    if (app) {
+        switch (index) {
+            case 13:
+                push_r1(card, 0);
+                push_sd_status(card);
+                return;
+            case 23:
+                push_r1(card, 0);
+                return;
+            case 41:
+                // Reports idle for the first polls, like a card finishing its power-up
+                if (++card->acmd41_polls > 2) card->idle = false;
+                push_r1(card, 0);
+                return;
+            default:
+                break;                           // Falls back to the standard command set
+        }
+    }
+
+    switch (index) {
+        case 0:
+            card->idle = true;
+            card->acmd41_polls = 0;
+            card->state = STATE_IDLE;
+            push_r1(card, 0);
+            break;
+        case 8:
+            push_r1(card, 0);
+            push(card, 0x00);
+            push(card, 0x00);
+            push(card, card->command[3] & 0x0F);
+            push(card, card->command[4]);
+            break;
+        case 9:
+            push_r1(card, 0);
+            push_csd(card);
+            break;
+        case 10:
+            push_r1(card, 0);
+            push_cid(card);
+            break;
+        case 12:
+            // Whatever the read stream had queued is cut off by the stuff byte
+            card->out_head = card->out_tail = 0;
+            card->state = STATE_IDLE;
+            push(card, 0xFF);
+            push(card, card->idle ? R1_IDLE : 0);
+            set_busy(card, STOP_BUSY_NS);
+            break;
+        case 13:
+            push_r1(card, 0);
+            push(card, 0x00);
+            break;
+        case 16:
+            push_r1(card, 0);
+            break;
+        case 17:
+            if (start_transfer(card, arg, STATE_READ_SINGLE)) card->ready_ns = host_clock_ns() + card->access_ns;
+            break;
+        case 18:
+            if (start_transfer(card, arg, STATE_READ_MULTI)) {
+                card->ready_ns = host_clock_ns() + card->access_ns;
+                card->stats.multi_reads++;
+            }
+            break;
+        case 24:
+            start_transfer(card, arg, STATE_WRITE_SINGLE_TOKEN);
+            break;
+        case 25:
+            if (start_transfer(card, arg, STATE_WRITE_MULTI_TOKEN)) card->stats.multi_writes++;
+            break;
+        case 32:
+        case 33:
+            if (arg >= card->sectors) {
+                push_r1(card, R1_ADDRESS_ERROR);
+                break;
+            }
+            if (index == 32) card->erase_start = arg;
+            else card->erase_end = arg;
+            push_r1(card, 0);
+            break;
+        case 38:
+            erase(card);
+            break;
+        case 55:
+            card->app_command = true;
+            push_r1(card, 0);
+            break;
+        case 58: {
+            uint32_t ocr = 0x00FF8000u | (card->idle ? 0 : 0xC0000000u);
+            push_r1(card, 0);
+            push(card, (uint8_t)(ocr >> 24));
+            push(card, (uint8_t)(ocr >> 16));
+            push(card, (uint8_t)(ocr >> 8));
+            push(card, (uint8_t)ocr);
+            break;
+        }
+        case 59:
+            card->crc_on = arg & 1;
+            push_r1(card, 0);
+            break;
+        default:
+            push_r1(card, R1_ILLEGAL_COMMAND);
+            break;
+    }
+}
+
+// ========================== Data transfers ==========================
+
+// Queues the next block of a read once its access time has passed
+static void feed_read(host_sd_card* card) {
+    if (host_clock_ns() < card->ready_ns) return;
+    uint8_t data[BLOCK_SIZE];
+    if (card->address >= card->sectors ||
+        pread(card->fd, data, BLOCK_SIZE, (off_t)(card->address * BLOCK_SIZE)) != BLOCK_SIZE) {
+        memset(data, 0, BLOCK_SIZE);
+    }
+    push_block(card, data, BLOCK_SIZE);
+    card->stats.blocks_read++;
+    card->address++;
+
+    if (card->state == STATE_READ_SINGLE) {
+        card->state = STATE_IDLE;
+    } else {
+        card->ready_ns = host_clock_ns() + card->access_ns;
+    }
+}
+
+static void accept_block(host_sd_card* card) {
+    bool multi = card->state == STATE_WRITE_MULTI_DATA;
+    uint16_t crc = (uint16_t)((card->block[BLOCK_SIZE] << 8) | card->block[BLOCK_SIZE + 1]);
+
+    if (card->crc_on && crc != crc16(card->block, BLOCK_SIZE)) {
+        push(card, DATA_CRC_ERROR);
+        card->state = multi ? STATE_WRITE_MULTI_TOKEN : STATE_IDLE;
+        return;
+    }
+    if (card->address < card->sectors) {
+        if (pwrite(card->fd, card->block, BLOCK_SIZE, (off_t)(card->address * BLOCK_SIZE)) != BLOCK_SIZE) {
+            push(card, DATA_CRC_ERROR);
+            card->state = STATE_IDLE;
+            return;
+        }
+    }
+    push(card, DATA_ACCEPTED);
+    set_busy(card, card->program_ns);
+    card->stats.blocks_written++;
+    card->stats.busy_ns += card->program_ns;
+    card->address++;
+    card->state = multi ? STATE_WRITE_MULTI_TOKEN : STATE_IDLE;
+}
+
+// ========================== SPI ==========================
+
+static uint8_t card_exchange(host_spi_device* device, uint8_t mosi) {
+    host_sd_card* card = (host_sd_card*)device;
+
+    // MISO first: queued response bytes, then data, then the busy level
+    uint8_t miso = 0xFF;
+    if (!pop(card, &miso)) {
+        if (card->state == STATE_READ_SINGLE || card->state == STATE_READ_MULTI) {
+            feed_read(card);
+            if (!pop(card, &miso)) miso = 0xFF;
+        } else if (card->busy) {
+            if (host_clock_ns() < card->ready_ns) miso = 0x00;
+            else card->busy = false;
+        }
+    }
+
+    // Then what the host sent
+    switch (card->state) {
+        case STATE_WRITE_SINGLE_TOKEN:
+            if (mosi == TOKEN_START_BLOCK) {
+                card->state = STATE_WRITE_SINGLE_DATA;
+                card->block_length = 0;
+            }
+            return miso;
+        case STATE_WRITE_MULTI_TOKEN:
+            if (card->busy) return miso;
+            if (mosi == TOKEN_START_MULTI_WRITE) {
+                card->state = STATE_WRITE_MULTI_DATA;
+                card->block_length = 0;
+            } else if (mosi == TOKEN_STOP_TRAN) {
+                card->state = STATE_IDLE;
+                set_busy(card, STOP_BUSY_NS);
+            }
+            return miso;
+        case STATE_WRITE_SINGLE_DATA:
+        case STATE_WRITE_MULTI_DATA:
+            card->block[card->block_length++] = mosi;
+            if (card->block_length == sizeof(card->block)) accept_block(card);
+            return miso;
+        default:
+            break;
+    }
+
+    if (card->command_length > 0 || (mosi & 0xC0) == 0x40) {
+        card->command[card->command_length++] = mosi;
+        if (card->command_length == sizeof(card->command)) {
+            card->command_length = 0;
+            run_command(card);
+        }
+    }
+    return miso;
+}
+
+// ========================== Setup ==========================
+
+bool host_sd_card_init(host_sd_card* card, spi_inst_t* spi, uint cs_gpio, const char* path,
+                       uint64_t default_bytes) {
+    memset(card, 0, sizeof(*card));
+    card->fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (card->fd < 0) return false;
+
+    struct stat st;
+    if (fstat(card->fd, &st) != 0) return false;
+    uint64_t bytes = (uint64_t)st.st_size;
+    if (bytes == 0) {
+        // A new image is sparse: only the blocks the firmware writes take space
+        if (ftruncate(card->fd, (off_t)default_bytes) != 0) return false;
+        bytes = default_bytes;
+    }
+    card->sectors = bytes / BLOCK_SIZE / 1024 * 1024;   // CSD v2 counts 512 KiB units
+    if (card->sectors == 0) return false;
+
+    card->spi.cs_gpio = cs_gpio;
+    card->spi.exchange = card_exchange;
+    card->idle = true;
+    card->erase_start = card->erase_end = UINT64_MAX;
+    card->access_ns = 200000;
+    card->program_ns = 500000;
+    host_spi_attach(spi, &card->spi);
+    return true;
+}
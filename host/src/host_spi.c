@@ -0,0 +1,121 @@
+// SPI controllers of the host HAL: every byte is exchanged with the device
+// whose CS pin is low, and costs 8 clocks of virtual time
+#include "hardware/spi.h"
+#include "host_internal.h"
+
+spi_inst_t spi0_inst;
+spi_inst_t spi1_inst;
+
+typedef struct {
+    uint baudrate;
+    host_spi_device* devices;
+    uint64_t bytes;
+    host_fifo rx;              // What DMA reads back from SSPDR
+} bus_state;
+
+static bus_state buses[2];
+
+// ========================== Auxiliary functions ==========================
+
+static bus_state* bus_of(const spi_inst_t* spi) {
+    return &buses[spi_get_index(spi)];
+}
+
+static uint8_t exchange(bus_state* bus, uint8_t mosi) {
+    uint baudrate = bus->baudrate ? bus->baudrate : 1000000;
+    bus->bytes++;
+    host_clock_advance_ns(8 * 1000000000ull / baudrate);
+
+    for (host_spi_device* device = bus->devices; device; device = device->next) {
+        if (!host_gpio_level(device->cs_gpio)) {
+            device->bytes++;
+            return device->exchange(device, mosi);
+        }
+    }
+    return 0xFF;   // Nobody drives MISO; the pull-up reads as ones
+}
+
+// ========================== SDK API ==========================
+
+uint spi_init(spi_inst_t* spi, uint baudrate) {
+    bus_of(spi)->baudrate = baudrate;
+    return baudrate;
+}
+
+void spi_deinit(spi_inst_t* spi) {
+    (void)spi;
+}
+
+uint spi_set_baudrate(spi_inst_t* spi, uint baudrate) {
+    bus_of(spi)->baudrate = baudrate;
+    return baudrate;
+}
+
+uint spi_get_baudrate(const spi_inst_t* spi) {
+    return bus_of(spi)->baudrate;
+}
+
+void spi_set_format(spi_inst_t* spi, uint data_bits, spi_cpol_t cpol, spi_cpha_t cpha, spi_order_t order) {
+    (void)spi;
+    (void)data_bits;
+    (void)cpol;
+    (void)cpha;
+    (void)order;
+}
+
+int spi_write_read_blocking(spi_inst_t* spi, const uint8_t* src, uint8_t* dst, size_t len) {
+    host_lock();
+    for (size_t i = 0; i < len; i++) dst[i] = exchange(bus_of(spi), src[i]);
+    host_unlock();
+    return (int)len;
+}
+
+int spi_write_blocking(spi_inst_t* spi, const uint8_t* src, size_t len) {
+    host_lock();
+    for (size_t i = 0; i < len; i++) exchange(bus_of(spi), src[i]);
+    host_unlock();
+    return (int)len;
+}
+
+int spi_read_blocking(spi_inst_t* spi, uint8_t repeated_tx_data, uint8_t* dst, size_t len) {
+    host_lock();
+    for (size_t i = 0; i < len; i++) dst[i] = exchange(bus_of(spi), repeated_tx_data);
+    host_unlock();
+    return (int)len;
+}
+
+// ========================== SSPDR for DMA ==========================
+
+static void dr_write(void* context, uint32_t value) {
+    bus_state* bus = context;
+    host_fifo_push(&bus->rx, exchange(bus, (uint8_t)value));
+}
+
+static bool dr_read(void* context, uint32_t* value) {
+    bus_state* bus = context;
+    uint8_t byte;
+    if (!host_fifo_pop(&bus->rx, &byte)) return false;
+    *value = byte;
+    return true;
+}
+
+__attribute__((constructor)) static void spi_setup(void) {
+    host_dma_port port0 = {&spi0_inst.hw.dr, dr_write, dr_read, &buses[0]};
+    host_dma_port port1 = {&spi1_inst.hw.dr, dr_write, dr_read, &buses[1]};
+    host_dma_add_port(&port0);
+    host_dma_add_port(&port1);
+}
+
+// ========================== Host side ==========================
+
+void host_spi_attach(spi_inst_t* spi, host_spi_device* device) {
+    host_lock();
+    bus_state* bus = bus_of(spi);
+    device->next = bus->devices;
+    bus->devices = device;
+    host_unlock();
+}
+
+uint64_t host_spi_bus_bytes(spi_inst_t* spi) {
+    return bus_of(spi)->bytes;
+}
@@ -0,0 +1,153 @@
+// SSD1306 model: command decoder and display RAM of a 128x64 OLED on I2C
+#include <string.h>
+
+#include "host_internal.h"
+#include "host_models.h"
+
+#define WIDTH 128
+#define PAGES 8
+
+// ========================== Commands ==========================
+
+// Argument bytes that follow each multi-byte command
+static uint8_t argument_count(uint8_t command) {
+    switch (command) {
+        case 0x20: case 0x81: case 0xA8: case 0xD3: case 0xD5:
+        case 0xD9: case 0xDA: case 0xDB: case 0x8D:
+            return 1;
+        case 0x21: case 0x22: case 0xA3:
+            return 2;
+        case 0x29: case 0x2A:
+            return 5;
+        case 0x26: case 0x27:
+            return 6;
+        default:
+            return 0;
+    }
+}
+
+static void run_command(host_ssd1306* display) {
+    const uint8_t* c = display->pending;
+    switch (c[0]) {
+        case 0x20:
+            display->mode = c[1] & 0x03;
+            break;
+        case 0x21:
+            display->col_start = c[1] & 0x7F;
+            display->col_end = c[2] & 0x7F;
+            display->col = display->col_start;
+            break;
+        case 0x22:
+            display->page_start = c[1] & 0x07;
+            display->page_end = c[2] & 0x07;
+            display->page = display->page_start;
+            break;
+        case 0xAE:
+            display->display_on = false;
+            break;
+        case 0xAF:
+            display->display_on = true;
+            break;
+        default:
+            if (c[0] >= 0xB0 && c[0] <= 0xB7) {
+                display->page = c[0] & 0x07;     // Page addressing mode
+            } else if (c[0] <= 0x0F) {
+                display->col = (display->col & 0xF0) | c[0];
+            } else if (c[0] >= 0x10 && c[0] <= 0x17) {
+                display->col = (uint8_t)(((c[0] & 0x07) << 4) | (display->col & 0x0F));
+            }
+            break;
+    }
+}
+
+// Arguments may arrive in later transfers (the library sends one byte per write)
+static void command_byte(host_ssd1306* display, uint8_t byte) {
+    display->commands++;
+    if (display->pending_length == 0) {
+        display->pending_needed = argument_count(byte);
+    }
+    display->pending[display->pending_length++] = byte;
+    if (display->pending_length > display->pending_needed) {
+        run_command(display);
+        display->pending_length = 0;
+        display->pending_needed = 0;
+    }
+}
+
+// ========================== Display RAM ==========================
+
+static void data_byte(host_ssd1306* display, uint8_t byte) {
+    display->ram[display->page][display->col] = byte;
+    display->data_bytes++;
+
+    switch (display->mode) {
+        case 0:  // Horizontal: column first, then page, inside the window
+            if (display->col >= display->col_end) {
+                display->col = display->col_start;
+                display->page = display->page >= display->page_end ? display->page_start : display->page + 1;
+            } else {
+                display->col++;
+            }
+            break;
+        case 1:  // Vertical: page first, then column
+            if (display->page >= display->page_end) {
+                display->page = display->page_start;
+                display->col = display->col >= display->col_end ? display->col_start : display->col + 1;
+            } else {
+                display->page++;
+            }
+            break;
+        default: // Page: the column stops at the end of the row
+            if (display->col < WIDTH - 1) display->col++;
+            break;
+    }
+}
+
+// ========================== I2C ==========================
+
+static bool display_write(host_i2c_device* device, const uint8_t* data, size_t length) {
+    host_ssd1306* display = (host_ssd1306*)device;
+    size_t i = 0;
+    while (i < length) {
+        uint8_t control = data[i++];
+        bool is_data = control & 0x40;
+        bool single = control & 0x80;            // Co = 1: one byte, then another control byte
+        size_t end = single ? (i + 1 < length ? i + 1 : length) : length;
+        for (; i < end; i++) {
+            if (is_data) data_byte(display, data[i]);
+            else command_byte(display, data[i]);
+        }
+    }
+    return true;
+}
+
+static bool display_read(host_i2c_device* device, uint8_t* data, size_t length) {
+    (void)device;
+    memset(data, 0, length);                     // Status byte: display on, not busy
+    return true;
+}
+
+// ========================== Setup ==========================
+
+void host_ssd1306_init(host_ssd1306* display, i2c_inst_t* i2c, uint8_t address) {
+    memset(display, 0, sizeof(*display));
+    display->i2c.address = address;
+    display->i2c.write = display_write;
+    display->i2c.read = display_read;
+    display->mode = 2;                           // Reset state: page addressing
+    display->col_end = WIDTH - 1;
+    display->page_end = PAGES - 1;
+    host_i2c_attach(i2c, &display->i2c);
+}
+
+void host_ssd1306_dump(const host_ssd1306* display, FILE* out) {
+    // Two pixel rows per text line keeps the picture close to the panel's aspect
+    for (int y = 0; y < PAGES * 8; y += 2) {
+        for (int x = 0; x < WIDTH; x++) {
+            bool top = display->ram[y / 8][x] & (1u << (y % 8));
+            bool bottom = display->ram[(y + 1) / 8][x] & (1u << ((y + 1) % 8));
+            fputc(top && bottom ? '#' : top ? '"' : bottom ? '.' : ' ', out);
+        }
+        fputc('\n', out);
+    }
+}
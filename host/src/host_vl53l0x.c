@@ -0,0 +1,207 @@
+// VL53L0X model: enough of the register map for vl53l0x.c to boot the sensor,
+// program its timing budget and read continuous results on time
+#include <string.h>
+
+#include "host_internal.h"
+#include "host_models.h"
+
+// Registers the model gives a meaning to
+#define REG_SYSRANGE_START         0x00
+#define REG_SEQUENCE_CONFIG        0x01
+#define REG_INTERMEASUREMENT_MS    0x04
+#define REG_INTERRUPT_CLEAR        0x0B
+#define REG_RESULT_INTERRUPT       0x13
+#define REG_RESULT_RANGE_STATUS    0x14
+#define REG_MSRC_TIMEOUT           0x46
+#define REG_PRE_RANGE_VCSEL        0x50
+#define REG_PRE_RANGE_TIMEOUT      0x51
+#define REG_FINAL_RANGE_VCSEL      0x70
+#define REG_FINAL_RANGE_TIMEOUT    0x71
+#define REG_POWER_MANAGEMENT       0x80
+#define REG_BOOT_STATUS            0x83
+#define REG_I2C_ADDRESS            0x8A
+#define REG_PAGE_SELECT            0xFF
+
+#define RANGE_STATUS_VALID 11
+#define RANGE_STATUS_PHASE_FAIL 4
+#define MAX_RANGE_MM 2000
+
+// ========================== Timing ==========================
+
+static uint32_t macro_period_ns(uint8_t vcsel_reg) {
+    uint32_t vcsel_pclks = ((uint32_t)vcsel_reg + 1) << 1;
+    return (2304 * vcsel_pclks * 1655 + 500) / 1000;
+}
+
+static uint32_t decode_timeout(const uint8_t* reg) {
+    return ((uint32_t)reg[1] << reg[0]) + 1;
+}
+
+static uint32_t mclks_to_us(uint32_t mclks, uint8_t vcsel_reg) {
+    return (mclks * macro_period_ns(vcsel_reg) + 500) / 1000;
+}
+
+uint32_t host_vl53l0x_measurement_us(const host_vl53l0x* sensor) {
+    const uint8_t* regs = sensor->regs;
+    uint8_t config = regs[REG_SEQUENCE_CONFIG];
+    uint32_t msrc_us = mclks_to_us(regs[REG_MSRC_TIMEOUT] + 1u, regs[REG_PRE_RANGE_VCSEL]);
+    uint32_t pre_mclks = decode_timeout(&regs[REG_PRE_RANGE_TIMEOUT]);
+    uint32_t final_mclks = decode_timeout(&regs[REG_FINAL_RANGE_TIMEOUT]);
+
+    // Same step costs the ST API (and the driver) use for the budget
+    uint32_t us = 1910 + 960;
+    if (config & 0x10) us += msrc_us + 590;
+    if (config & 0x08) us += 2 * (msrc_us + 690);
+    else if (config & 0x04) us += msrc_us + 660;
+    if (config & 0x40) {
+        us += mclks_to_us(pre_mclks, regs[REG_PRE_RANGE_VCSEL]) + 660;
+        final_mclks = final_mclks > pre_mclks ? final_mclks - pre_mclks : 0;
+    }
+    if (config & 0x80) us += mclks_to_us(final_mclks, regs[REG_FINAL_RANGE_VCSEL]) + 550;
+    return us;
+}
+
+// ========================== Ranging ==========================
+
+static void schedule(host_vl53l0x* sensor, uint64_t from_ns) {
+    uint64_t period_ns = (uint64_t)host_vl53l0x_measurement_us(sensor) * 1000;
+    if (sensor->regs[REG_SYSRANGE_START] & 0x04) {
+        // Timed mode: the intermeasurement period, never shorter than the measurement
+        const uint8_t* p = &sensor->regs[REG_INTERMEASUREMENT_MS];
+        uint64_t gap_ns = (((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3]) * 1000000ull;
+        if (gap_ns > period_ns) period_ns = gap_ns;
+    }
+    sensor->next_result_ns = from_ns + period_ns;
+    host_clock_wake_at(sensor->next_result_ns);
+}
+
+static void complete_measurement(host_vl53l0x* sensor, uint64_t now_ns) {
+    uint8_t* regs = sensor->regs;
+    uint16_t distance = sensor->source(now_ns / 1000, sensor->source_context);
+    uint8_t status = RANGE_STATUS_VALID;
+    if (distance > MAX_RANGE_MM) {
+        distance = 8190;
+        status = RANGE_STATUS_PHASE_FAIL;
+    }
+
+    if (regs[REG_RESULT_INTERRUPT] & 0x07) sensor->overwritten++;
+    sensor->measurements++;
+    regs[REG_RESULT_INTERRUPT] = 0x04;
+
+    uint8_t* result = &regs[REG_RESULT_RANGE_STATUS];
+    memset(result, 0, 12);
+    result[0] = (uint8_t)(status << 3);
+    result[2] = 0x10;                            // 16 effective SPADs, 8.8 fixed point
+    result[6] = 0x0C;                            // Signal rate, 9.7 fixed point
+    result[8] = 0x00;
+    result[9] = 0x40;                            // Ambient rate, 9.7 fixed point
+    result[10] = (uint8_t)(distance >> 8);
+    result[11] = (uint8_t)distance;
+
+    if (sensor->gpio1_pin >= 0) host_gpio_drive((uint)sensor->gpio1_pin, false);
+}
+
+// Brings the sensor up to now: completes every measurement due since the last update
+static void update(host_vl53l0x* sensor, uint64_t now_ns) {
+    while (sensor->ranging && sensor->next_result_ns <= now_ns) {
+        uint64_t done_ns = sensor->next_result_ns;
+        complete_measurement(sensor, done_ns);
+        if (sensor->regs[REG_SYSRANGE_START] & 0x01) {
+            sensor->ranging = false;             // Single shot
+        } else {
+            schedule(sensor, done_ns);
+        }
+    }
+}
+
+static void clock_listener(uint64_t now_ns, void* context) {
+    update(context, now_ns);
+}
+
+static void write_register(host_vl53l0x* sensor, uint8_t reg, uint8_t value) {
+    uint8_t* regs = sensor->regs;
+    switch (reg) {
+        case REG_SYSRANGE_START:
+            regs[reg] = value;
+            if (regs[REG_PAGE_SELECT] != 0 || regs[REG_POWER_MANAGEMENT] != 0) break;
+            if (value & 0x07) {
+                // 0x01 single shot, 0x02 back-to-back, 0x04 timed
+                sensor->ranging = true;
+                schedule(sensor, host_clock_ns());
+            } else {
+                sensor->ranging = false;
+            }
+            break;
+        case REG_INTERRUPT_CLEAR:
+            regs[REG_RESULT_INTERRUPT] = 0;
+            if (sensor->gpio1_pin >= 0) host_gpio_drive((uint)sensor->gpio1_pin, true);
+            break;
+        case REG_I2C_ADDRESS:
+            regs[reg] = value & 0x7F;
+            sensor->i2c.address = value & 0x7F;  // Answers on the new address right away
+            break;
+        default:
+            regs[reg] = value;
+            break;
+    }
+}
+
+// ========================== I2C ==========================
+
+static bool sensor_write(host_i2c_device* device, const uint8_t* data, size_t length) {
+    host_vl53l0x* sensor = (host_vl53l0x*)device;
+    update(sensor, host_clock_ns());
+    if (length == 0) return true;
+    sensor->index = data[0];
+    for (size_t i = 1; i < length; i++) write_register(sensor, sensor->index++, data[i]);
+    return true;
+}
+
+static bool sensor_read(host_i2c_device* device, uint8_t* data, size_t length) {
+    host_vl53l0x* sensor = (host_vl53l0x*)device;
+    update(sensor, host_clock_ns());
+    for (size_t i = 0; i < length; i++) {
+        uint8_t reg = sensor->index++;
+        data[i] = sensor->regs[reg];
+        // The boot handshake polls this register until the NVM read completes
+        if (reg == REG_BOOT_STATUS && data[i] == 0) data[i] = 0x10;
+    }
+    return true;
+}
+
+// ========================== Setup ==========================
+
+void host_vl53l0x_init(host_vl53l0x* sensor, i2c_inst_t* i2c, host_distance_source source, void* context) {
+    memset(sensor, 0, sizeof(*sensor));
+    sensor->i2c.address = 0x29;
+    sensor->i2c.write = sensor_write;
+    sensor->i2c.read = sensor_read;
+    sensor->gpio1_pin = -1;
+    sensor->source = source;
+    sensor->source_context = context;
+
+    // Power-on values of the registers the driver reads back
+    uint8_t* regs = sensor->regs;
+    regs[0xC0] = 0xEE;                           // Model ID
+    regs[0x91] = 0x3C;                           // Stop variable
+    regs[REG_SEQUENCE_CONFIG] = 0xFF;
+    regs[REG_PRE_RANGE_VCSEL] = 0x06;            // 14 PCLKs
+    regs[REG_FINAL_RANGE_VCSEL] = 0x04;          // 10 PCLKs
+    regs[REG_MSRC_TIMEOUT] = 0x0B;
+    regs[REG_PRE_RANGE_TIMEOUT] = 0x01;
+    regs[REG_PRE_RANGE_TIMEOUT + 1] = 0x2A;
+    regs[REG_FINAL_RANGE_TIMEOUT] = 0x02;
+    regs[REG_FINAL_RANGE_TIMEOUT + 1] = 0x9D;
+    regs[0x84] = 0x01;
+    regs[REG_I2C_ADDRESS] = 0x29;
+    regs[0xF8] = 0x00;                           // No oscillator calibration
+    regs[0xF9] = 0x00;
+
+    host_i2c_attach(i2c, &sensor->i2c);
+    host_clock_add_listener(clock_listener, sensor);
+}
+
+void host_vl53l0x_set_gpio1(host_vl53l0x* sensor, int pin) {
+    sensor->gpio1_pin = pin;
+    if (pin >= 0) host_gpio_drive((uint)pin, !(sensor->regs[REG_RESULT_INTERRUPT] & 0x07));
+}
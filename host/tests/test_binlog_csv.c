@@ -0,0 +1,130 @@
+// Host test of tools/binlog2csv: the same readings are logged as text, with
+// the lines of record_distance() (distance_csv_line), and as binary records
+// with binlog.c, both on an sd_image RAM disk. The binary log is copied out
+// of the disk image and converted with the binlog2csv executable given as the
+// first argument, whose output must be the text log byte for byte.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "host_hal.h"
+#include "binlog.h"
+#include "distance_csv.h"
+#include "lib/FatFs_SPI/sd_driver/hw_config.h"
+#include "lib/FatFs_SPI/sd_driver/sd_image.h"
+
+#define DISK_SECTORS 256            // 128 KiB RAM disk (FAT12)
+#define READINGS 700                // Spans several blocks and minutes
+#define READING_PERIOD_MS 200
+#define CHECKPOINT_READINGS 10      // Readings between two syncs
+#define BIN_COPY "test_binlog_csv.bin"
+
+static uint8_t disk[DISK_SECTORS * SD_IMAGE_SECTOR_SIZE];
+static sd_image_t image;
+static FATFS fs;
+static sd_logger text_log, bin_log;
+static binlog_writer bin;
+static char expected[READINGS * 32 + 64];
+static char converted[sizeof(expected)];
+
+// Reading n: every unit and both gate states, and a failed reading now and then
+static uint16_t reading_cm(uint32_t n) {
+    if (n % 97 == 13) return INVALID_DISTANCE;
+    return (uint16_t)(n * 37 % 1000);
+}
+
+// Copies a file of the disk image to the host file system; returns its size
+// or -1
+static long copy_out(const char* path, const char* host_path, char* text, size_t size) {
+    FIL file;
+    if (f_open(&file, path, FA_READ) != FR_OK) return -1;
+    FILE* out = host_path ? fopen(host_path, "wb") : NULL;
+    long total = 0;
+    char buffer[SD_IMAGE_SECTOR_SIZE];
+    UINT read;
+    while (f_read(&file, buffer, sizeof(buffer), &read) == FR_OK && read > 0) {
+        if (out) fwrite(buffer, 1, read, out);
+        if (text && (size_t)total + read < size) memcpy(text + total, buffer, read);
+        total += read;
+    }
+    f_close(&file);
+    if (out) fclose(out);
+    if (text && (size_t)total < size) text[total] = '\0';
+    return total;
+}
+
+int main(int argc, char** argv) {
+    if (argc != 2) {
+        fprintf(stderr, "usage: %s path/to/binlog2csv\n", argv[0]);
+        return 2;
+    }
+    if (!sd_image_attach_ram(sd_get_by_num(0), &image, disk, DISK_SECTORS)) return 1;
+    MKFS_PARM opt = {FM_ANY, 0, 0, 0, 0};
+    BYTE work[FF_MAX_SS];
+    if (f_mkfs("", &opt, work, sizeof(work)) != FR_OK || f_mount(&fs, "", 1) != FR_OK) {
+        printf("FAIL: no file system on the RAM disk\n");
+        return 1;
+    }
+
+    // Both logs as main.c writes them, checkpointed alike
+    if (!sd_logger_open(&text_log, "distance.txt", true) ||
+        !binlog_open(&bin, &bin_log, "distance.bin", 0, 0)) {
+        printf("FAIL: cannot create the logs\n");
+        return 1;
+    }
+    sd_logger_write(&text_log, DISTANCE_CSV_HEADER, sizeof(DISTANCE_CSV_HEADER) - 1);
+    for (uint32_t n = 0; n < READINGS; n++) {
+        uint16_t distance_cm = reading_cm(n);
+        bool open = distance_cm < 10;
+        uint32_t time_ms = n * READING_PERIOD_MS;
+        char line[80];
+        int length = distance_csv_line(line, sizeof(line), distance_cm, open ? "OPEN" : "CLOSE", time_ms);
+        sd_logger_write(&text_log, line, (size_t)length);
+        binlog_append(&bin, time_ms,
+                      distance_cm == INVALID_DISTANCE ? BINLOG_DISTANCE_INVALID : distance_cm * 10,
+                      BINLOG_RANGE_VALID, open ? BINLOG_GATE_OPEN : BINLOG_GATE_CLOSED);
+        if ((n + 1) % CHECKPOINT_READINGS == 0) {
+            sd_logger_sync(&text_log);
+            binlog_sync(&bin);
+        }
+    }
+    if (!sd_logger_close(&text_log) || !binlog_close(&bin)) {
+        printf("FAIL: cannot close the logs\n");
+        return 1;
+    }
+
+    long text_size = copy_out("distance.txt", NULL, expected, sizeof(expected));
+    if (text_size < 0 || (size_t)text_size >= sizeof(expected) ||
+        copy_out("distance.bin", BIN_COPY, NULL, 0) < 0) {
+        printf("FAIL: cannot read the logs back\n");
+        return 1;
+    }
+
+    char command[1024];
+    snprintf(command, sizeof(command), "\"%s\" %s", argv[1], BIN_COPY);
+    FILE* pipe = popen(command, "r");
+    if (!pipe) {
+        perror(command);
+        return 1;
+    }
+    size_t converted_size = fread(converted, 1, sizeof(converted) - 1, pipe);
+    converted[converted_size] = '\0';
+    int status = pclose(pipe);
+    remove(BIN_COPY);
+
+    if (status != 0) {
+        printf("FAIL: binlog2csv exited with %d\n", status);
+        return 1;
+    }
+    if (converted_size != (size_t)text_size || memcmp(converted, expected, converted_size) != 0) {
+        size_t i = 0, line = 1;
+        while (i < converted_size && i < (size_t)text_size && converted[i] == expected[i]) {
+            if (expected[i++] == '\n') line++;
+        }
+        printf("FAIL: binlog2csv differs from distance.txt at line %zu (%zu bytes, expected %ld)\n",
+               line, converted_size, text_size);
+        return 1;
+    }
+    printf("binlog2csv: %d readings, %ld bytes, same as distance.txt\n", READINGS, text_size);
+    return 0;
+}
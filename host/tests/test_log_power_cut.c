@@ -0,0 +1,267 @@
+// Host test of the logs across power losses: the binary log (binlog.c) and
+// the text log (sd_logger.c, as record_distance uses it) each run a workload
+// of readings with a checkpoint every few of them on an sd_image RAM disk, and
+// the power is cut after 0, 1, 2, ... of its sector writes. After each cut the
+// disk cache is dropped, the volume remounted and the log recovered, appended
+// to and decoded: it must hold every reading up to the last checkpoint that
+// completed before the cut, in order, then those of the resumed run.
+//
+// Usage: test_log_power_cut [extent_kb [keep]]
+// A nonzero extent_kb preallocates the logs as one extent (sd_logger_open_extent).
+// Trimmed sectors read back as 0xFF, or with "keep" hold their stale data: the
+// disk is never wiped between cuts, so a new extent holds the logs of earlier runs.
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "host_hal.h"
+#include "binlog.h"
+#include "lib/FatFs_SPI/sd_driver/crc.h"
+#include "lib/FatFs_SPI/sd_driver/hw_config.h"
+#include "lib/FatFs_SPI/sd_driver/sd_image.h"
+#include "lib/FatFs_SPI/include/disk_cache.h"
+
+#define DISK_SECTORS 4096               // 2 MiB RAM disk
+#define POWER_CUT_BIN_PATH "cut.bin"
+#define POWER_CUT_TEXT_PATH "cut.txt"
+#define POWER_CUT_READINGS 300          // Readings of the workload that is cut
+#define POWER_CUT_CHECKPOINT_RECORDS 10 // Readings between two syncs
+#define POWER_CUT_RESUME_RECORDS 100    // Readings appended after each recovery
+#define READING_PERIOD_MS 200
+
+static uint8_t disk[DISK_SECTORS * SD_IMAGE_SECTOR_SIZE];
+static char text[DISK_SECTORS * SD_IMAGE_SECTOR_SIZE];
+static sd_image_t image;
+static FATFS fs;
+static uint32_t extent_bytes;
+static sd_logger logger;
+static binlog_writer writer;
+static uint32_t max_reads;              // Worst binlog recovery scan
+static uint32_t max_us;
+
+// One log under test: opening recovers it, a workload appends readings
+typedef struct {
+    const char* name;
+    bool (*open)(void);
+    bool (*append)(uint32_t n, bool resumed);   // Reading n of the cut or the resumed run
+    bool (*sync)(void);
+    bool (*close)(void);
+    // Readings of the cut run the closed log holds, or -1 when it is not
+    // exactly those followed by the POWER_CUT_RESUME_RECORDS of the resumed run
+    int32_t (*check)(void);
+} log_under_test;
+
+// Creates a new volume on the RAM disk and mounts it
+static bool format_disk(void) {
+    MKFS_PARM opt = {FM_ANY, 0, 0, 0, 0};
+    BYTE work[FF_MAX_SS];
+    f_mount(NULL, "", 0);
+    return f_mkfs("", &opt, work, sizeof(work)) == FR_OK && f_mount(&fs, "", 1) == FR_OK;
+}
+
+// Distance of reading n of the test workload
+static uint16_t power_cut_distance(uint32_t n) {
+    return (uint16_t)(n * 7 % 4000);
+}
+
+// ========================== Binary log ==========================
+
+static bool bin_open(void) {
+    if (!binlog_open(&writer, &logger, POWER_CUT_BIN_PATH, 0, extent_bytes)) return false;
+    if (writer.recovery_reads > max_reads) max_reads = writer.recovery_reads;
+    if (writer.recovery_us > max_us) max_us = writer.recovery_us;
+    return true;
+}
+
+static bool bin_append(uint32_t n, bool resumed) {
+    return binlog_append(&writer, n * READING_PERIOD_MS, power_cut_distance(n), BINLOG_RANGE_VALID,
+                         resumed ? BINLOG_GATE_OPEN : BINLOG_GATE_CLOSED);
+}
+
+static bool bin_sync(void) {
+    return binlog_sync(&writer);
+}
+
+static bool bin_close(void) {
+    return binlog_close(&writer);
+}
+
+// Blocks numbered without a gap, cut run (gate closed) then resumed run (gate open)
+static int32_t bin_check(void) {
+    static binlog_block block;
+    FIL file;
+    if (f_open(&file, POWER_CUT_BIN_PATH, FA_READ) != FR_OK) return -1;
+
+    binlog_file_header header;
+    uint32_t counts[2] = {0, 0};    // Readings of the cut run and of the resumed run
+    uint32_t index = 0;
+    bool ok = true;
+    UINT read = 0;
+    if (f_read(&file, &block, sizeof(block), &read) != FR_OK || read != sizeof(block)) ok = false;
+    memcpy(&header, &block, sizeof(header));
+    while (ok && f_read(&file, &block, sizeof(block), &read) == FR_OK && read == sizeof(block)) {
+        index++;
+        if (crc16((const char*)&block, offsetof(binlog_block, crc)) != block.crc ||
+            block.header.file_tag != header.file_tag || block.header.sequence != index - 1) {
+            ok = false;
+            break;
+        }
+        for (uint16_t i = 0; ok && i < block.header.record_count; i++) {
+            const binlog_record* record = &block.records[i];
+            int run = record->gate_state == BINLOG_GATE_OPEN;
+            if ((!run && counts[1]) || record->distance_mm != power_cut_distance(counts[run]++)) ok = false;
+        }
+    }
+    f_close(&file);
+    return ok && counts[1] == POWER_CUT_RESUME_RECORDS ? (int32_t)counts[0] : -1;
+}
+
+// ========================== Text log ==========================
+
+// Opened like record_distance opens distance.txt
+static bool text_open(void) {
+    if (extent_bytes) return sd_logger_append_extent(&logger, POWER_CUT_TEXT_PATH, extent_bytes);
+    return sd_logger_open(&logger, POWER_CUT_TEXT_PATH, false);
+}
+
+static bool text_append(uint32_t n, bool resumed) {
+    char line[32];
+    int length = snprintf(line, sizeof(line), "%u,%s\n", (unsigned)power_cut_distance(n),
+                          resumed ? "OPEN" : "CLOSE");
+    return sd_logger_write(&logger, line, (size_t)length);
+}
+
+static bool text_sync(void) {
+    return sd_logger_sync(&logger);
+}
+
+static bool text_close(void) {
+    return sd_logger_close(&logger);
+}
+
+// Every byte a line of the cut run (CLOSE) or, after them, of the resumed run (OPEN)
+static int32_t text_check(void) {
+    FIL file;
+    UINT size = 0;
+    if (f_open(&file, POWER_CUT_TEXT_PATH, FA_READ) != FR_OK) return -1;
+    FRESULT fr = f_read(&file, text, sizeof(text) - 1, &size);
+    f_close(&file);
+    if (fr != FR_OK) return -1;
+    text[size] = '\0';
+
+    uint32_t counts[2] = {0, 0};
+    for (const char* line = text; *line;) {
+        char expected[32];
+        const char* end = strchr(line, '\n');
+        if (!end) return -1;
+        int run = counts[1] || (end - line > 5 && memcmp(end - 5, ",OPEN", 5) == 0);
+        int length = snprintf(expected, sizeof(expected), "%u,%s\n",
+                              (unsigned)power_cut_distance(counts[run]++), run ? "OPEN" : "CLOSE");
+        if (end + 1 - line != length || memcmp(line, expected, (size_t)length) != 0) return -1;
+        line = end + 1;
+    }
+    // A NUL or other bytes past the text are not lines either
+    if (size != strlen(text)) return -1;
+    return counts[1] == POWER_CUT_RESUME_RECORDS ? (int32_t)counts[0] : -1;
+}
+
+// ========================== Cuts ==========================
+
+// Runs count readings with a checkpoint every POWER_CUT_CHECKPOINT_RECORDS,
+// stopping at the power cut; returns the readings the last checkpoint that
+// completed before the cut made durable
+static uint32_t workload(const log_under_test* log, uint32_t count, bool resumed, uint32_t* appended) {
+    uint32_t durable = 0;
+    uint32_t n;
+    for (n = 0; n < count && !image.power_cut; n++) {
+        log->append(n, resumed);
+        if ((n + 1) % POWER_CUT_CHECKPOINT_RECORDS == 0 && log->sync() && !image.power_cut) {
+            durable = n + 1;
+        }
+    }
+    *appended = n;
+    return durable;
+}
+
+// Cuts the power at every sector write of the log's workload; returns the failures
+static uint32_t run_cuts(const log_under_test* log) {
+    sd_card_t* pSD = sd_get_by_num(0);
+    uint32_t appended;
+
+    // Reference run: the sector writes of the workload, from the file creation on
+    sd_image_stats before, after;
+    format_disk();
+    sd_image_get_stats(&image, &before);
+    if (!log->open()) {
+        printf("FAIL: %s: cannot create the log\n", log->name);
+        return 1;
+    }
+    workload(log, POWER_CUT_READINGS, false, &appended);
+    sd_image_get_stats(&image, &after);
+    log->close();
+    uint32_t writes = (uint32_t)(after.write.sectors - before.write.sectors);
+
+    uint32_t failures = 0;
+    uint64_t lost = 0;
+    max_reads = max_us = 0;
+    for (uint32_t cut = 0; cut <= writes; cut++) {
+        // A new volume each time: FatFs has no fsck, and the clusters a cut
+        // leaks (an extent allocated in the FAT but not in a directory) would pile up
+        format_disk();
+        sd_image_cut_power_after(&image, cut);
+        uint32_t durable = 0;
+        appended = 0;
+        if (log->open()) durable = workload(log, POWER_CUT_READINGS, false, &appended);
+
+        // Power is back: what was in RAM (cache included) is gone, the image
+        // keeps the sectors that reached it
+        sd_image_restore_power(&image);
+        disk_cache_discard(pSD, 0, UINT64_MAX);
+        f_mount(NULL, "", 0);
+        f_mount(&fs, "", 1);
+
+        // Card-like latencies, so the recovery time reads like on a card
+        int32_t kept = -1;
+        uint32_t resumed;
+        sd_image_set_latency(&image, 250, 50);
+        bool reopened = log->open();
+        sd_image_set_latency(&image, 0, 0);
+        if (reopened) {
+            workload(log, POWER_CUT_RESUME_RECORDS, true, &resumed);
+            if (log->close()) kept = log->check();
+        }
+        if (kept < (int32_t)durable || kept > (int32_t)appended) {
+            printf("FAIL: %s: power cut after %lu sector writes: %ld readings kept, %lu durable, %lu appended\n",
+                   log->name, (unsigned long)cut, (long)kept, (unsigned long)durable, (unsigned long)appended);
+            failures++;
+        } else {
+            lost += appended - (uint32_t)kept;
+        }
+    }
+
+    printf("%s power cuts: %lu cuts, %lu failures, %.1f readings per cut lost after the last checkpoint",
+           log->name, (unsigned long)(writes + 1), (unsigned long)failures, (double)lost / (writes + 1));
+    if (max_reads) printf(", recovery max %lu block reads in %lu us", (unsigned long)max_reads, (unsigned long)max_us);
+    printf("\n");
+    return failures;
+}
+
+int main(int argc, char** argv) {
+    static const log_under_test logs[] = {
+        {"binlog", bin_open, bin_append, bin_sync, bin_close, bin_check},
+        {"text log", text_open, text_append, text_sync, text_close, text_check},
+    };
+
+    host_clock_set_deadline_us(0);  // The cuts run for minutes of virtual time
+    extent_bytes = argc > 1 ? (uint32_t)strtoul(argv[1], NULL, 0) * 1024u : 0;
+    bool keep = argc > 2 && strcmp(argv[2], "keep") == 0;
+    if (!sd_image_attach_ram(sd_get_by_num(0), &image, disk, DISK_SECTORS)) return 1;
+    if (keep) sd_image_set_trim_fill(&image, SD_IMAGE_TRIM_KEEP);
+    printf("extent %lu KiB, trimmed sectors %s\n", (unsigned long)(extent_bytes / 1024),
+           keep ? "keep their data" : "read 0xFF");
+
+    uint32_t failures = 0;
+    for (size_t i = 0; i < count_of(logs); i++) failures += run_cuts(&logs[i]);
+    return failures ? 1 : 0;
+}
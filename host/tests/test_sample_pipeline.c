@@ -0,0 +1,123 @@
+// Host test of the sample ring (sample_pipeline.c): a producer and a consumer
+// thread stand in for core0 and core1. Every sample carries its submit number,
+// so the consumer can check that the accepted ones arrive once, in order, and
+// that the counters add up to what was submitted.
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+
+#include "sample_pipeline.h"
+
+#define STRESS_SAMPLES 2000000
+
+static sample_pipeline pipeline;
+static atomic_bool producer_done;
+static uint32_t accepted;           // Producer side: samples the ring took
+static uint32_t received;           // Consumer side: samples drained
+static uint32_t out_of_order;
+static int64_t last_number = -1;
+static int failures;
+
+static void check(bool condition, const char* what) {
+    if (!condition) {
+        printf("FAIL: %s\n", what);
+        failures++;
+    }
+}
+
+// Consumer: numbers must only grow (drops leave gaps, never reorder)
+static void consume(const distance_sample* sample, void* context) {
+    (void)context;
+    if ((int64_t)sample->time_ms <= last_number) out_of_order++;
+    // distance_cm carries the low bits again, so a torn slot shows up too
+    if (sample->distance_cm != (uint16_t)sample->time_ms) out_of_order++;
+    last_number = sample->time_ms;
+    received++;
+}
+
+static void* producer(void* arg) {
+    (void)arg;
+    for (uint32_t n = 0; n < STRESS_SAMPLES; n++) {
+        distance_sample sample = {.time_ms = n, .distance_cm = (uint16_t)n};
+        if (sample_pipeline_submit(&pipeline, &sample)) {
+            accepted++;
+        } else if (n % 4 == 0) {
+            // Mostly lets the consumer catch up, so both full and empty rings occur
+            sched_yield();
+        }
+    }
+    atomic_store(&producer_done, true);
+    return NULL;
+}
+
+static void* consumer(void* arg) {
+    (void)arg;
+    for (;;) {
+        bool done = atomic_load(&producer_done);
+        // Stats are read while the producer runs, as the core1 report does
+        sample_pipeline_stats stats;
+        sample_pipeline_get_stats(&pipeline, &stats);
+        size_t count = sample_pipeline_drain(&pipeline, 7);
+        if (count == 0) {
+            if (done && sample_pipeline_drain(&pipeline, 0) == 0) break;
+            sched_yield();      // Empty: lets the producer run, as __wfe does on core1
+        }
+    }
+    return NULL;
+}
+
+// Without a consumer the ring fills, then counts every further sample as dropped
+static void test_drop_count(void) {
+    sample_pipeline_init(&pipeline);
+    for (uint32_t n = 0; n < SAMPLE_PIPELINE_SLOTS + 5; n++) {
+        distance_sample sample = {.time_ms = n, .distance_cm = (uint16_t)n};
+        check(sample_pipeline_submit(&pipeline, &sample) == (n < SAMPLE_PIPELINE_SLOTS), "submit result");
+    }
+    sample_pipeline_stats stats;
+    sample_pipeline_get_stats(&pipeline, &stats);
+    check(stats.submitted == SAMPLE_PIPELINE_SLOTS, "submitted of a full ring");
+    check(stats.dropped == 5, "dropped of a full ring");
+    check(stats.high_water == SAMPLE_PIPELINE_SLOTS, "high-water of a full ring");
+
+    // The oldest samples stay, the newest were dropped
+    last_number = -1;
+    received = 0;
+    sample_pipeline_add_consumer(&pipeline, consume, NULL);
+    check(sample_pipeline_drain(&pipeline, 0) == SAMPLE_PIPELINE_SLOTS, "drain of a full ring");
+    check(last_number == SAMPLE_PIPELINE_SLOTS - 1, "last sample of a full ring");
+    sample_pipeline_get_stats(&pipeline, &stats);
+    check(stats.consumed == SAMPLE_PIPELINE_SLOTS, "consumed of a full ring");
+}
+
+static void test_two_threads(void) {
+    sample_pipeline_init(&pipeline);
+    sample_pipeline_add_consumer(&pipeline, consume, NULL);
+    last_number = -1;
+    received = 0;
+    accepted = 0;
+    out_of_order = 0;
+
+    pthread_t threads[2];
+    pthread_create(&threads[0], NULL, consumer, NULL);
+    pthread_create(&threads[1], NULL, producer, NULL);
+    pthread_join(threads[1], NULL);
+    pthread_join(threads[0], NULL);
+
+    sample_pipeline_stats stats;
+    sample_pipeline_get_stats(&pipeline, &stats);
+    printf("%u samples: %lu accepted, %lu dropped, %lu consumed, high-water %lu/%d\n", STRESS_SAMPLES,
+           (unsigned long)stats.submitted, (unsigned long)stats.dropped, (unsigned long)stats.consumed,
+           (unsigned long)stats.high_water, SAMPLE_PIPELINE_SLOTS);
+    check(out_of_order == 0, "samples in order and untorn");
+    check(stats.submitted == accepted, "submitted counts the accepted samples");
+    check(stats.submitted + stats.dropped == STRESS_SAMPLES, "accepted + dropped = all samples");
+    check(stats.consumed == received && received == accepted, "every accepted sample consumed once");
+    check(stats.high_water <= SAMPLE_PIPELINE_SLOTS, "high-water within the ring");
+}
+
+int main(void) {
+    test_drop_count();
+    test_two_threads();
+    printf(failures ? "sample_pipeline: %d failures\n" : "sample_pipeline: OK\n", failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,99 @@
+// Host test of the text fast path (lib_ssd1306/ssd1306.c): every glyph of every
+// font is drawn once through ssd1306_BlitGlyph (the font's pre-transposed
+// columns from ssd1306_fonts_columns.h) and once through the per-pixel path
+// (the same font with columns = NULL), at every row the glyph fits and in both
+// colours, over a noisy background. The display RAM of the SSD1306 model must
+// come out identical, so the generated tables cannot drift from Font*.data.
+#include <stdio.h>
+#include <string.h>
+
+#include "host_models.h"
+#include "ssd1306.h"
+#include "ssd1306_fonts.h"
+
+static host_ssd1306 display;
+static uint8_t background[SSD1306_BUFFER_SIZE];
+static uint8_t expected[8][SSD1306_WIDTH];
+static int failures;
+
+// Draws one line of glyphs (from first, one cell apart) and returns the display RAM
+static void draw_line(SSD1306_Font_t font, char first, uint8_t y, SSD1306_COLOR color,
+                      uint8_t ram[8][SSD1306_WIDTH]) {
+    ssd1306_FillBuffer(background, sizeof(background));
+    for (uint8_t x = 0; x + font.width <= SSD1306_WIDTH && first + x / font.width <= 126; x += font.width) {
+        ssd1306_SetCursor(x, y);
+        ssd1306_WriteChar((char)(first + x / font.width), font, color);
+    }
+    ssd1306_UpdateScreenFull();
+    memcpy(ram, display.ram, sizeof(display.ram));
+}
+
+static void check_font(const char* name, SSD1306_Font_t fast) {
+    // Same font without the column table: WriteChar falls back to DrawPixel
+    SSD1306_Font_t slow = {fast.width, fast.height, fast.data, fast.char_width, NULL};
+    uint8_t per_line = SSD1306_WIDTH / fast.width;
+    uint32_t mismatches = 0;
+
+    for (uint8_t y = 0; y + fast.height <= SSD1306_HEIGHT; y++) {
+        for (int color = Black; color <= White; color++) {
+            for (int first = 32; first <= 126; first += per_line) {
+                uint8_t actual[8][SSD1306_WIDTH];
+                draw_line(slow, (char)first, y, (SSD1306_COLOR)color, expected);
+                draw_line(fast, (char)first, y, (SSD1306_COLOR)color, actual);
+                if (memcmp(actual, expected, sizeof(actual)) == 0) continue;
+
+                if (mismatches++ == 0) {
+                    for (int p = 0; p < 8; p++) {
+                        for (int x = 0; x < SSD1306_WIDTH; x++) {
+                            if (actual[p][x] == expected[p][x]) continue;
+                            printf("FAIL: %s '%c' y=%u %s: page %d column %d is 0x%02X, per-pixel 0x%02X\n",
+                                   name, first + x / fast.width, y, color == White ? "white" : "black",
+                                   p, x, actual[p][x], expected[p][x]);
+                            p = 8;
+                            break;
+                        }
+                    }
+                }
+            }
+        }
+    }
+    if (mismatches) {
+        printf("FAIL: %s: %u lines differ\n", name, (unsigned)mismatches);
+        failures++;
+    }
+}
+
+int main(void) {
+    host_ssd1306_init(&display, SSD1306_I2C_PORT, SSD1306_I2C_ADDR);
+    ssd1306_Init();
+
+    // Fixed pseudo-random background, so writes outside the cell show up
+    uint32_t seed = 0x12345678;
+    for (size_t i = 0; i < sizeof(background); i++) {
+        seed = seed * 1103515245u + 12345u;
+        background[i] = (uint8_t)(seed >> 16);
+    }
+
+#ifdef SSD1306_INCLUDE_FONT_6x8
+    check_font("Font_6x8", Font_6x8);
+#endif
+#ifdef SSD1306_INCLUDE_FONT_7x10
+    check_font("Font_7x10", Font_7x10);
+#endif
+#ifdef SSD1306_INCLUDE_FONT_11x18
+    check_font("Font_11x18", Font_11x18);
+#endif
+#ifdef SSD1306_INCLUDE_FONT_16x26
+    check_font("Font_16x26", Font_16x26);
+#endif
+#ifdef SSD1306_INCLUDE_FONT_16x24
+    check_font("Font_16x24", Font_16x24);
+#endif
+#ifdef SSD1306_INCLUDE_FONT_16x15
+    check_font("Font_16x15", Font_16x15);
+#endif
+
+    if (failures) return 1;
+    printf("ssd1306 glyphs: fast path matches the per-pixel path\n");
+    return 0;
+}
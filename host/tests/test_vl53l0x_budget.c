@@ -0,0 +1,126 @@
+// Host test of the VL53L0X timing budget math (vl53l0x.c): a register file on
+// the simulated I2C bus holds fixed sequence step, VCSEL period and timeout
+// registers, and the budgets read back and the FINAL_RANGE timeout written to
+// 0x71 are checked against numbers worked out with the ST API formulas
+// (VL53L0X_GetMeasurementTimingBudgetMicroSeconds and its Set counterpart).
+#include <stdio.h>
+#include <string.h>
+
+#include "host_hal.h"
+#include "vl53l0x.h"
+
+// Register file: the first written byte selects the index, which then auto-increments
+typedef struct {
+    host_i2c_device i2c;
+    uint8_t regs[256];
+    uint8_t index;
+} register_file;
+
+static bool regs_write(host_i2c_device* device, const uint8_t* data, size_t length) {
+    register_file* file = (register_file*)device;
+    if (length == 0) return true;
+    file->index = data[0];
+    for (size_t i = 1; i < length; i++) file->regs[file->index++] = data[i];
+    return true;
+}
+
+static bool regs_read(host_i2c_device* device, uint8_t* data, size_t length) {
+    register_file* file = (register_file*)device;
+    for (size_t i = 0; i < length; i++) data[i] = file->regs[file->index++];
+    return true;
+}
+
+static register_file sensor = {
+    .i2c = {.address = ADDRESS_VL53L0X, .write = regs_write, .read = regs_read},
+};
+static vl53l0x_device device;
+static int failures;
+
+static void check_u32(uint32_t actual, uint32_t expected, const char* what) {
+    if (actual != expected) {
+        printf("FAIL: %s: got %u, expected %u\n", what, (unsigned)actual, (unsigned)expected);
+        failures++;
+    }
+}
+
+static uint16_t final_range_reg(void) {
+    return (uint16_t)(sensor.regs[0x71] << 8 | sensor.regs[0x72]);
+}
+
+// Fixed register image shared by both cases; only SYSTEM_SEQUENCE_CONFIG differs
+//   0x46 MSRC_CONFIG_TIMEOUT_MACROP              0x2C    -> 45 MCLKs
+//   0x50 PRE_RANGE_CONFIG_VCSEL_PERIOD           0x06    -> 14 PCLKs, 53384 ns macro period
+//   0x51 PRE_RANGE_CONFIG_TIMEOUT_MACROP_HI      0x0096  -> 151 MCLKs
+//   0x70 FINAL_RANGE_CONFIG_VCSEL_PERIOD         0x04    -> 10 PCLKs, 38131 ns macro period
+//   0x71 FINAL_RANGE_CONFIG_TIMEOUT_MACROP_HI    0x0285  -> 533 MCLKs (382 past the pre-range)
+// so MSRC takes 2402 us and the pre-range 8061 us.
+static void load_registers(uint8_t sequence_config) {
+    memset(sensor.regs, 0, sizeof(sensor.regs));
+    sensor.regs[0x01] = sequence_config;
+    sensor.regs[0x46] = 0x2C;
+    sensor.regs[0x50] = 0x06;
+    sensor.regs[0x51] = 0x00;
+    sensor.regs[0x52] = 0x96;
+    sensor.regs[0x70] = 0x04;
+    sensor.regs[0x71] = 0x02;
+    sensor.regs[0x72] = 0x85;
+}
+
+typedef struct {
+    uint32_t budget_us;         // Requested budget
+    uint16_t final_range_reg;   // Encoded timeout the ST API writes to 0x71
+    uint32_t read_back_us;      // Budget the ST API reports afterwards
+} budget_case;
+
+static void check_config(const char* name, uint8_t sequence_config, uint32_t initial_us,
+                         const budget_case* cases, size_t count) {
+    char what[96];
+    load_registers(sequence_config);
+
+    snprintf(what, sizeof(what), "%s: budget from the register image", name);
+    check_u32(vl53l0x_get_timing_budget_us(&device), initial_us, what);
+
+    for (size_t i = 0; i < count; i++) {
+        snprintf(what, sizeof(what), "%s: set %u us accepted", name, (unsigned)cases[i].budget_us);
+        check_u32(vl53l0x_set_timing_budget_us(&device, cases[i].budget_us), true, what);
+        snprintf(what, sizeof(what), "%s: 0x71 for %u us", name, (unsigned)cases[i].budget_us);
+        check_u32(final_range_reg(), cases[i].final_range_reg, what);
+        snprintf(what, sizeof(what), "%s: budget read back after %u us", name, (unsigned)cases[i].budget_us);
+        check_u32(vl53l0x_get_timing_budget_us(&device), cases[i].read_back_us, what);
+    }
+
+    // Below the minimum nothing is written
+    uint16_t before = final_range_reg();
+    snprintf(what, sizeof(what), "%s: 19999 us rejected", name);
+    check_u32(vl53l0x_set_timing_budget_us(&device, VL53L0X_MIN_TIMING_BUDGET_US - 1), false, what);
+    snprintf(what, sizeof(what), "%s: 0x71 kept after a rejected budget", name);
+    check_u32(final_range_reg(), before, what);
+}
+
+int main(void) {
+    host_i2c_attach(i2c0, &sensor.i2c);
+    device.i2c = i2c0;
+    device.address = ADDRESS_VL53L0X;
+
+    // 0xE8: DSS, PRE_RANGE and FINAL_RANGE (the configuration vl53l0x_boot leaves)
+    // Fixed part: 1910 + 960 + 2 * (2402 + 690) + (8061 + 660) = 17775 us
+    static const budget_case dss_cases[] = {
+        {20000, 0x00C2, 20003},
+        {33000, 0x0285, 32891},
+        {200000, 0x0599, 199295},
+    };
+    check_config("DSS", 0xE8, 32891, dss_cases, sizeof(dss_cases) / sizeof(dss_cases[0]));
+
+    // 0xD4: TCC, MSRC, PRE_RANGE and FINAL_RANGE
+    // Fixed part: 1910 + 960 + (2402 + 590) + (2402 + 660) + (8061 + 660) = 17645 us
+    static const budget_case msrc_cases[] = {
+        {20000, 0x00C5, 19987},
+        {33000, 0x0286, 32914},
+        {200000, 0x0599, 199165},
+    };
+    check_config("TCC+MSRC", 0xD4, 32761, msrc_cases, sizeof(msrc_cases) / sizeof(msrc_cases[0]));
+
+    if (failures) return 1;
+    printf("vl53l0x budget: all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,272 @@
+// Host test of the non-blocking reading state machine (vl53l0x.c): a fake
+// sensor on the simulated I2C bus only flags a sample when the test publishes
+// one, so vl53l0x_poll_sample must report NOT_READY until then, SAMPLE with the
+// decoded result block once, and TIMEOUT when time_timeout passes without one.
+// Each path is checked: direct I2C, the DMA queue (async_step), and GPIO1 with
+// and without the queue. The I2C bytes each sample costs are printed per path.
+#include <stdio.h>
+#include <string.h>
+
+#include "hardware/sync.h"
+#include "host_hal.h"
+#include "pico/stdlib.h"
+#include "vl53l0x.h"
+
+#define GPIO1_PIN 8
+#define TIMEOUT_MS 100
+
+// Fake sensor: a register file whose first written byte selects the index,
+// with RESULT_INTERRUPT_STATUS (0x13) and GPIO1 driven by the test
+typedef struct {
+    host_i2c_device i2c;
+    uint8_t regs[256];
+    uint8_t index;
+    int gpio1_pin;              // -1 = GPIO1 not wired
+    uint32_t clears;            // Writes to SYSTEM_INTERRUPT_CLEAR (0x0B) that landed
+    uint32_t nack_clears;       // Next clears to NACK, as a glitching bus would
+    uint64_t publish_at_ns;     // Time at which the listener publishes a sample (0 = none)
+} fake_sensor;
+
+static bool sensor_write(host_i2c_device* device, const uint8_t* data, size_t length) {
+    fake_sensor* sensor = (fake_sensor*)device;
+    if (length == 0) return true;
+    if (data[0] == 0x0B && length > 1) {
+        if (sensor->nack_clears) {
+            sensor->nack_clears--;
+            return false;
+        }
+        sensor->clears++;
+        sensor->regs[0x13] = 0;
+        if (sensor->gpio1_pin >= 0) host_gpio_drive((uint)sensor->gpio1_pin, true);
+        return true;
+    }
+    sensor->index = data[0];
+    for (size_t i = 1; i < length; i++) sensor->regs[sensor->index++] = data[i];
+    return true;
+}
+
+static bool sensor_read(host_i2c_device* device, uint8_t* data, size_t length) {
+    fake_sensor* sensor = (fake_sensor*)device;
+    for (size_t i = 0; i < length; i++) data[i] = sensor->regs[sensor->index++];
+    return true;
+}
+
+static fake_sensor sensor = {
+    .i2c = {.address = ADDRESS_VL53L0X, .write = sensor_write, .read = sensor_read},
+    .gpio1_pin = -1,
+};
+static i2c_queue queue;
+static int failures;
+
+static void check(bool condition, const char* path, const char* what) {
+    if (!condition) {
+        printf("FAIL: %s: %s\n", path, what);
+        failures++;
+    }
+}
+
+// Completes a measurement: result block from 0x14, status flag, GPIO1 low
+static void publish(uint16_t distance_mm) {
+    uint8_t* result = &sensor.regs[0x14];
+    memset(result, 0, 12);
+    result[0] = VL53L0X_RANGE_STATUS_VALID << 3;
+    result[2] = 0x0A;                   // 10.5 effective SPADs
+    result[3] = 0x80;
+    result[6] = 0x12;                   // Signal rate
+    result[7] = 0x34;
+    result[8] = 0x00;                   // Ambient rate
+    result[9] = 0x56;
+    result[10] = (uint8_t)(distance_mm >> 8);
+    result[11] = (uint8_t)distance_mm;
+    sensor.regs[0x13] = 0x04;
+    if (sensor.gpio1_pin >= 0) host_gpio_drive((uint)sensor.gpio1_pin, false);
+}
+
+// Publishes a sample in the middle of a blocking wait
+static void publish_listener(uint64_t now_ns, void* context) {
+    (void)context;
+    if (sensor.publish_at_ns && now_ns >= sensor.publish_at_ns) {
+        sensor.publish_at_ns = 0;
+        publish(1000);
+    }
+}
+
+// Polls every millisecond until something other than NOT_READY comes back
+static vl53l0x_poll_result poll_until(vl53l0x_device* device, vl53l0x_sample* sample, uint32_t max_polls) {
+    for (uint32_t i = 0; i < max_polls; i++) {
+        vl53l0x_poll_result result = vl53l0x_poll_sample(device, sample);
+        if (result != VL53L0X_NOT_READY) return result;
+        sleep_ms(1);
+    }
+    return VL53L0X_NOT_READY;
+}
+
+static void check_sample(const vl53l0x_sample* sample, uint16_t distance_mm, const char* path) {
+    check(sample->distance_mm == distance_mm, path, "distance_mm decoded");
+    check(sample->range_status == VL53L0X_RANGE_STATUS_VALID, path, "range_status decoded");
+    check(sample->effective_spads == 0x0A80, path, "effective_spads decoded");
+    check(sample->signal_rate == 0x1234, path, "signal_rate decoded");
+    check(sample->ambient_rate == 0x0056, path, "ambient_rate decoded");
+}
+
+// Lets queued transfers (the interrupt clear above all) reach the sensor
+static void settle(vl53l0x_device* device) {
+    if (device->queue) i2c_queue_wait_idle(device->queue);
+}
+
+// NOT_READY until 0x13 is set, one SAMPLE with the decoded block, then TIMEOUT
+static void check_poll(vl53l0x_device* device, const char* path) {
+    vl53l0x_sample sample;
+    memset(sensor.regs + 0x13, 0, 13);
+    sensor.clears = 0;
+
+    for (int i = 0; i < 20; i++) {
+        check(vl53l0x_poll_sample(device, &sample) == VL53L0X_NOT_READY, path, "NOT_READY before a sample");
+        sleep_ms(1);
+    }
+
+    uint64_t bytes_before = host_i2c_bus_bytes(i2c0);
+    uint32_t samples = 0;
+    for (uint16_t distance = 300; distance < 2000; distance += 170) {
+        publish(distance);
+        check(poll_until(device, &sample, 10) == VL53L0X_SAMPLE, path, "SAMPLE once 0x13 is set");
+        check_sample(&sample, distance, path);
+        settle(device);
+        check(sensor.regs[0x13] == 0, path, "interrupt cleared after the sample");
+        check(vl53l0x_poll_sample(device, &sample) == VL53L0X_NOT_READY, path, "no second SAMPLE for one result");
+        samples++;
+    }
+    printf("%s: %.1f I2C bytes per sample\n", path,
+           (double)(host_i2c_bus_bytes(i2c0) - bytes_before) / samples);
+    check(sensor.clears == samples, path, "one interrupt clear per sample");
+
+    // No sample: TIMEOUT once time_timeout has passed since the first poll
+    settle(device);
+    uint32_t start = to_ms_since_boot(get_absolute_time());
+    uint32_t clears = sensor.clears;
+    vl53l0x_poll_result result = poll_until(device, &sample, 2 * TIMEOUT_MS);
+    uint32_t waited = to_ms_since_boot(get_absolute_time()) - start;
+    check(result == VL53L0X_TIMEOUT, path, "TIMEOUT without a sample");
+    check(waited >= TIMEOUT_MS && waited <= TIMEOUT_MS + 5, path, "TIMEOUT after time_timeout");
+    if (device->use_interrupt) {
+        settle(device);
+        check(sensor.clears == clears + 1, path, "interrupt cleared again on TIMEOUT");
+    }
+    check(vl53l0x_poll_sample(device, &sample) == VL53L0X_NOT_READY, path, "wait restarts after TIMEOUT");
+
+    // A sample after a timeout is read as usual
+    publish(1500);
+    check(poll_until(device, &sample, 10) == VL53L0X_SAMPLE, path, "SAMPLE after a TIMEOUT");
+    check_sample(&sample, 1500, path);
+    settle(device);
+}
+
+// vl53l0x_read_sample: a sample published while it waits, then a timeout
+static void check_read_sample(vl53l0x_device* device, const char* path) {
+    vl53l0x_sample sample;
+    sensor.publish_at_ns = host_clock_ns() + 30 * 1000000ull;
+    check(vl53l0x_read_sample(device, &sample), path, "read_sample gets the published sample");
+    check_sample(&sample, 1000, path);
+    check(!vl53l0x_read_sample(device, &sample), path, "read_sample times out without a sample");
+}
+
+// GPIO1: a NACKed clear leaves GPIO1 low, so no falling edge flags the next sample
+static void check_lost_clear(vl53l0x_device* device, const char* path) {
+    vl53l0x_sample sample;
+    sensor.nack_clears = 1;
+    publish(700);
+    check(poll_until(device, &sample, 10) == VL53L0X_SAMPLE, path, "SAMPLE whose clear is NACKed");
+    settle(device);
+    check(sensor.regs[0x13] != 0, path, "NACKed clear leaves the interrupt set");
+
+    publish(800);
+    check(poll_until(device, &sample, 10) == VL53L0X_SAMPLE, path, "SAMPLE with GPIO1 held low");
+    check_sample(&sample, 800, path);
+    settle(device);
+    check(sensor.regs[0x13] == 0, path, "interrupt cleared by the next sample");
+}
+
+// Filler transfers: writes to a scratch register range
+static const uint8_t filler[8] = {0xC0};
+
+static bool fill_queue(void) {
+    i2c_transfer transfer = {.address = ADDRESS_VL53L0X, .write_data = filler, .write_length = sizeof(filler)};
+    for (int i = 0; i <= I2C_QUEUE_DEPTH; i++) {
+        if (!i2c_queue_submit(&queue, &transfer)) return true;
+    }
+    return false;
+}
+
+// Queue: the clear cannot be queued while the queue is full. The sample waits
+// for it, instead of coming back with the sensor still flagging it. With
+// interrupts off no transfer completes, so the queue stays full meanwhile.
+static void check_full_queue(vl53l0x_device* device, int reads, const char* path) {
+    vl53l0x_sample sample;
+    publish(900);
+    // The status read (status-poll mode) and the result burst, each to completion
+    for (int i = 0; i < reads; i++) {
+        check(vl53l0x_poll_sample(device, &sample) == VL53L0X_NOT_READY, path, "NOT_READY while reading");
+        while (!device->async_done) sleep_us(20);
+    }
+    uint32_t irq_state = save_and_disable_interrupts();
+    check(fill_queue(), path, "queue filled");
+    check(vl53l0x_poll_sample(device, &sample) == VL53L0X_NOT_READY, path, "no SAMPLE before its clear is queued");
+    restore_interrupts(irq_state);
+    i2c_queue_wait_idle(&queue);
+    check(sensor.regs[0x13] != 0, path, "interrupt still set after the queue drained");
+
+    check(vl53l0x_poll_sample(device, &sample) == VL53L0X_SAMPLE, path, "SAMPLE once the clear is queued");
+    check_sample(&sample, 900, path);
+    settle(device);
+    check(sensor.regs[0x13] == 0, path, "interrupt cleared");
+    check(vl53l0x_poll_sample(device, &sample) == VL53L0X_NOT_READY, path, "the held sample is returned once");
+}
+
+static void setup_device(vl53l0x_device* device) {
+    memset(device, 0, sizeof(*device));
+    device->i2c = i2c0;
+    device->address = ADDRESS_VL53L0X;
+    device->time_timeout = TIMEOUT_MS;
+}
+
+int main(void) {
+    static vl53l0x_device polled, interrupt, polled_queued, interrupt_queued;
+    i2c_init(i2c0, 400 * 1000);
+    host_i2c_attach(i2c0, &sensor.i2c);
+    host_clock_add_listener(publish_listener, NULL);
+
+    setup_device(&polled);
+    check_poll(&polled, "direct");
+    check_read_sample(&polled, "direct");
+
+    sensor.gpio1_pin = GPIO1_PIN;
+    host_gpio_drive(GPIO1_PIN, true);
+    setup_device(&interrupt);
+    check(vl53l0x_enable_gpio1_interrupt(&interrupt, GPIO1_PIN), "gpio1", "interrupt mode enabled");
+    check_poll(&interrupt, "gpio1");
+    check_read_sample(&interrupt, "gpio1");
+    check_lost_clear(&interrupt, "gpio1");
+    gpio_set_irq_enabled(GPIO1_PIN, GPIO_IRQ_EDGE_FALL, false);
+
+    if (!i2c_queue_init(&queue, i2c0)) {
+        printf("FAIL: no DMA channels for the queue\n");
+        return 1;
+    }
+    sensor.gpio1_pin = -1;
+    setup_device(&polled_queued);
+    vl53l0x_use_queue(&polled_queued, &queue);
+    check_poll(&polled_queued, "queue");
+    check_full_queue(&polled_queued, 2, "queue");
+
+    sensor.gpio1_pin = GPIO1_PIN;
+    setup_device(&interrupt_queued);
+    vl53l0x_use_queue(&interrupt_queued, &queue);
+    check(vl53l0x_enable_gpio1_interrupt(&interrupt_queued, GPIO1_PIN), "gpio1+queue", "interrupt mode enabled");
+    check_poll(&interrupt_queued, "gpio1+queue");
+    check_lost_clear(&interrupt_queued, "gpio1+queue");
+    check_full_queue(&interrupt_queued, 1, "gpio1+queue");
+
+    if (failures) return 1;
+    printf("vl53l0x poll: all checks passed\n");
+    return 0;
+}
@@ -4,12 +4,12 @@
 #include <string.h>     // For string manipulation
 
 // Bibliotecas do projeto
-#include "lib\FatFs_SPI\include\my_debug.h"   // Custom library for debugging
-#include "lib\FatFs_SPI\sd_driver\hw_config.h"  // Project-specific hardware configuration
+#include "lib/FatFs_SPI/include/my_debug.h"   // Custom library for debugging
+#include "lib/FatFs_SPI/sd_driver/hw_config.h"  // Project-specific hardware configuration
 
 // Bibliotecas do sistema de arquivos FAT
-#include "lib\FatFs_SPI\ff15\source\ff.h"         // Integer types and functions of the FAT file system
-#include "lib\FatFs_SPI\ff15\source\diskio.h"     // Disk access function declarations
+#include "lib/FatFs_SPI/ff15/source/ff.h"         // Integer types and functions of the FAT file system
+#include "lib/FatFs_SPI/ff15/source/diskio.h"     // Disk access function declarations
 
 /* 
 Assumed hardware configuration for SPI communication with MicroSD card:
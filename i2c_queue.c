@@ -0,0 +1,251 @@
+#include "i2c_queue.h"
+#include "pico/stdlib.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+#include "hardware/sync.h"
+#include <string.h>
+
+// Queues attached to i2c0 and i2c1, for the interrupt handlers
+static i2c_queue* active_queues[2];
+
+// ========================== Auxiliary functions ==========================
+
+// Number of transactions waiting or running
+static inline uint32_t queue_depth(const i2c_queue* queue) {
+    return queue->head - queue->tail;
+}
+
+// Loads the next transaction into the controller and starts both DMA channels.
+// Called with the queue lock held.
+static void start_next(i2c_queue* queue) {
+    if (queue_depth(queue) == 0) {
+        queue->busy = false;
+        return;
+    }
+
+    const i2c_transfer* transfer = &queue->transfers[queue->tail % I2C_QUEUE_DEPTH];
+    i2c_hw_t* hw = i2c_get_hw(queue->i2c);
+    size_t count = 0;
+
+    // One IC_DATA_CMD word per byte: data bits for writes, CMD for reads,
+    // RESTART where the direction changes and STOP on the last byte
+    for (size_t i = 0; i < transfer->write_length; i++) {
+        queue->commands[count++] = transfer->write_data[i];
+    }
+    for (size_t i = 0; i < transfer->read_length; i++) {
+        uint16_t command = I2C_IC_DATA_CMD_CMD_BITS;
+        if (i == 0 && transfer->write_length > 0) command |= I2C_IC_DATA_CMD_RESTART_BITS;
+        queue->commands[count++] = command;
+    }
+    queue->commands[count - 1] |= I2C_IC_DATA_CMD_STOP_BITS;
+
+    // The target address can only change while the controller is disabled
+    hw->enable = 0;
+    hw->tar = transfer->address;
+    hw->enable = I2C_IC_ENABLE_ENABLE_BITS;
+
+    (void)hw->clr_tx_abrt;
+    (void)hw->clr_stop_det;
+    queue->aborted = false;
+    queue->busy = true;
+
+    if (transfer->read_length > 0) {
+        dma_channel_config rx = dma_channel_get_default_config(queue->rx_channel);
+        channel_config_set_transfer_data_size(&rx, DMA_SIZE_8);
+        channel_config_set_read_increment(&rx, false);
+        channel_config_set_write_increment(&rx, true);
+        channel_config_set_dreq(&rx, i2c_get_dreq(queue->i2c, false));
+        dma_channel_configure(queue->rx_channel, &rx, transfer->read_data, &hw->data_cmd,
+                              transfer->read_length, true);
+    }
+
+    // 16-bit writes to an APB register land on both halfwords; IC_DATA_CMD only
+    // uses the low 11 bits, so each DMA transfer is one complete command word
+    dma_channel_config tx = dma_channel_get_default_config(queue->tx_channel);
+    channel_config_set_transfer_data_size(&tx, DMA_SIZE_16);
+    channel_config_set_read_increment(&tx, true);
+    channel_config_set_write_increment(&tx, false);
+    channel_config_set_dreq(&tx, i2c_get_dreq(queue->i2c, true));
+    dma_channel_configure(queue->tx_channel, &tx, &hw->data_cmd, queue->commands, count, true);
+}
+
+// Ends the running transaction and starts the next one; returns its callback
+// so it can run after the lock is released. Called with the queue lock held.
+static i2c_transfer finish_current(i2c_queue* queue, bool* ok) {
+    i2c_transfer transfer = queue->transfers[queue->tail % I2C_QUEUE_DEPTH];
+    *ok = !queue->aborted;
+
+    if (*ok) {
+        // The last byte may still be on its way from the RX FIFO
+        while (transfer.read_length > 0 && dma_channel_is_busy(queue->rx_channel)) {
+            tight_loop_contents();
+        }
+        queue->stats.completed++;
+        queue->stats.bytes += transfer.write_length + transfer.read_length;
+    } else {
+        queue->stats.failed++;
+    }
+
+    queue->tail++;
+    start_next(queue);
+    return transfer;
+}
+
+// Shared by both controllers: STOP_DET ends every transaction, TX_ABRT marks it failed
+static void handle_irq(i2c_queue* queue) {
+    i2c_hw_t* hw = i2c_get_hw(queue->i2c);
+    uint32_t irq_state = spin_lock_blocking(queue->lock);
+    uint32_t status = hw->intr_stat;
+    bool finished = false, ok = false;
+    i2c_transfer transfer;
+
+    if (status & I2C_IC_INTR_STAT_R_TX_ABRT_BITS) {
+        // Stops feeding the FIFO before the abort is cleared, or the rest would be sent
+        dma_channel_abort(queue->tx_channel);
+        dma_channel_abort(queue->rx_channel);
+        queue->aborted = true;
+        (void)hw->clr_tx_abrt;
+    }
+
+    if (status & I2C_IC_INTR_STAT_R_STOP_DET_BITS) {
+        (void)hw->clr_stop_det;
+        if (queue->busy) {
+            transfer = finish_current(queue, &ok);
+            finished = true;
+        }
+    }
+    spin_unlock(queue->lock, irq_state);
+
+    // The callback may submit the next transaction itself
+    if (finished && transfer.callback) transfer.callback(ok, transfer.context);
+    // Wakes a core sleeping in i2c_queue_transfer_blocking or i2c_queue_wait_idle
+    __sev();
+}
+
+static void i2c0_irq_handler(void) {
+    if (active_queues[0]) handle_irq(active_queues[0]);
+}
+
+static void i2c1_irq_handler(void) {
+    if (active_queues[1]) handle_irq(active_queues[1]);
+}
+
+// ========================== Setup ==========================
+
+bool i2c_queue_init(i2c_queue* queue, i2c_inst_t* i2c) {
+    memset(queue, 0, sizeof(*queue));
+    queue->i2c = i2c;
+    queue->tx_channel = dma_claim_unused_channel(false);
+    queue->rx_channel = dma_claim_unused_channel(false);
+    queue->lock_num = spin_lock_claim_unused(false);
+    if (queue->tx_channel < 0 || queue->rx_channel < 0 || queue->lock_num < 0) {
+        // Hands back whatever was claimed before the shortage
+        i2c_queue_deinit(queue);
+        return false;
+    }
+    queue->lock = spin_lock_instance(queue->lock_num);
+
+    i2c_hw_t* hw = i2c_get_hw(i2c);
+    uint index = i2c_hw_index(i2c);
+    active_queues[index] = queue;
+
+    hw->dma_cr = I2C_IC_DMA_CR_TDMAE_BITS | I2C_IC_DMA_CR_RDMAE_BITS;
+    hw->intr_mask = I2C_IC_INTR_MASK_M_STOP_DET_BITS | I2C_IC_INTR_MASK_M_TX_ABRT_BITS;
+    irq_set_exclusive_handler(index == 0 ? I2C0_IRQ : I2C1_IRQ,
+                              index == 0 ? i2c0_irq_handler : i2c1_irq_handler);
+    irq_set_enabled(index == 0 ? I2C0_IRQ : I2C1_IRQ, true);
+    return true;
+}
+
+void i2c_queue_deinit(i2c_queue* queue) {
+    uint index = i2c_hw_index(queue->i2c);
+    if (active_queues[index] == queue) {
+        i2c_hw_t* hw = i2c_get_hw(queue->i2c);
+        irq_set_enabled(index == 0 ? I2C0_IRQ : I2C1_IRQ, false);
+        irq_remove_handler(index == 0 ? I2C0_IRQ : I2C1_IRQ,
+                           index == 0 ? i2c0_irq_handler : i2c1_irq_handler);
+        hw->intr_mask = 0;
+        hw->dma_cr = 0;
+        active_queues[index] = NULL;
+    }
+
+    if (queue->tx_channel >= 0) dma_channel_unclaim(queue->tx_channel);
+    if (queue->rx_channel >= 0) dma_channel_unclaim(queue->rx_channel);
+    if (queue->lock_num >= 0) spin_lock_unclaim(queue->lock_num);
+    queue->tx_channel = queue->rx_channel = queue->lock_num = -1;
+    queue->lock = NULL;
+}
+
+// ========================== Submitting ==========================
+
+bool i2c_queue_submit(i2c_queue* queue, const i2c_transfer* transfer) {
+    size_t length = transfer->write_length + transfer->read_length;
+    if (length == 0 || length > I2C_QUEUE_MAX_BYTES) return false;
+
+    // The handler (possibly on the other core) also moves tail and starts transactions
+    uint32_t irq_state = spin_lock_blocking(queue->lock);
+    if (queue_depth(queue) == I2C_QUEUE_DEPTH) {
+        spin_unlock(queue->lock, irq_state);
+        return false;
+    }
+
+    queue->transfers[queue->head % I2C_QUEUE_DEPTH] = *transfer;
+    queue->head++;
+    if (queue_depth(queue) > queue->stats.high_water) {
+        queue->stats.high_water = queue_depth(queue);
+    }
+    if (!queue->busy) start_next(queue);
+
+    spin_unlock(queue->lock, irq_state);
+    return true;
+}
+
+// Completion flag for the blocking wrapper
+typedef struct {
+    volatile bool done;
+    volatile bool ok;
+} blocking_result;
+
+static void blocking_callback(bool ok, void* context) {
+    blocking_result* result = context;
+    result->ok = ok;
+    result->done = true;
+}
+
+bool i2c_queue_transfer_blocking(i2c_queue* queue, uint8_t address, const uint8_t* write_data,
+                                 size_t write_length, uint8_t* read_data, size_t read_length) {
+    blocking_result result = {false, false};
+    i2c_transfer transfer = {
+        .address = address,
+        .write_data = write_data,
+        .write_length = write_length,
+        .read_data = read_data,
+        .read_length = read_length,
+        .callback = blocking_callback,
+        .context = &result,
+    };
+
+    // A full queue drains by itself, so waiting for a free slot cannot deadlock
+    while (!i2c_queue_submit(queue, &transfer)) {
+        if (write_length + read_length == 0 || write_length + read_length > I2C_QUEUE_MAX_BYTES) return false;
+        __wfe();
+    }
+    while (!result.done) __wfe();
+    return result.ok;
+}
+
+// ========================== Status ==========================
+
+bool i2c_queue_idle(i2c_queue* queue) {
+    return queue_depth(queue) == 0;
+}
+
+void i2c_queue_wait_idle(i2c_queue* queue) {
+    while (!i2c_queue_idle(queue)) __wfe();
+}
+
+void i2c_queue_get_stats(i2c_queue* queue, i2c_queue_stats* stats) {
+    uint32_t irq_state = spin_lock_blocking(queue->lock);
+    *stats = queue->stats;
+    spin_unlock(queue->lock, irq_state);
+}
@@ -0,0 +1,84 @@
+#ifndef I2C_QUEUE_H
+#define I2C_QUEUE_H
+
+// Queue of I2C transactions run by DMA on one I2C controller. Each transaction
+// is an optional write followed by an optional read (with a repeated start),
+// and calls its callback from the I2C interrupt when it completes.
+#include <stdbool.h>     // Allows the use of the bool type (true/false)
+#include <stddef.h>      // Allows the use of size_t
+#include <stdint.h>      // Allows the use of types like uint8_t, uint16_t, etc.
+
+#include "hardware/i2c.h"
+#include "hardware/sync.h"
+
+// Number of transactions that can wait in one queue
+#ifndef I2C_QUEUE_DEPTH
+#define I2C_QUEUE_DEPTH 16
+#endif
+
+// Largest transaction (write + read bytes); one OLED page is 129 bytes
+#ifndef I2C_QUEUE_MAX_BYTES
+#define I2C_QUEUE_MAX_BYTES 160
+#endif
+
+// Function called from the I2C interrupt when a transaction ends
+typedef void (*i2c_queue_callback)(bool ok, void* context);
+
+// Description of one transaction; the buffers must stay valid until the callback runs
+typedef struct {
+    uint8_t address;            // 7-bit device address
+    const uint8_t* write_data;  // Bytes to send first (may be NULL)
+    size_t write_length;
+    uint8_t* read_data;         // Buffer for the bytes read afterwards (may be NULL)
+    size_t read_length;
+    i2c_queue_callback callback; // Completion callback (may be NULL)
+    void* context;
+} i2c_transfer;
+
+// Counters reported by i2c_queue_get_stats
+typedef struct {
+    uint32_t completed;         // Transactions finished with ACKs everywhere
+    uint32_t failed;            // Transactions aborted by a NACK
+    uint32_t bytes;             // Bytes clocked by completed transactions
+    uint32_t high_water;        // Highest number of queued transactions
+} i2c_queue_stats;
+
+// Structure representing the queue of one I2C controller
+typedef struct {
+    i2c_inst_t* i2c;
+    spin_lock_t* lock;          // Guards the queue against the handler and the other core
+    int lock_num;               // Number of that spin lock, released by i2c_queue_deinit
+    int tx_channel;             // DMA channel feeding IC_DATA_CMD with command words
+    int rx_channel;             // DMA channel draining IC_DATA_CMD into the read buffer
+    i2c_transfer transfers[I2C_QUEUE_DEPTH];
+    volatile uint32_t head;     // Next free slot
+    volatile uint32_t tail;     // Transaction running or next to run
+    volatile bool busy;         // True while a transaction is on the bus
+    volatile bool aborted;      // TX_ABRT seen for the running transaction
+    uint16_t commands[I2C_QUEUE_MAX_BYTES]; // IC_DATA_CMD words of the running transaction
+    i2c_queue_stats stats;
+} i2c_queue;
+
+// Function to attach a queue to an I2C controller already set up with i2c_init
+bool i2c_queue_init(i2c_queue* queue, i2c_inst_t* i2c);
+
+// Function to detach an idle queue: disables its interrupt and releases the DMA channels and the spin lock
+void i2c_queue_deinit(i2c_queue* queue);
+
+// Function to queue a transaction; returns false when the queue is full or the transaction too long
+bool i2c_queue_submit(i2c_queue* queue, const i2c_transfer* transfer);
+
+// Function to run a write/read transaction and wait for it (not from a queue callback)
+bool i2c_queue_transfer_blocking(i2c_queue* queue, uint8_t address, const uint8_t* write_data,
+                                 size_t write_length, uint8_t* read_data, size_t read_length);
+
+// Function to check whether every queued transaction has completed
+bool i2c_queue_idle(i2c_queue* queue);
+
+// Function to wait until every queued transaction has completed
+void i2c_queue_wait_idle(i2c_queue* queue);
+
+// Function to read the counters
+void i2c_queue_get_stats(i2c_queue* queue, i2c_queue_stats* stats);
+
+#endif // I2C_QUEUE_H
@@ -11,14 +11,23 @@
 /* Allocate/Free a Memory Block                                           */
 /*------------------------------------------------------------------------*/
 
-#include <stdlib.h>		/* with POSIX API */
+#include "ff_pool.h"	/* Fixed-size blocks instead of the heap */
+
+/* Size of the LFN working buffer INIT_NAMBUF asks for (see ff.c) */
+#if FF_FS_EXFAT
+#define LFN_BUF_SIZE	((FF_MAX_LFN + 1) * 2 + (FF_MAX_LFN + 44U) / 15 * 32)
+#else
+#define LFN_BUF_SIZE	((FF_MAX_LFN + 1) * 2)
+#endif
+
+FF_POOL_DEFINE(ff_lfn_pool, LFN_BUF_SIZE, FF_POOL_LFN_BLOCKS);
 
 
 void* ff_memalloc (	/* Returns pointer to the allocated memory block (null if not enough core) */
 	UINT msize		/* Number of bytes to allocate */
 )
 {
-	return malloc((size_t)msize);	/* Allocate a new memory block */
+	return ff_pool_alloc(&ff_lfn_pool, (size_t)msize);	/* Allocate a new memory block */
 }
 
 
@@ -26,7 +35,7 @@ void ff_memfree (
 	void* mblock	/* Pointer to the memory block to free (no effect if null) */
 )
 {
-	free(mblock);	/* Free the memory block */
+	ff_pool_free(&ff_lfn_pool, mblock);	/* Free the memory block */
 }
 
 #endif
@@ -39,7 +48,7 @@ void ff_memfree (
 /* Definitions of Mutex                                                   */
 /*------------------------------------------------------------------------*/
 
-#define OS_TYPE	0	/* 0:Win32, 1:uITRON4.0, 2:uC/OS-II, 3:FreeRTOS, 4:CMSIS-RTOS */
+#define OS_TYPE	5	/* 0:Win32, 1:uITRON4.0, 2:uC/OS-II, 3:FreeRTOS, 4:CMSIS-RTOS, 5:Pico SDK */
 
 
 #if   OS_TYPE == 0	/* Win32 */
@@ -64,6 +73,14 @@ static SemaphoreHandle_t Mutex[FF_VOLUMES + 1];	/* Table of mutex handle */
 #include "cmsis_os.h"
 static osMutexId Mutex[FF_VOLUMES + 1];	/* Table of mutex ID */
 
+#elif OS_TYPE == 5	/* Pico SDK: both cores, FF_FS_TIMEOUT in ms */
+#include "pico/mutex.h"
+#include "pico/platform.h"
+#include "pico/time.h"
+#include "ff_sync.h"
+static mutex_t Mutex[FF_VOLUMES + 1];	/* Table of mutexes */
+static ff_mutex_stats_t MutexStats[FF_VOLUMES + 1];	/* Contention of each mutex */
+
 #endif
 
 
@@ -106,6 +123,10 @@ int ff_mutex_create (	/* Returns 1:Function succeeded or 0:Could not create the
 	Mutex[vol] = osMutexCreate(osMutex(cmsis_os_mutex));
 	return (int)(Mutex[vol] != NULL);
 
+#elif OS_TYPE == 5	/* Pico SDK */
+	if (!mutex_is_initialized(&Mutex[vol])) mutex_init(&Mutex[vol]);	/* Kept across f_mount calls */
+	return 1;
+
 #endif
 }
 
@@ -138,6 +159,9 @@ void ff_mutex_delete (	/* Returns 1:Function succeeded or 0:Could not delete due
 #elif OS_TYPE == 4	/* CMSIS-RTOS */
 	osMutexDelete(Mutex[vol]);
 
+#elif OS_TYPE == 5	/* Pico SDK: nothing to free, the mutex is reused by the next f_mount */
+	(void)vol;
+
 #endif
 }
 
@@ -171,6 +195,28 @@ int ff_mutex_take (	/* Returns 1:Succeeded or 0:Timeout */
 #elif OS_TYPE == 4	/* CMSIS-RTOS */
 	return (int)(osMutexWait(Mutex[vol], FF_FS_TIMEOUT) == osOK);
 
+#elif OS_TYPE == 5	/* Pico SDK */
+	ff_mutex_stats_t *st = &MutexStats[vol];
+	if (__get_current_exception()) {	/* In a handler the owner may be the interrupted code of this core */
+		st->irq_refusals++;
+		return 0;
+	}
+	if (mutex_try_enter(&Mutex[vol], NULL)) {	/* Free: the usual case */
+		st->takes++;
+		return 1;
+	}
+	uint64_t start_us = time_us_64();
+	if (!mutex_enter_timeout_ms(&Mutex[vol], FF_FS_TIMEOUT)) {
+		st->timeouts++;		/* Counted without the lock: may rarely miss one */
+		return 0;
+	}
+	uint32_t wait_us = (uint32_t)(time_us_64() - start_us);
+	st->takes++;
+	st->contended++;
+	st->wait_us += wait_us;
+	if (wait_us > st->max_wait_us) st->max_wait_us = wait_us;
+	return 1;
+
 #endif
 }
 
@@ -201,7 +247,27 @@ void ff_mutex_give (
 #elif OS_TYPE == 4	/* CMSIS-RTOS */
 	osMutexRelease(Mutex[vol]);
 
+#elif OS_TYPE == 5	/* Pico SDK */
+	mutex_exit(&Mutex[vol]);
+
 #endif
 }
 
+
+#if OS_TYPE == 5
+/*------------------------------------------------------------------------*/
+/* Contention Counters of a Mutex                                         */
+/*------------------------------------------------------------------------*/
+
+int ff_mutex_get_stats (	/* Returns 1:Succeeded or 0:Wrong ID */
+	int vol,				/* Mutex ID: Volume mutex (0 to FF_VOLUMES - 1) or system mutex (FF_VOLUMES) */
+	ff_mutex_stats_t* stats	/* Copy of the counters */
+)
+{
+	if (vol < 0 || vol > FF_VOLUMES) return 0;
+	*stats = MutexStats[vol];
+	return 1;
+}
+#endif
+
 #endif	/* FF_FS_REENTRANT */
@@ -0,0 +1,75 @@
+/* disk_cache.h
+Write-back sector cache between FatFs and the sd_card_t drivers.
+
+glue.c passes single-sector reads and writes through an N-way set-associative
+cache: the FAT, directory and partial data sectors that FatFs moves its window
+over for every appended line stay in RAM, and writes to them only reach the
+card when a line is evicted or FatFs syncs (CTRL_SYNC). They reach it in the
+order of their last writes, so power lost during a sync cannot leave a
+directory entry on the card whose data is not. Multi-sector transfers
+are bulk data; they go straight to the card, kept coherent with what is cached.
+
+Safe from both cores: besides FatFs, which locks the volume, disk_read and
+disk_write are called directly (the extent logger), so the cache has its own
+mutex.
+*/
+
+#pragma once
+
+#include <stdint.h>
+//
+#include "sd_card.h"
+
+// RAM given to the cache, in sectors (0 = no cache)
+#ifndef DISK_CACHE_SECTORS
+#define DISK_CACHE_SECTORS 16
+#endif
+
+// Lines per set; the number of sets is DISK_CACHE_SECTORS / DISK_CACHE_WAYS
+#ifndef DISK_CACHE_WAYS
+#define DISK_CACHE_WAYS 4
+#endif
+
+#if DISK_CACHE_SECTORS && DISK_CACHE_SECTORS % DISK_CACHE_WAYS
+#error "DISK_CACHE_SECTORS must be a multiple of DISK_CACHE_WAYS"
+#endif
+
+#define DISK_CACHE_SECTOR_SIZE 512
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    uint32_t read_hits;     // Single-sector reads served from RAM
+    uint32_t read_misses;   // Single-sector reads that went to the card
+    uint32_t write_hits;    // Single-sector writes into a cached sector
+    uint32_t write_misses;  // Single-sector writes that took a new line
+    uint32_t evictions;     // Lines given to another sector
+    uint32_t writebacks;    // Dirty sectors written to the card
+    uint32_t bypassed;      // Multi-sector calls passed to the card
+    uint32_t flushes;       // disk_cache_flush calls (CTRL_SYNC)
+} disk_cache_stats_t;
+
+// Same arguments and return codes as the read_blocks/write_blocks methods
+int disk_cache_read(sd_card_t *pSD, uint8_t *buffer, uint64_t sector, uint32_t count);
+int disk_cache_write(sd_card_t *pSD, const uint8_t *buffer, uint64_t sector, uint32_t count);
+
+// Writes every dirty sector of pSD to the card, in the order of their last writes
+int disk_cache_flush(sd_card_t *pSD);
+
+// Forgets the cached sectors of pSD from start to end (inclusive), dirty or
+// not: their content no longer matters (trim)
+void disk_cache_discard(sd_card_t *pSD, uint64_t start, uint64_t end);
+
+// Copies the counters; they keep running
+void disk_cache_get_stats(disk_cache_stats_t *stats);
+
+// Clears the counters
+void disk_cache_reset_stats(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+/* [] END OF FILE */
@@ -0,0 +1,91 @@
+/* ff_pool.h
+Fixed-size block pools for the objects FatFs and ff_stdio allocate per call.
+
+With FF_USE_LFN == 3 every f_open, f_stat, f_opendir, ... takes an LFN working
+buffer from ff_memalloc, and ff_fopen takes a FIL per stream. Both now come
+from static pools: allocation and release are O(1), blocks never fragment,
+and each pool records its high-water mark so the block counts can be sized
+from a real run. A request the pool cannot serve goes to the heap only when
+FF_POOL_HEAP_FALLBACK is set; with it cleared the file system never touches
+malloc and an exhausted pool reports FR_NOT_ENOUGH_CORE (ENOMEM in ff_stdio).
+
+Safe from both cores: a mutex guards the free lists.
+*/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// LFN working buffers: one per FatFs call in progress
+#ifndef FF_POOL_LFN_BLOCKS
+#define FF_POOL_LFN_BLOCKS 2
+#endif
+
+// ff_stdio streams open at the same time
+#ifndef FF_POOL_FILE_BLOCKS
+#define FF_POOL_FILE_BLOCKS 4
+#endif
+
+// 1 = an exhausted pool or an oversized request falls back to malloc,
+// 0 = the file system never uses the heap
+#ifndef FF_POOL_HEAP_FALLBACK
+#define FF_POOL_HEAP_FALLBACK 1
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    uint16_t in_use;        // Blocks handed out now
+    uint16_t high_water;    // Most blocks handed out at once
+    uint32_t allocs;        // Blocks handed out so far
+    uint32_t failures;      // Requests the pool could not serve
+    uint32_t heap_fallbacks; // Of those, served by malloc
+} ff_pool_stats_t;
+
+// "Class" representing a pool of blocks of one size
+typedef struct {
+    const char *name;
+    uint8_t *storage;       // blocks * stride bytes
+    size_t block_size;      // Largest request served
+    size_t stride;          // block_size rounded up for alignment
+    uint16_t blocks;
+    uint16_t fresh;         // Blocks never handed out start here
+    void *free_list;        // Released blocks, linked through their first word
+    ff_pool_stats_t stats;
+} ff_pool_t;
+
+#define FF_POOL_ALIGN 8
+#define FF_POOL_STRIDE(block_size) (((block_size) + FF_POOL_ALIGN - 1) / FF_POOL_ALIGN * FF_POOL_ALIGN)
+
+// Defines pool 'pool_' with static storage for n_blocks blocks of block_size_ bytes
+#define FF_POOL_DEFINE(pool_, block_size_, n_blocks)                                               \
+    static uint64_t pool_##_storage[(n_blocks) * FF_POOL_STRIDE(block_size_) / sizeof(uint64_t)]; \
+    ff_pool_t pool_ = {.name = #pool_,                                                            \
+                       .storage = (uint8_t *)pool_##_storage,                                     \
+                       .block_size = (block_size_),                                               \
+                       .stride = FF_POOL_STRIDE(block_size_),                                     \
+                       .blocks = (n_blocks)}
+
+// The pools behind ff_memalloc and ff_fopen
+extern ff_pool_t ff_lfn_pool;
+extern ff_pool_t ff_file_pool;
+
+// A block of at least size bytes, or NULL when the pool is exhausted (or
+// size too large) and the heap fallback is off or fails
+void *ff_pool_alloc(ff_pool_t *pool, size_t size);
+
+// Releases a block from ff_pool_alloc (NULL is ignored)
+void ff_pool_free(ff_pool_t *pool, void *block);
+
+// Copies the counters
+void ff_pool_get_stats(const ff_pool_t *pool, ff_pool_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+/* [] END OF FILE */
@@ -12,8 +12,12 @@ CONDITIONS OF ANY KIND, either express or implied. See the License for the
 specific language governing permissions and limitations under the License.
 */
 // For compatibility with FreeRTOS+FAT API
+#pragma once
+
 #include <errno.h>
+#include <stdbool.h>
 #include <stddef.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 //
@@ -22,9 +26,30 @@ specific language governing permissions and limitations under the License.
 #include "my_debug.h"
 
 #define BaseType_t int
-#define FF_FILE FIL
 
-#define ff_rewind f_rewind
+// Write buffer each stream carries, in bytes (0 = streams start unbuffered)
+#ifndef FF_STDIO_BUFFER_SIZE
+#define FF_STDIO_BUFFER_SIZE 512
+#endif
+
+// Buffering modes of ff_setvbuf, as for setvbuf
+#define FF_IOFBF _IOFBF  // Full: written when the buffer fills
+#define FF_IOLBF _IOLBF  // Line: also written after each '\n'
+#define FF_IONBF _IONBF  // None: every call goes to f_write
+
+// A stream: the FatFs file and the bytes written to it that f_write has not
+// seen yet. Reads, seeks, ff_fflush and ff_fclose hand them over first.
+typedef struct FF_FILE {
+    FIL fil;
+    uint8_t *buffer;    // Pending bytes (NULL = unbuffered)
+    size_t size;        // Capacity of buffer
+    size_t count;       // Bytes pending in buffer
+    int mode;           // FF_IOFBF, FF_IOLBF or FF_IONBF
+#if FF_STDIO_BUFFER_SIZE
+    uint8_t own_buffer[FF_STDIO_BUFFER_SIZE];
+#endif
+} FF_FILE;
+
 #define pvPortMalloc malloc
 #define vPortFree free
 #define ffconfigMAX_FILENAME 250
@@ -37,8 +62,6 @@ specific language governing permissions and limitations under the License.
 #define FF_SEEK_END 2
 #define pdFALSE 0
 #define pdTRUE 1
-#define ff_filelength f_size
-#define ff_feof f_eof
 
 typedef struct FF_STAT {
     uint32_t st_size; /* Size of the object in number of bytes. */
@@ -74,4 +97,12 @@ int ff_findnext( FF_FindData_t *pxFindData );
 FF_FILE *ff_truncate( const char * pcFileName, long lTruncateSize );
 int ff_seteof( FF_FILE *pxStream );
 int ff_rename( const char *pcOldName, const char *pcNewName, int bDeleteIfExists );
-char *ff_fgets(char *pcBuffer, size_t xCount, FF_FILE *pxStream);
\ No newline at end of file
+char *ff_fgets(char *pcBuffer, size_t xCount, FF_FILE *pxStream);
+// Sets the buffering of a stream before or between writes: pcBuffer of xSize
+// bytes, or the stream's own buffer when NULL (xSize is capped to it)
+int ff_setvbuf(FF_FILE *pxStream, char *pcBuffer, int iMode, size_t xSize);
+// Hands the pending bytes to FatFs and syncs the file
+int ff_fflush(FF_FILE *pxStream);
+void ff_rewind(FF_FILE *pxStream);
+long ff_filelength(FF_FILE *pxStream);
+int ff_feof(FF_FILE *pxStream);
\ No newline at end of file
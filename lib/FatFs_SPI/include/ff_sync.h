@@ -0,0 +1,41 @@
+/* ff_sync.h
+Contention counters of the FatFs volume mutexes (FF_FS_REENTRANT).
+
+ffsystem.c implements the ff_mutex_* hooks on pico/mutex, so both cores may
+call FatFs; a caller that finds the volume busy waits up to FF_FS_TIMEOUT ms,
+then the call fails with FR_TIMEOUT. Every lock is counted, and the waits
+tell whether the two cores really serialize on the SD card.
+
+FatFs must not be called from interrupt context. A pico mutex is owned by a
+core, so a handler that interrupted the owner would wait for a release that
+cannot happen before it returns. Such calls are refused at once: they fail
+with FR_TIMEOUT and are counted in irq_refusals. Flushes driven by an IRQ
+must set a flag that a thread then services.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    uint32_t takes;         // Locks granted
+    uint32_t contended;     // Of those, found held by the other side
+    uint32_t timeouts;      // Waits that gave up after FF_FS_TIMEOUT
+    uint64_t wait_us;       // Time spent waiting in the contended locks
+    uint32_t max_wait_us;   // Longest wait
+    uint32_t irq_refusals;  // Locks refused because the caller was an interrupt handler
+} ff_mutex_stats_t;
+
+// Copies the counters of volume vol (FF_VOLUMES = the system mutex of
+// FF_FS_LOCK); returns 0 for a wrong ID
+int ff_mutex_get_stats(int vol, ff_mutex_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+/* [] END OF FILE */
@@ -32,9 +32,27 @@ specific language governing permissions and limitations under the License.
 #define SD_CRC_H
 
 #include <stddef.h>
-    
+
+// CRC16 engines for the SD data blocks:
+//   SD_CRC16_TABLE   one byte per step through m_Crc16Table
+//   SD_CRC16_SLICE4  four bytes per step through four constant tables kept in RAM
+//   SD_CRC16_DMA     the DMA sniffer computes the CRC while spi_transfer_start
+//                    moves the block, so it costs no CPU; blocks that do not
+//                    go through the DMA (sd_read_bytes, ...) use SD_CRC16_SLICE4
+#define SD_CRC16_TABLE 0
+#define SD_CRC16_SLICE4 1
+#define SD_CRC16_DMA 2
+
+#ifndef SD_CRC16_ENGINE
+#define SD_CRC16_ENGINE SD_CRC16_DMA
+#endif
+
 char crc7(const char* data, int length);
+// CRC16 with the CPU engine selected by SD_CRC16_ENGINE
 unsigned short crc16(const char* data, int length);
+// The CPU engines themselves, for comparing them
+unsigned short crc16_table(const char* data, int length);
+unsigned short crc16_slice4(const char* data, int length);
 void update_crc16(unsigned short *pCrc16, const char data[], size_t length);
 
 #endif
@@ -13,8 +13,8 @@ specific language governing permissions and limitations under the License.
 */
 #pragma once
 
-#include "lib\FatFs_SPI\ff15\source\ff.h"
-#include "lib\FatFs_SPI\sd_driver\sd_card.h"    
+#include "lib/FatFs_SPI/ff15/source/ff.h"
+#include "lib/FatFs_SPI/sd_driver/sd_card.h"    
     
 #ifdef __cplusplus
 extern "C" {
@@ -27,7 +27,7 @@ socket, which SPI it is driven by, and how it is wired.
 
 #include <string.h>
 //
-#include "lib\FatFs_SPI\include\my_debug.h"
+#include "lib/FatFs_SPI/include/my_debug.h"
 //
 #include "hw_config.h"
 //
@@ -184,6 +184,37 @@ specific language governing permissions and limitations under the License.
 static bool crc_on = true;
 #endif
 
+// The streamed block reads and writes take the data CRC from the DMA sniffer
+#define SD_CRC_BY_DMA (SD_CRC_ENABLED && SD_CRC16_ENGINE == SD_CRC16_DMA)
+#if SD_CRC_BY_DMA && !SPI_DMA_CRC
+#error "SD_CRC16_ENGINE == SD_CRC16_DMA needs SPI_DMA_CRC"
+#endif
+
+// Block reads: 1 = poll the start token by programmed I/O and receive data and
+// CRC with one DMA transfer per block, checking the CRC of a block while the
+// next one is on the bus; 0 = one sd_read_block (DMA per byte polled) per block
+#ifndef SD_STREAM_READ
+#define SD_STREAM_READ 1
+#endif
+
+// Block writes: 1 = compute the CRC of the next block while the current one
+// goes out by DMA, and only wait out the card's busy signal when the bus is
+// needed again; 0 = one sd_write_block (busy wait included) per block
+#ifndef SD_STREAM_WRITE
+#define SD_STREAM_WRITE 1
+#endif
+
+// 1 = no ACMD23 pre-erase hint before CMD25
+#ifndef SD_WRITE_SKIP_ACMD23
+#define SD_WRITE_SKIP_ACMD23 0
+#endif
+
+// 1 = no CMD13 status read after a write; the last block then programs while
+// the caller goes on, and the next command (or CTRL_SYNC) waits for it
+#ifndef SD_WRITE_SKIP_CMD13
+#define SD_WRITE_SKIP_CMD13 0
+#endif
+
 #define TRACE_PRINTF(fmt, args...)
 // #define TRACE_PRINTF printf
 
@@ -363,6 +394,27 @@ static bool sd_wait_ready(sd_card_t *pSD, int timeout) {
     return (resp > 0x00);
 }
 
+// sd_wait_ready for a card that may still be programming a written block
+// (busy_since_us set): the busy time is accounted when the host has to wait
+// for it. A card already ready at the first poll finished while the host was
+// doing something else, so only the fact is counted.
+static bool sd_wait_programmed(sd_card_t *pSD, int timeout) {
+    if (!pSD->busy_since_us) return sd_wait_ready(pSD, timeout);
+    uint64_t busy_since_us = pSD->busy_since_us;
+    pSD->busy_since_us = 0;
+
+    if (sd_spi_write(pSD, 0xFF) != 0x00) {
+        pSD->write_stats.busy_hidden++;
+        return true;
+    }
+    bool ready = sd_wait_ready(pSD, timeout);
+    uint32_t busy_us = (uint32_t)(time_us_64() - busy_since_us);
+    pSD->write_stats.busy_waits++;
+    pSD->write_stats.busy_us += busy_us;
+    if (busy_us > pSD->write_stats.max_busy_us) pSD->write_stats.max_busy_us = busy_us;
+    return ready;
+}
+
 // An SD card can only do one thing at a time.
 static void sd_lock(sd_card_t *pSD) {
     myASSERT(mutex_is_initialized(&pSD->mutex));
@@ -459,7 +511,7 @@ static int sd_cmd(sd_card_t *pSD, const cmdSupported cmd, uint32_t arg,
 
     // No need to wait for card to be ready when sending the stop command
     if (CMD12_STOP_TRANSMISSION != cmd) {
-        if (false == sd_wait_ready(pSD, SD_COMMAND_TIMEOUT)) {
+        if (false == sd_wait_programmed(pSD, SD_COMMAND_TIMEOUT)) {
             DBG_PRINTF("%s:%d: Card not ready yet\r\n", __FILE__, __LINE__);
         }
     }
@@ -531,9 +583,10 @@ static int sd_cmd(sd_card_t *pSD, const cmdSupported cmd, uint32_t arg,
             DBG_PRINTF("R3/R7: 0x%" PRIx32 "\r\n", response);
             break;
         case CMD12_STOP_TRANSMISSION:  // Response R1b
-        case CMD38_ERASE:
             sd_wait_ready(pSD, SD_COMMAND_TIMEOUT);
             break;
+        case CMD38_ERASE:  // Response R1b: sd_trim waits with the erase timeout
+            break;
         case CMD13_SEND_STATUS:  // Response R2
             response <<= 8;
             response |= sd_spi_write(pSD, SPI_FILL_CHAR);
@@ -752,6 +805,31 @@ static uint64_t sd_sectors_nolock(sd_card_t *pSD) {
     };
     return blocks;
 }
+// Reads the allocation unit and the erase timeout from the SD status
+// (ACMD13, Response R2 + 64-byte block). Cards without it keep 0 (unknown).
+static void sd_read_sd_status_nolock(sd_card_t *pSD) {
+    // AU_SIZE codes 1 to 15 in sectors: 16 KiB doubling up to 4 MiB, then
+    // 8, 12, 16, 24, 32 and 64 MiB
+    static const uint32_t au_sectors[16] = {0,     32,    64,    128,   256,   512,
+                                            1024,  2048,  4096,  8192,  16384, 24576,
+                                            32768, 49152, 65536, 131072};
+    uint8_t status[64];
+
+    if (sd_cmd(pSD, ACMD13_SD_STATUS, 0x0, true, 0) != SD_BLOCK_DEVICE_ERROR_NONE ||
+        sd_read_bytes(pSD, status, sizeof(status)) != 0) {
+        DBG_PRINTF("Couldn't read the SD status\r\n");
+        return;
+    }
+    pSD->au_sectors = au_sectors[status[10] >> 4];            // AU_SIZE       : [431:428]
+    uint32_t erase_size = (status[11] << 8) | status[12];      // ERASE_SIZE    : [423:408]
+    uint32_t erase_timeout = status[13] >> 2;                  // ERASE_TIMEOUT : [407:402]
+    // Without ERASE_SIZE the card gives no timeout: 250 ms per AU
+    pSD->erase_ms_per_au = erase_size && erase_timeout ? erase_timeout * 1000 / erase_size : 250;
+    pSD->erase_offset_ms = (status[13] & 0x03) * 1000;        // ERASE_OFFSET  : [401:400]
+    DBG_PRINTF("AU: %" PRIu32 " sectors, erase timeout %u ms per AU + %u ms\r\n",
+               pSD->au_sectors, pSD->erase_ms_per_au, pSD->erase_offset_ms);
+}
+
 uint64_t sd_sectors(sd_card_t *pSD) {
     sd_acquire(pSD);
     uint64_t sectors = sd_sectors_nolock(pSD);
@@ -809,6 +887,7 @@ static int sd_read_bytes(sd_card_t *pSD, uint8_t *buffer, uint32_t length) {
 
     return 0;
 }
+#if !SD_STREAM_READ
 static int sd_read_block(sd_card_t *pSD, uint8_t *buffer, uint32_t length) {
     uint16_t crc;
 
@@ -842,6 +921,106 @@ static int sd_read_block(sd_card_t *pSD, uint8_t *buffer, uint32_t length) {
 
     return SD_BLOCK_DEVICE_ERROR_NONE;
 }
+#endif
+
+#if SD_STREAM_READ
+// sd_wait_token with programmed I/O: a polled byte only costs its time on the bus
+static bool sd_wait_token_pio(sd_card_t *pSD, uint8_t token) {
+    TRACE_PRINTF("%s(0x%02hhx)\r\n", __FUNCTION__, token);
+
+    const uint32_t timeout = SD_COMMAND_TIMEOUT;  // Wait for start token
+    absolute_time_t timeout_time = make_timeout_time_ms(timeout);
+    do {
+        if (token == sd_spi_write_pio(pSD, SPI_FILL_CHAR)) {
+            return true;
+        }
+    } while (0 < absolute_time_diff_us(get_absolute_time(), timeout_time));
+    DBG_PRINTF("sd_wait_token_pio: timeout\r\n");
+    return false;
+}
+
+#if SD_CRC_BY_DMA
+// Checks the CRC the sniffer took over a received block. When the card's CRC
+// came in the same transfer the sniffer ran over it too, and a CRC taken over
+// data followed by their CRC is 0.
+static int sd_check_sniffed_crc(uint16_t crc, uint16_t sniffed, bool crc_sniffed) {
+    if (crc_on && sniffed != (crc_sniffed ? 0 : crc)) {
+        DBG_PRINTF("%s: Invalid CRC received 0x%" PRIx16
+                   " sniffed 0x%" PRIx16 "%s\r\n",
+                   __FUNCTION__, crc, sniffed, crc_sniffed ? " over data and CRC" : "");
+        return SD_BLOCK_DEVICE_ERROR_CRC;
+    }
+    return SD_BLOCK_DEVICE_ERROR_NONE;
+}
+#else
+static int sd_check_block_crc(const uint8_t *buffer, uint16_t crc) {
+#if SD_CRC_ENABLED
+    if (crc_on) {
+        uint16_t crc_result = crc16((void *)buffer, _block_size);
+        if (crc_result != crc) {
+            DBG_PRINTF("%s: Invalid CRC received 0x%" PRIx16
+                       " result of computation 0x%" PRIx16 "\r\n",
+                       __FUNCTION__, crc, crc_result);
+            return SD_BLOCK_DEVICE_ERROR_CRC;
+        }
+    }
+#else
+    (void)buffer;
+    (void)crc;
+#endif
+    return SD_BLOCK_DEVICE_ERROR_NONE;
+}
+#endif
+
+// Receives the blocks of a CMD17/CMD18 read into buffer.
+// The DMA of every block but the last runs 2 bytes past the data, into the
+// start of the next block's slot, so data and CRC come in one transfer; the
+// CRC is picked up before the next block lands on top of it. The CRC of
+// block N is then checked while block N+1 is being received.
+static int sd_read_block_stream(sd_card_t *pSD, uint8_t *buffer, uint32_t blockCnt) {
+    if (!sd_wait_token_pio(pSD, SPI_START_BLOCK)) {
+        DBG_PRINTF("%s:%d Read timeout\r\n", __FILE__, __LINE__);
+        return SD_BLOCK_DEVICE_ERROR_NO_RESPONSE;
+    }
+    sd_spi_transfer_start(pSD, NULL, buffer, blockCnt > 1 ? _block_size + 2 : _block_size);
+
+    for (uint32_t i = 0; i < blockCnt; ++i) {
+        uint8_t *block = buffer + i * _block_size;
+        if (!sd_spi_transfer_wait_complete(pSD, 1000)) {
+            return SD_BLOCK_DEVICE_ERROR_NO_RESPONSE;
+        }
+#if SD_CRC_BY_DMA
+        uint16_t sniffed = sd_spi_get_crc16(pSD);  // Before the next transfer resets it
+#endif
+        uint16_t crc;
+        bool in_flight = false;
+        if (i + 1 < blockCnt) {
+            crc = (block[_block_size] << 8) | block[_block_size + 1];
+            if (!sd_wait_token_pio(pSD, SPI_START_BLOCK)) {
+                DBG_PRINTF("%s:%d Read timeout\r\n", __FILE__, __LINE__);
+                return SD_BLOCK_DEVICE_ERROR_NO_RESPONSE;
+            }
+            uint32_t length = i + 2 < blockCnt ? _block_size + 2 : _block_size;
+            sd_spi_transfer_start(pSD, NULL, block + _block_size, length);
+            in_flight = true;
+        } else {
+            crc = (sd_spi_write_pio(pSD, SPI_FILL_CHAR) << 8);
+            crc |= sd_spi_write_pio(pSD, SPI_FILL_CHAR);
+        }
+#if SD_CRC_BY_DMA
+        int status = sd_check_sniffed_crc(crc, sniffed, i + 1 < blockCnt);
+#else
+        int status = sd_check_block_crc(block, crc);
+#endif
+        if (SD_BLOCK_DEVICE_ERROR_NONE != status) {
+            // Lets the next block finish before the caller stops the read
+            if (in_flight) sd_spi_transfer_wait_complete(pSD, 1000);
+            return status;
+        }
+    }
+    return SD_BLOCK_DEVICE_ERROR_NONE;
+}
+#endif
 
 static int in_sd_read_blocks(sd_card_t *pSD, uint8_t *buffer,
                              uint64_t ulSectorNumber, uint32_t ulSectorCount) {
@@ -871,8 +1050,11 @@ static int in_sd_read_blocks(sd_card_t *pSD, uint8_t *buffer,
     if (SD_BLOCK_DEVICE_ERROR_NONE != status) {
         return status;
     }
-    // receive the data : one block at a time
     int rd_status = 0;
+#if SD_STREAM_READ
+    rd_status = sd_read_block_stream(pSD, buffer, blockCnt);
+#else
+    // receive the data : one block at a time
     while (blockCnt) {
         if (0 != sd_read_block(pSD, buffer, _block_size)) {
             rd_status = SD_BLOCK_DEVICE_ERROR_NO_RESPONSE;
@@ -881,6 +1063,7 @@ static int in_sd_read_blocks(sd_card_t *pSD, uint8_t *buffer,
         buffer += _block_size;
         --blockCnt;
     }
+#endif
     // Send CMD12(0x00000000) to stop the transmission for multi-block transfer
     if (ulSectorCount > 1) {
         status = sd_cmd(pSD, CMD12_STOP_TRANSMISSION, 0x0, false, 0);
@@ -898,6 +1081,7 @@ int sd_read_blocks(sd_card_t *pSD, uint8_t *buffer, uint64_t ulSectorNumber,
     return status;
 }
 
+#if !SD_STREAM_WRITE
 static uint8_t sd_write_block(sd_card_t *pSD, const uint8_t *buffer,
                               uint8_t token, uint32_t length) {
     uint16_t crc = (~0);
@@ -923,13 +1107,74 @@ static uint8_t sd_write_block(sd_card_t *pSD, const uint8_t *buffer,
 
     // check the response token
     response = sd_spi_write(pSD, SPI_FILL_CHAR);
+    pSD->busy_since_us = time_us_64();
+    pSD->write_stats.blocks++;
 
     // Wait for last block to be written
-    if (false == sd_wait_ready(pSD, SD_COMMAND_TIMEOUT)) {
+    if (false == sd_wait_programmed(pSD, SD_COMMAND_TIMEOUT)) {
         DBG_PRINTF("%s:%d: Card not ready yet\r\n", __FILE__, __LINE__);
     }
     return (response & SPI_DATA_RESPONSE_MASK);
 }
+#endif
+
+#if SD_STREAM_WRITE && !SD_CRC_BY_DMA
+static uint16_t sd_block_crc(const uint8_t *buffer) {
+#if SD_CRC_ENABLED
+    if (crc_on) return crc16((void *)buffer, _block_size);
+#else
+    (void)buffer;
+#endif
+    return 0xFFFF;
+}
+#endif
+
+#if SD_STREAM_WRITE
+// Sends the data blocks of a CMD24/CMD25 write, each behind 'token'.
+// While a block goes out by DMA the CPU computes the CRC of the next one, and
+// the busy signal of a block is only waited for right before the next token.
+// With SD_CRC_BY_DMA the sniffer computes the CRC as the block goes out.
+// The last block is left programming (busy_since_us); whoever uses the bus
+// next waits for it in sd_wait_programmed.
+static int sd_write_block_stream(sd_card_t *pSD, const uint8_t *buffer,
+                                 uint8_t token, uint32_t blockCnt) {
+#if !SD_CRC_BY_DMA
+    uint16_t crc = sd_block_crc(buffer);
+#endif
+    for (uint32_t i = 0; i < blockCnt; ++i) {
+        const uint8_t *block = buffer + i * _block_size;
+        if (i > 0 && false == sd_wait_programmed(pSD, SD_COMMAND_TIMEOUT)) {
+            DBG_PRINTF("%s:%d: Card not ready yet\r\n", __FILE__, __LINE__);
+            return SD_BLOCK_DEVICE_ERROR_WRITE;
+        }
+        sd_spi_write(pSD, token);
+        sd_spi_transfer_start(pSD, block, NULL, _block_size);
+#if !SD_CRC_BY_DMA
+        uint16_t next_crc = i + 1 < blockCnt ? sd_block_crc(block + _block_size) : 0;
+#endif
+        if (!sd_spi_transfer_wait_complete(pSD, 1000)) {
+            return SD_BLOCK_DEVICE_ERROR_NO_RESPONSE;
+        }
+#if SD_CRC_BY_DMA
+        uint16_t crc = crc_on ? sd_spi_get_crc16(pSD) : 0xFFFF;
+#endif
+        sd_spi_write(pSD, crc >> 8);
+        sd_spi_write(pSD, crc);
+
+        uint8_t response = sd_spi_write(pSD, SPI_FILL_CHAR) & SPI_DATA_RESPONSE_MASK;
+        if (response != SPI_DATA_ACCEPTED) {
+            DBG_PRINTF("Block Write failed: 0x%x\r\n", response);
+            return SD_BLOCK_DEVICE_ERROR_WRITE;
+        }
+        pSD->busy_since_us = time_us_64();
+        pSD->write_stats.blocks++;
+#if !SD_CRC_BY_DMA
+        crc = next_crc;
+#endif
+    }
+    return SD_BLOCK_DEVICE_ERROR_NONE;
+}
+#endif
 
 /** Program blocks to a block device
  *
@@ -954,7 +1199,9 @@ static int in_sd_write_blocks(sd_card_t *pSD, const uint8_t *buffer,
         return SD_BLOCK_DEVICE_ERROR_PARAMETER;
 
     int status = SD_BLOCK_DEVICE_ERROR_NONE;
+#if !SD_STREAM_WRITE
     uint8_t response;
+#endif
     uint64_t addr;
 
     // SDSC Card (CCS=0) uses byte unit address
@@ -964,6 +1211,7 @@ static int in_sd_write_blocks(sd_card_t *pSD, const uint8_t *buffer,
     } else {
         addr = ulSectorNumber * _block_size;
     }
+    pSD->write_stats.writes++;
     // Send command to perform write operation
     if (blockCnt == 1) {
         // Single block write command
@@ -972,6 +1220,9 @@ static int in_sd_write_blocks(sd_card_t *pSD, const uint8_t *buffer,
             return status;
         }
         // Write data
+#if SD_STREAM_WRITE
+        status = sd_write_block_stream(pSD, buffer, SPI_START_BLOCK, 1);
+#else
         response = sd_write_block(pSD, buffer, SPI_START_BLOCK, _block_size);
 
         // Only CRC and general write error are communicated via response token
@@ -979,18 +1230,26 @@ static int in_sd_write_blocks(sd_card_t *pSD, const uint8_t *buffer,
             DBG_PRINTF("Single Block Write failed: 0x%x \r\n", response);
             status = SD_BLOCK_DEVICE_ERROR_WRITE;
         }
+#endif
     } else {
+#if !SD_WRITE_SKIP_ACMD23
         // Pre-erase setting prior to multiple block write operation
         sd_cmd(pSD, ACMD23_SET_WR_BLK_ERASE_COUNT, blockCnt, 1, 0);
 
         // Some SD cards want to be deselected between every bus transaction:
         sd_spi_deselect_pulse(pSD);
+#endif
 
         // Multiple block write command
         if (SD_BLOCK_DEVICE_ERROR_NONE !=
             (status = sd_cmd(pSD, CMD25_WRITE_MULTIPLE_BLOCK, addr, false, 0))) {
             return status;
         }
+#if SD_STREAM_WRITE
+        status = sd_write_block_stream(pSD, buffer, SPI_START_BLK_MUL_WRITE, blockCnt);
+        // The stop token may only follow once the last block is programmed
+        sd_wait_programmed(pSD, SD_COMMAND_TIMEOUT);
+#else
         // Write the data: one block at a time
         do {
             response = sd_write_block(pSD, buffer, SPI_START_BLK_MUL_WRITE, _block_size);
@@ -1001,17 +1260,26 @@ static int in_sd_write_blocks(sd_card_t *pSD, const uint8_t *buffer,
             }
             buffer += _block_size;
         } while (--blockCnt);  // Send all blocks of data
+#endif
         /* In a Multiple Block write operation, the stop transmission will be
          * done by sending 'Stop Tran' token instead of 'Start Block' token at
          * the beginning of the next block
          */
         sd_spi_write(pSD, SPI_STOP_TRAN);
     }
+#if SD_WRITE_SKIP_CMD13
+    return status;
+#else
     uint32_t stat = 0;
     // Some SD cards want to be deselected between every bus transaction:
     sd_spi_deselect_pulse(pSD);
-    status = sd_cmd(pSD, CMD13_SEND_STATUS, 0, false, &stat);
-    return status;
+    int cmd13_status = sd_cmd(pSD, CMD13_SEND_STATUS, 0, false, &stat);
+    return status ? status : cmd13_status;
+#endif
+}
+
+void sd_get_write_stats(sd_card_t *pSD, sd_write_stats_t *stats) {
+    *stats = pSD->write_stats;
 }
 
 int sd_write_blocks(sd_card_t *pSD, const uint8_t *buffer,
@@ -1024,6 +1292,77 @@ int sd_write_blocks(sd_card_t *pSD, const uint8_t *buffer,
     return status;
 }
 
+// CTRL_SYNC: waits for the block still programming. Without the CMD13 after
+// every write, its status is read here once, so a failed write still shows.
+static int sd_sync(sd_card_t *pSD) {
+    if (pSD->m_Status & (STA_NOINIT | STA_NODISK))
+        return SD_BLOCK_DEVICE_ERROR_NO_INIT;
+    sd_acquire(pSD);
+    int status = SD_BLOCK_DEVICE_ERROR_NONE;
+    if (false == sd_wait_programmed(pSD, SD_COMMAND_TIMEOUT)) {
+        status = SD_BLOCK_DEVICE_ERROR_NO_RESPONSE;
+    } else {
+#if SD_WRITE_SKIP_CMD13
+        uint32_t stat = 0;
+        sd_spi_deselect_pulse(pSD);
+        status = sd_cmd(pSD, CMD13_SEND_STATUS, 0, false, &stat);
+#endif
+    }
+    sd_release(pSD);
+    return status;
+}
+
+/** Erase blocks of a block device (CMD32/CMD33/CMD38)
+ *
+ *  Erased blocks read back as all 0s or all 1s, and the card will not have
+ *  to clear them when they are written again.
+ *
+ *  @param start        First block to erase (LBA)
+ *  @param end          Last block to erase (LBA), inclusive
+ *  @return         SD_BLOCK_DEVICE_ERROR_NONE(0) - success
+ *                  SD_BLOCK_DEVICE_ERROR_PARAMETER - invalid range
+ *                  SD_BLOCK_DEVICE_ERROR_ERASE - erase error
+ *                  SD_BLOCK_DEVICE_ERROR_NO_RESPONSE - erase timed out
+ */
+static int in_sd_trim(sd_card_t *pSD, uint64_t start, uint64_t end) {
+    if (end < start || end >= pSD->sectors) return SD_BLOCK_DEVICE_ERROR_PARAMETER;
+    if (pSD->m_Status & (STA_NOINIT | STA_NODISK))
+        return SD_BLOCK_DEVICE_ERROR_PARAMETER;
+
+    // SDSC Card (CCS=0) uses byte unit address
+    // SDHC and SDXC Cards (CCS=1) use block unit address (512 Bytes unit)
+    uint64_t start_addr = start, end_addr = end;
+    if (SDCARD_V2HC != pSD->card_type) {
+        start_addr *= _block_size;
+        end_addr *= _block_size;
+    }
+    int status = sd_cmd(pSD, CMD32_ERASE_WR_BLK_START_ADDR, start_addr, false, 0);
+    if (SD_BLOCK_DEVICE_ERROR_NONE == status)
+        status = sd_cmd(pSD, CMD33_ERASE_WR_BLK_END_ADDR, end_addr, false, 0);
+    if (SD_BLOCK_DEVICE_ERROR_NONE == status)
+        status = sd_cmd(pSD, CMD38_ERASE, 0x0, false, 0);
+    if (SD_BLOCK_DEVICE_ERROR_NONE != status) return status;
+
+    // The card holds DO low until every AU touched is erased
+    uint32_t au = pSD->au_sectors ? pSD->au_sectors : 8192;
+    uint32_t units = (uint32_t)(end / au - start / au + 1);
+    uint32_t timeout = SD_COMMAND_TIMEOUT + pSD->erase_offset_ms +
+                       units * (pSD->erase_ms_per_au ? pSD->erase_ms_per_au : 250);
+    if (false == sd_wait_ready(pSD, timeout)) {
+        DBG_PRINTF("%s: erase of %" PRIu64 " blocks timed out\r\n", __FUNCTION__, end - start + 1);
+        return SD_BLOCK_DEVICE_ERROR_NO_RESPONSE;
+    }
+    return SD_BLOCK_DEVICE_ERROR_NONE;
+}
+
+static int sd_trim(sd_card_t *pSD, uint64_t start, uint64_t end) {
+    sd_acquire(pSD);
+    TRACE_PRINTF("sd_trim(0x%" PRIx64 ", 0x%" PRIx64 ")\r\n", start, end);
+    int status = in_sd_trim(pSD, start, end);
+    sd_release(pSD);
+    return status;
+}
+
 static int sd_init_medium(sd_card_t *pSD) {
     int32_t status = SD_BLOCK_DEVICE_ERROR_NONE;
     uint32_t response, arg;
@@ -1137,6 +1476,9 @@ static void sd_ctor(sd_card_t *pSD) {
     pSD->init = sd_init;
     pSD->write_blocks = sd_write_blocks;
     pSD->read_blocks = sd_read_blocks;
+    pSD->get_num_sectors = sd_sectors;
+    pSD->trim = sd_trim;
+    pSD->sync = sd_sync;
     pSD->sd_test_com = sd_test_com;
 }
 bool sd_init_driver() {
@@ -1146,6 +1488,8 @@ bool sd_init_driver() {
     if (!initialized) {
         for (size_t i = 0; i < sd_get_num(); ++i) {
             sd_card_t *pSD = sd_get_by_num(i);
+            // Image backed cards come with their own methods and no SPI
+            if (pSD->image) continue;
 
             sd_ctor(pSD);
 
@@ -1224,6 +1568,8 @@ static int sd_init(sd_card_t *pSD) {
         sd_unlock(pSD);
         return pSD->m_Status;
     }
+    // Allocation unit for f_mkfs and erase timeouts for sd_trim
+    sd_read_sd_status_nolock(pSD);
     // Set SCK for data transfer
     sd_spi_go_high_frequency(pSD);
 
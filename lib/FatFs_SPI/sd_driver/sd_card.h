@@ -22,15 +22,27 @@ specific language governing permissions and limitations under the License.
 #include "hardware/gpio.h"
 #include "pico/mutex.h"
 //
-#include "lib\FatFs_SPI\ff15\source\ff.h"
+#include "lib/FatFs_SPI/ff15/source/ff.h"
 //
-#include "lib\FatFs_SPI\sd_driver\spi.h"
+#include "lib/FatFs_SPI/sd_driver/spi.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 typedef struct sd_card_t sd_card_t;
+struct sd_image_t;
+
+// Card programming time after written blocks: from the data response to the
+// end of the busy signal
+typedef struct {
+    uint32_t writes;        // write_blocks calls
+    uint32_t blocks;        // Blocks written
+    uint32_t busy_waits;    // Blocks whose busy signal the host had to wait out
+    uint32_t busy_hidden;   // Blocks done programming before the host needed the bus
+    uint64_t busy_us;       // Total waited busy time
+    uint32_t max_busy_us;   // Longest busy time of one block
+} sd_write_stats_t;
 
 // "Class" representing SD Cards
 struct sd_card_t {
@@ -54,12 +66,25 @@ struct sd_card_t {
     mutex_t mutex;
     FATFS fatfs;
     bool mounted;
+    struct sd_image_t *image;  // Disk image standing in for the card (sd_image.c); NULL on SPI
+    uint64_t busy_since_us;    // Data response time of a block still programming (0 = none)
+    sd_write_stats_t write_stats;
+    // From the SD status (ACMD13), read at init; 0 = unknown
+    uint32_t au_sectors;            // Allocation unit (AU_SIZE) in sectors
+    uint16_t erase_ms_per_au;       // Erase timeout per AU (ERASE_TIMEOUT / ERASE_SIZE)
+    uint16_t erase_offset_ms;       // Fixed part of the erase timeout (ERASE_OFFSET)
 
     int (*init)(sd_card_t *sd_card_p);
     int (*write_blocks)(sd_card_t *sd_card_p, const uint8_t *buffer,
                     uint64_t ulSectorNumber, uint32_t blockCnt);
     int (*read_blocks)(sd_card_t *sd_card_p, uint8_t *buffer, uint64_t ulSectorNumber,
                     uint32_t ulSectorCount);
+    uint64_t (*get_num_sectors)(sd_card_t *sd_card_p);
+    // Erases sectors start to end (inclusive); NULL if the medium cannot
+    int (*trim)(sd_card_t *sd_card_p, uint64_t start, uint64_t end);
+    // Waits until the written blocks are programmed (CTRL_SYNC); NULL if
+    // write_blocks only returns once they are
+    int (*sync)(sd_card_t *sd_card_p);
 
     // Useful when use_card_detect is false - call periodically to check for presence of SD card
     // Returns true if and only if SD card was sensed on the bus
@@ -91,6 +116,7 @@ bool sd_card_detect(sd_card_t *pSD);
 uint64_t sd_sectors(sd_card_t *pSD);
 
 bool sd_init_driver();
+void sd_get_write_stats(sd_card_t *pSD, sd_write_stats_t *stats);
 bool sd_card_detect(sd_card_t *sd_card_p);
 
 #ifdef __cplusplus
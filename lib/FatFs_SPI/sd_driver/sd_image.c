@@ -0,0 +1,210 @@
+/* sd_image.c
+Disk image backend for sd_card_t: see sd_image.h.
+*/
+
+#include <string.h>
+//
+#include "pico/stdlib.h"
+//
+#include "sd_image.h"
+//
+#include "diskio.h" /* Declarations of disk functions */  // Needed for STA_NOINIT, ...
+
+#if SD_IMAGE_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static uint bucket_of(uint32_t count) {
+    uint bucket = 0;
+    while (bucket < SD_IMAGE_HISTOGRAM_BUCKETS - 1 && (1u << bucket) < count) bucket++;
+    return bucket;
+}
+
+static void account(sd_image_io_stats *stats, uint64_t *next, uint64_t sector, uint32_t count,
+                    uint64_t start_us) {
+    uint32_t us = (uint32_t)(time_us_64() - start_us);
+    if (stats->calls && sector == *next) stats->sequential++;
+    *next = sector + count;
+    stats->calls++;
+    stats->sectors += count;
+    stats->histogram[bucket_of(count)]++;
+    stats->total_us += us;
+    if (us > stats->max_us) stats->max_us = us;
+}
+
+static void simulate_cost(sd_image_t *image, uint32_t count) {
+    uint64_t us = image->access_us + (uint64_t)image->per_sector_us * count;
+    if (us) busy_wait_us(us);
+}
+
+static int image_init(sd_card_t *pSD) {
+    sd_card_detect(pSD);
+    if (pSD->image->data) pSD->m_Status &= ~STA_NOINIT;
+    return pSD->m_Status;
+}
+
+static int image_read_blocks(sd_card_t *pSD, uint8_t *buffer, uint64_t ulSectorNumber,
+                             uint32_t ulSectorCount) {
+    sd_image_t *image = pSD->image;
+    if (pSD->m_Status & STA_NOINIT) return SD_BLOCK_DEVICE_ERROR_NO_INIT;
+    if (ulSectorNumber + ulSectorCount > image->sectors) return SD_BLOCK_DEVICE_ERROR_PARAMETER;
+
+    uint64_t start_us = time_us_64();
+    memcpy(buffer, image->data + ulSectorNumber * SD_IMAGE_SECTOR_SIZE,
+           (size_t)ulSectorCount * SD_IMAGE_SECTOR_SIZE);
+    simulate_cost(image, ulSectorCount);
+    account(&image->stats.read, &image->next_read, ulSectorNumber, ulSectorCount, start_us);
+    return SD_BLOCK_DEVICE_ERROR_NONE;
+}
+
+static int image_write_blocks(sd_card_t *pSD, const uint8_t *buffer, uint64_t ulSectorNumber,
+                              uint32_t blockCnt) {
+    sd_image_t *image = pSD->image;
+    if (pSD->m_Status & STA_NOINIT) return SD_BLOCK_DEVICE_ERROR_NO_INIT;
+    if (ulSectorNumber + blockCnt > image->sectors) return SD_BLOCK_DEVICE_ERROR_PARAMETER;
+
+    uint64_t start_us = time_us_64();
+    uint32_t landed = blockCnt;
+    if (image->cut_armed) {
+        // Only the sectors programmed before the cut reach the medium
+        if (image->write_budget < landed) {
+            landed = (uint32_t)image->write_budget;
+            image->power_cut = true;
+        }
+        image->write_budget -= landed;
+    }
+    memcpy(image->data + ulSectorNumber * SD_IMAGE_SECTOR_SIZE, buffer,
+           (size_t)landed * SD_IMAGE_SECTOR_SIZE);
+    simulate_cost(image, blockCnt);
+    account(&image->stats.write, &image->next_write, ulSectorNumber, blockCnt, start_us);
+    return SD_BLOCK_DEVICE_ERROR_NONE;
+}
+
+static int image_trim(sd_card_t *pSD, uint64_t start, uint64_t end) {
+    sd_image_t *image = pSD->image;
+    if (pSD->m_Status & STA_NOINIT) return SD_BLOCK_DEVICE_ERROR_NO_INIT;
+    if (end < start || end >= image->sectors) return SD_BLOCK_DEVICE_ERROR_PARAMETER;
+    if (image->power_cut) return SD_BLOCK_DEVICE_ERROR_NONE;
+
+    if (image->trim_fill != SD_IMAGE_TRIM_KEEP) {
+        memset(image->data + start * SD_IMAGE_SECTOR_SIZE, image->trim_fill,
+               (size_t)(end - start + 1) * SD_IMAGE_SECTOR_SIZE);
+    }
+    image->stats.trims++;
+    image->stats.trimmed_sectors += end - start + 1;
+    return SD_BLOCK_DEVICE_ERROR_NONE;
+}
+
+static uint64_t image_get_num_sectors(sd_card_t *pSD) {
+    return pSD->image->sectors;
+}
+
+static bool image_test_com(sd_card_t *pSD) {
+    return pSD->image->data != NULL;
+}
+
+// Points the card "methods" at the image; sd_init_driver leaves such cards alone
+static void image_ctor(sd_card_t *pSD, sd_image_t *image) {
+    image->trim_fill = 0xFF;
+    pSD->image = image;
+    pSD->use_card_detect = false;
+    pSD->m_Status = STA_NOINIT;
+    pSD->sectors = image->sectors;
+    pSD->init = image_init;
+    pSD->read_blocks = image_read_blocks;
+    pSD->write_blocks = image_write_blocks;
+    pSD->get_num_sectors = image_get_num_sectors;
+    pSD->trim = image_trim;
+    pSD->sync = NULL;          // Writes are done when write_blocks returns
+    pSD->au_sectors = 0;
+    pSD->sd_test_com = image_test_com;
+}
+
+bool sd_image_attach_ram(sd_card_t *pSD, sd_image_t *image, uint8_t *buffer, uint64_t sectors) {
+    memset(image, 0, sizeof(*image));
+    if (!buffer || sectors == 0) return false;
+    image->data = buffer;
+    image->sectors = sectors;
+    image->fd = -1;
+    image_ctor(pSD, image);
+    return true;
+}
+
+#if SD_IMAGE_MMAP
+bool sd_image_attach_file(sd_card_t *pSD, sd_image_t *image, const char *path, uint64_t default_sectors) {
+    memset(image, 0, sizeof(*image));
+    image->fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (image->fd < 0) return false;
+
+    struct stat st;
+    if (fstat(image->fd, &st) != 0) goto fail;
+    uint64_t bytes = (uint64_t)st.st_size;
+    if (bytes == 0) {
+        // A new image is sparse: only the sectors FatFs writes take space
+        bytes = default_sectors * SD_IMAGE_SECTOR_SIZE;
+        if (ftruncate(image->fd, (off_t)bytes) != 0) goto fail;
+    }
+    image->sectors = bytes / SD_IMAGE_SECTOR_SIZE;
+    if (image->sectors == 0) goto fail;
+
+    void *data = mmap(NULL, (size_t)(image->sectors * SD_IMAGE_SECTOR_SIZE), PROT_READ | PROT_WRITE,
+                      MAP_SHARED, image->fd, 0);
+    if (data == MAP_FAILED) goto fail;
+    image->data = data;
+    image->mapped = true;
+    image_ctor(pSD, image);
+    return true;
+
+fail:
+    close(image->fd);
+    image->fd = -1;
+    return false;
+}
+#endif
+
+void sd_image_close(sd_image_t *image) {
+#if SD_IMAGE_MMAP
+    if (image->mapped) {
+        size_t bytes = (size_t)(image->sectors * SD_IMAGE_SECTOR_SIZE);
+        msync(image->data, bytes, MS_SYNC);
+        munmap(image->data, bytes);
+        close(image->fd);
+        image->mapped = false;
+        image->fd = -1;
+    }
+#endif
+    image->data = NULL;
+}
+
+void sd_image_set_latency(sd_image_t *image, uint32_t access_us, uint32_t per_sector_us) {
+    image->access_us = access_us;
+    image->per_sector_us = per_sector_us;
+}
+
+void sd_image_set_trim_fill(sd_image_t *image, int fill) {
+    image->trim_fill = fill;
+}
+
+void sd_image_cut_power_after(sd_image_t *image, uint64_t sectors) {
+    image->cut_armed = true;
+    image->write_budget = sectors;
+    image->power_cut = false;
+}
+
+void sd_image_restore_power(sd_image_t *image) {
+    image->cut_armed = false;
+    image->power_cut = false;
+}
+
+void sd_image_get_stats(const sd_image_t *image, sd_image_stats *stats) {
+    *stats = image->stats;
+}
+
+void sd_image_reset_stats(sd_image_t *image) {
+    memset(&image->stats, 0, sizeof(image->stats));
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,119 @@
+/* sd_image.h
+Disk image backend for sd_card_t.
+
+Stands in for the SPI driver behind glue.c: sectors live in a RAM buffer or,
+on a workstation, in a memory-mapped image file. Every read_blocks and
+write_blocks call is counted, timed and checked for sequentiality, so a log
+workload can be replayed against FatFs to see what each write really costs
+in sector I/O. Trimmed sectors read back as 0xFF, like a card erased to ones,
+or keep their old data (sd_image_set_trim_fill), like a card that ignores the
+discard: never as zeros that a log could mistake for its own padding.
+
+For power-fail tests the image can lose power after a given number of sector
+writes: the sectors up to the cut land, the rest of that call and every later
+write are dropped while the calls still report success, as the firmware would
+never see them fail before it dies.
+*/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+//
+#include "sd_card.h"
+
+// mmap-backed image files are only available on a POSIX host
+#ifndef SD_IMAGE_MMAP
+#if defined(__unix__) || defined(__APPLE__)
+#define SD_IMAGE_MMAP 1
+#else
+#define SD_IMAGE_MMAP 0
+#endif
+#endif
+
+#define SD_IMAGE_SECTOR_SIZE 512
+
+// trim_fill that leaves trimmed sectors as they were
+#define SD_IMAGE_TRIM_KEEP -1
+
+// Sectors per call histogram: 1, 2, 3-4, 5-8, ..., 129 and more
+#define SD_IMAGE_HISTOGRAM_BUCKETS 9
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Statistics of one direction (reads or writes)
+typedef struct {
+    uint32_t calls;                 // read_blocks/write_blocks calls
+    uint64_t sectors;               // Sectors moved by those calls
+    uint32_t sequential;            // Calls that started where the previous one ended
+    uint32_t histogram[SD_IMAGE_HISTOGRAM_BUCKETS]; // Calls by sector count
+    uint64_t total_us;              // Time spent inside the calls
+    uint32_t max_us;                // Slowest call
+} sd_image_io_stats;
+
+typedef struct {
+    sd_image_io_stats read;
+    sd_image_io_stats write;
+    uint32_t trims;                 // trim calls (CTRL_TRIM)
+    uint64_t trimmed_sectors;       // Sectors they covered
+} sd_image_stats;
+
+// "Class" representing a disk image attached to an sd_card_t
+struct sd_image_t {
+    uint8_t *data;                  // Sector 0 of the image
+    uint64_t sectors;               // Size of the image in sectors
+    bool mapped;                    // data is an mmap of fd
+    int fd;
+    // Optional cost model: each call waits access_us + per_sector_us * count,
+    // so the latencies read like those of a real card (0 = as fast as memory)
+    uint32_t access_us;
+    uint32_t per_sector_us;
+    int trim_fill;                  // Byte trimmed sectors read back as, or SD_IMAGE_TRIM_KEEP
+    uint64_t next_read;             // Sector after the last read
+    uint64_t next_write;            // Sector after the last write
+    bool cut_armed;                 // A power cut is scheduled
+    uint64_t write_budget;          // Sectors still written before it happens
+    bool power_cut;                 // The cut happened: writes are dropped
+    sd_image_stats stats;
+};
+typedef struct sd_image_t sd_image_t;
+
+// Attaches a RAM buffer of 'sectors' sectors as the medium of pSD
+bool sd_image_attach_ram(sd_card_t *pSD, sd_image_t *image, uint8_t *buffer, uint64_t sectors);
+
+#if SD_IMAGE_MMAP
+// Maps an image file as the medium of pSD; a missing or empty file is
+// created sparse with default_sectors sectors
+bool sd_image_attach_file(sd_card_t *pSD, sd_image_t *image, const char *path, uint64_t default_sectors);
+#endif
+
+// Writes a mapped image back to its file and releases it
+void sd_image_close(sd_image_t *image);
+
+// Sets the cost model of every call
+void sd_image_set_latency(sd_image_t *image, uint32_t access_us, uint32_t per_sector_us);
+
+// Sets what trimmed sectors read back as: a byte value (0xFF after attaching)
+// or SD_IMAGE_TRIM_KEEP for their stale data
+void sd_image_set_trim_fill(sd_image_t *image, int fill);
+
+// Schedules a power cut after 'sectors' more sector writes (0 = the next
+// write is lost)
+void sd_image_cut_power_after(sd_image_t *image, uint64_t sectors);
+
+// Powers the image up again: writes land as usual
+void sd_image_restore_power(sd_image_t *image);
+
+// Copies the counters; they keep running
+void sd_image_get_stats(const sd_image_t *image, sd_image_stats *stats);
+
+// Clears the counters
+void sd_image_reset_stats(sd_image_t *image);
+
+#ifdef __cplusplus
+}
+#endif
+
+/* [] END OF FILE */
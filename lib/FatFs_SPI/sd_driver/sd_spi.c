@@ -19,7 +19,7 @@ specific language governing permissions and limitations under the License.
 //
 #include "hardware/gpio.h"
 //
-#include "lib\FatFs_SPI\include\my_debug.h"
+#include "lib/FatFs_SPI/include/my_debug.h"
 #include "sd_card.h"
 #include "sd_spi.h"
 #include "spi.h"
@@ -91,6 +91,27 @@ bool sd_spi_transfer(sd_card_t *pSD, const uint8_t *tx, uint8_t *rx,
     return spi_transfer(pSD->spi, tx, rx, length);
 }
 
+bool sd_spi_transfer_start(sd_card_t *pSD, const uint8_t *tx, uint8_t *rx,
+                           size_t length) {
+    return spi_transfer_start(pSD->spi, tx, rx, length);
+}
+
+bool sd_spi_transfer_wait_complete(sd_card_t *pSD, uint32_t timeout_ms) {
+    return spi_transfer_wait_complete(pSD->spi, timeout_ms);
+}
+
+#if SPI_DMA_CRC
+uint16_t sd_spi_get_crc16(sd_card_t *pSD) {
+    return spi_get_crc16(pSD->spi);
+}
+#endif
+
+uint8_t sd_spi_write_pio(sd_card_t *pSD, const uint8_t value) {
+    uint8_t received = SPI_FILL_CHAR;
+    spi_write_read_blocking(pSD->spi->hw_inst, &value, &received, 1);
+    return received;
+}
+
 uint8_t sd_spi_write(sd_card_t *pSD, const uint8_t value) {
     // TRACE_PRINTF("%s\n", __FUNCTION__);
     uint8_t received = SPI_FILL_CHAR;
@@ -22,6 +22,16 @@ specific language governing permissions and limitations under the License.
 tx or rx can be NULL if not important. */
 bool sd_spi_transfer(sd_card_t *pSD, const uint8_t *tx, uint8_t *rx, size_t length);
 uint8_t sd_spi_write(sd_card_t *pSD, const uint8_t value);
+/* Same exchange by programmed I/O: no DMA setup nor interrupt, which is
+cheaper than a transfer for single bytes such as token polls. */
+uint8_t sd_spi_write_pio(sd_card_t *pSD, const uint8_t value);
+/* Split transfer: the DMA runs between start and wait. */
+bool sd_spi_transfer_start(sd_card_t *pSD, const uint8_t *tx, uint8_t *rx, size_t length);
+bool sd_spi_transfer_wait_complete(sd_card_t *pSD, uint32_t timeout_ms);
+#if SPI_DMA_CRC
+/* CRC16 the DMA sniffer took over the data of the last split transfer. */
+uint16_t sd_spi_get_crc16(sd_card_t *pSD);
+#endif
 void sd_spi_deselect_pulse(sd_card_t *pSD);
 void sd_spi_acquire(sd_card_t *pSD);
 void sd_spi_release(sd_card_t *pSD);
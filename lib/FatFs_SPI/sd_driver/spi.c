@@ -14,12 +14,13 @@ specific language governing permissions and limitations under the License.
 
 #include <assert.h>
 #include <stdbool.h>
+#include <string.h>
 //
 #include "pico/stdlib.h"
 #include "pico/mutex.h"
 #include "pico/sem.h"
 //
-#include "lib\FatFs_SPI\include\my_debug.h"
+#include "lib/FatFs_SPI/include/my_debug.h"
 #include "hw_config.h"
 //
 #include "spi.h"
@@ -54,12 +55,21 @@ void set_spi_dma_irq_channel(bool useChannel1, bool shared) {
     irqShared = shared;
 }
 
-// SPI Transfer: Read & Write (simultaneously) on SPI bus
-//   If the data that will be received is not important, pass NULL as rx.
-//   If the data that will be transmitted is not important,
-//     pass NULL as tx and then the SPI_FILL_CHAR is sent out as each data
-//     element.
-bool spi_transfer(spi_t *spi_p, const uint8_t *tx, uint8_t *rx, size_t length) {
+#if SPI_STATS
+static void spi_account(spi_t *spi_p, bool pio, size_t length, uint64_t us) {
+    uint bucket = 0;
+    while (bucket < SPI_STATS_BUCKETS - 1 && (1u << bucket) < length) bucket++;
+    spi_size_stats_t *stats = pio ? &spi_p->stats.pio[bucket] : &spi_p->stats.dma[bucket];
+    stats->count++;
+    stats->us += us;
+}
+#endif
+
+// Starts an SPI Transfer and returns at once; the DMA moves the data while
+// the caller works. spi_transfer_wait_complete must follow before the bus
+// is used again.
+//   tx and rx as for spi_transfer.
+bool spi_transfer_start(spi_t *spi_p, const uint8_t *tx, uint8_t *rx, size_t length) {
     // assert(512 == length || 1 == length);
     assert(tx || rx);
     // assert(!(tx && rx));
@@ -73,6 +83,13 @@ bool spi_transfer(spi_t *spi_p, const uint8_t *tx, uint8_t *rx, size_t length) {
         channel_config_set_read_increment(&spi_p->tx_dma_cfg, false);
     }
 
+#if SPI_DMA_CRC
+    // Sniff what comes from the card, or else what goes to it
+    uint sniffed = rx ? spi_p->rx_dma : spi_p->tx_dma;
+    channel_config_set_sniff_enable(&spi_p->tx_dma_cfg, rx == NULL);
+    channel_config_set_sniff_enable(&spi_p->rx_dma_cfg, rx != NULL);
+#endif
+
     // rx read increment is already false
     if (rx) {
         channel_config_set_write_increment(&spi_p->rx_dma_cfg, true);
@@ -106,15 +123,30 @@ bool spi_transfer(spi_t *spi_p, const uint8_t *tx, uint8_t *rx, size_t length) {
             assert(false);
     }
     sem_reset(&spi_p->sem, 0);
-
+#if SPI_DMA_CRC
+    dma_sniffer_enable(sniffed, DMA_SNIFF_CTRL_CALC_VALUE_CRC16, false);
+    dma_hw->sniff_data = 0;
+#endif
+
+#if SPI_STATS
+    spi_p->dma_length = length;
+    spi_p->dma_start_us = time_us_64();
+#endif
     // start them exactly simultaneously to avoid races (in extreme cases
     // the FIFO could overflow)
     dma_start_channel_mask((1u << spi_p->tx_dma) | (1u << spi_p->rx_dma));
+    return true;
+}
 
+// Waits for the transfer begun by spi_transfer_start
+bool spi_transfer_wait_complete(spi_t *spi_p, uint32_t timeout_ms) {
     /* Wait until master completes transfer or time out has occured. */
-    uint32_t timeOut = 1000; /* Timeout 1 sec */
     bool rc = sem_acquire_timeout_ms(
-        &spi_p->sem, timeOut);  // Wait for notification from ISR
+        &spi_p->sem, timeout_ms);  // Wait for notification from ISR
+#if SPI_STATS
+    // Block streams call start/wait directly, so DMA transfers are counted here
+    spi_account(spi_p, false, spi_p->dma_length, time_us_64() - spi_p->dma_start_us);
+#endif
     if (!rc) {
         // If the timeout is reached the function will return false
         DBG_PRINTF("Notification wait timed out in %s\n", __FUNCTION__);
@@ -131,6 +163,60 @@ bool spi_transfer(spi_t *spi_p, const uint8_t *tx, uint8_t *rx, size_t length) {
     return true;
 }
 
+#if SPI_DMA_CRC
+// CRC16 of the last DMA transfer, from the sniffer
+uint16_t spi_get_crc16(spi_t *spi_p) {
+    (void)spi_p;
+    return (uint16_t)dma_hw->sniff_data;
+}
+#endif
+
+// Short transfers: the CPU feeds and drains the FIFOs itself
+static void spi_transfer_pio(spi_t *spi_p, const uint8_t *tx, uint8_t *rx, size_t length) {
+    if (tx && rx) {
+        spi_write_read_blocking(spi_p->hw_inst, tx, rx, length);
+    } else if (tx) {
+        spi_write_blocking(spi_p->hw_inst, tx, length);
+    } else {
+        spi_read_blocking(spi_p->hw_inst, SPI_FILL_CHAR, rx, length);
+    }
+}
+
+#if SPI_STATS
+void spi_get_stats(spi_t *spi_p, spi_stats_t *stats) {
+    *stats = spi_p->stats;
+}
+
+void spi_reset_stats(spi_t *spi_p) {
+    memset(&spi_p->stats, 0, sizeof(spi_p->stats));
+}
+#endif
+
+// SPI Transfer: Read & Write (simultaneously) on SPI bus
+//   If the data that will be received is not important, pass NULL as rx.
+//   If the data that will be transmitted is not important,
+//     pass NULL as tx and then the SPI_FILL_CHAR is sent out as each data
+//     element.
+//   Below SPI_PIO_THRESHOLD bytes no DMA is involved.
+bool spi_transfer(spi_t *spi_p, const uint8_t *tx, uint8_t *rx, size_t length) {
+    assert(tx || rx);
+#if SPI_STATS
+    uint64_t start_us = time_us_64();
+#endif
+    bool pio = length < SPI_PIO_THRESHOLD;
+    bool rc = true;
+    if (pio) {
+        spi_transfer_pio(spi_p, tx, rx, length);
+    } else {
+        spi_transfer_start(spi_p, tx, rx, length);
+        rc = spi_transfer_wait_complete(spi_p, 1000); /* Timeout 1 sec */
+    }
+#if SPI_STATS
+    if (pio) spi_account(spi_p, true, length, time_us_64() - start_us);
+#endif
+    return rc;
+}
+
 void spi_lock(spi_t *spi_p) {
     assert(mutex_is_initialized(&spi_p->mutex));
     mutex_enter_blocking(&spi_p->mutex);
@@ -27,6 +27,42 @@ specific language governing permissions and limitations under the License.
 
 #define SPI_FILL_CHAR (0xFF)
 
+// Transfers shorter than this are done by programmed I/O on the FIFOs: for a
+// few bytes, setting up two DMA channels and taking the completion interrupt
+// costs more than the bytes themselves (commands, response polls, busy waits)
+#ifndef SPI_PIO_THRESHOLD
+#define SPI_PIO_THRESHOLD 16
+#endif
+
+// 1 = count transfers and their time by size, for tuning the threshold: the
+// PIO ones of spi_transfer and every DMA transfer, including the streamed
+// blocks started with spi_transfer_start
+#ifndef SPI_STATS
+#define SPI_STATS 0
+#endif
+
+// 1 = the DMA sniffer runs a CRC-16-CCITT (the SD data CRC) over every DMA
+// transfer: over the received bytes when rx is given, else over the sent
+// ones. spi_get_crc16 reads it once the transfer is complete. There is one
+// sniffer for all channels, so only one SPI may use DMA at a time.
+#ifndef SPI_DMA_CRC
+#define SPI_DMA_CRC 1
+#endif
+
+// Transfer size buckets: 1, 2, 3-4, 5-8, ..., 257-512, 513 and more bytes
+#define SPI_STATS_BUCKETS 11
+
+typedef struct {
+    uint32_t count;   // Transfers of this size
+    uint64_t us;      // Time spent in them, from the start to the end of the transfer
+                      // (for DMA, to the return of spi_transfer_wait_complete)
+} spi_size_stats_t;
+
+typedef struct {
+    spi_size_stats_t pio[SPI_STATS_BUCKETS];
+    spi_size_stats_t dma[SPI_STATS_BUCKETS];
+} spi_stats_t;
+
 // "Class" representing SPIs
 typedef struct {
     // SPI HW
@@ -53,6 +89,11 @@ typedef struct {
     bool initialized;  
     semaphore_t sem;
     mutex_t mutex;    
+#if SPI_STATS
+    spi_stats_t stats;
+    size_t dma_length;      // DMA transfer in flight, accounted by spi_transfer_wait_complete
+    uint64_t dma_start_us;
+#endif
 } spi_t;
 
 #ifdef __cplusplus
@@ -60,6 +101,15 @@ extern "C" {
 #endif
   
 bool __not_in_flash_func(spi_transfer)(spi_t *pSPI, const uint8_t *tx, uint8_t *rx, size_t length);  
+bool spi_transfer_start(spi_t *pSPI, const uint8_t *tx, uint8_t *rx, size_t length);
+bool spi_transfer_wait_complete(spi_t *pSPI, uint32_t timeout_ms);
+#if SPI_DMA_CRC
+uint16_t spi_get_crc16(spi_t *pSPI);
+#endif
+#if SPI_STATS
+void spi_get_stats(spi_t *pSPI, spi_stats_t *stats);
+void spi_reset_stats(spi_t *pSPI);
+#endif
 void spi_lock(spi_t *pSPI);
 void spi_unlock(spi_t *pSPI);
 bool my_spi_init(spi_t *pSPI);
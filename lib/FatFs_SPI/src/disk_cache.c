@@ -0,0 +1,259 @@
+/* disk_cache.c
+Write-back sector cache between FatFs and the sd_card_t drivers: see
+disk_cache.h.
+*/
+
+#include <stdbool.h>
+#include <string.h>
+//
+#include "pico/mutex.h"
+//
+#include "disk_cache.h"
+
+#if DISK_CACHE_SECTORS
+
+// Held across the card I/O of a miss or a write-back: the lines of a set
+// must not change under it
+auto_init_mutex(cache_lock);
+
+#define DISK_CACHE_SETS (DISK_CACHE_SECTORS / DISK_CACHE_WAYS)
+
+typedef struct {
+    sd_card_t *pSD;     // Drive of the cached sector; NULL = free line
+    uint64_t sector;
+    uint32_t used;      // Access stamp for LRU replacement
+    uint32_t dirtied;   // Stamp of its last write while dirty
+    bool dirty;         // Newer than the card
+} cache_line_t;
+
+static cache_line_t lines[DISK_CACHE_SETS][DISK_CACHE_WAYS];
+static uint8_t data[DISK_CACHE_SETS][DISK_CACHE_WAYS][DISK_CACHE_SECTOR_SIZE];
+static uint32_t stamp;
+static disk_cache_stats_t stats;
+
+static inline uint set_of(uint64_t sector) {
+    return (uint)(sector % DISK_CACHE_SETS);
+}
+
+// Way holding sector in its set, or -1
+static int lookup(sd_card_t *pSD, uint64_t sector) {
+    cache_line_t *set = lines[set_of(sector)];
+    for (int way = 0; way < DISK_CACHE_WAYS; way++) {
+        if (set[way].pSD == pSD && set[way].sector == sector) return way;
+    }
+    return -1;
+}
+
+static int write_back(uint set, int way) {
+    cache_line_t *line = &lines[set][way];
+    int rc = line->pSD->write_blocks(line->pSD, data[set][way], line->sector, 1);
+    if (SD_BLOCK_DEVICE_ERROR_NONE == rc) {
+        line->dirty = false;
+        stats.writebacks++;
+    }
+    return rc;
+}
+
+// Writes back the dirty lines of pSD last written up to the stamp 'through',
+// in the order of those last writes: each sector lands after everything FatFs
+// wrote before its final content, so a directory entry never lands before the
+// data it covers
+static int write_back_through(sd_card_t *pSD, uint32_t through) {
+    for (;;) {
+        uint best_set = 0;
+        int best_way = -1;
+        for (uint set = 0; set < DISK_CACHE_SETS; set++) {
+            for (int way = 0; way < DISK_CACHE_WAYS; way++) {
+                cache_line_t *line = &lines[set][way];
+                if (line->pSD != pSD || !line->dirty || line->dirtied > through) continue;
+                if (best_way < 0 || line->dirtied < lines[best_set][best_way].dirtied) {
+                    best_set = set;
+                    best_way = way;
+                }
+            }
+        }
+        if (best_way < 0) return SD_BLOCK_DEVICE_ERROR_NONE;
+        int rc = write_back(best_set, best_way);
+        if (SD_BLOCK_DEVICE_ERROR_NONE != rc) return rc;
+    }
+}
+
+// Frees a line of the set for sector: an empty one, else the least recently
+// used, written back first when dirty (with the lines dirtied before it)
+static int allocate(sd_card_t *pSD, uint64_t sector, int *way_p) {
+    uint set = set_of(sector);
+    int victim = 0;
+    for (int way = 0; way < DISK_CACHE_WAYS; way++) {
+        if (!lines[set][way].pSD) {
+            victim = way;
+            break;
+        }
+        if (lines[set][way].used < lines[set][victim].used) victim = way;
+    }
+    cache_line_t *line = &lines[set][victim];
+    if (line->pSD) {
+        if (line->dirty) {
+            int rc = write_back_through(line->pSD, line->dirtied);
+            if (SD_BLOCK_DEVICE_ERROR_NONE != rc) return rc;
+        }
+        stats.evictions++;
+    }
+    line->pSD = pSD;
+    line->sector = sector;
+    line->dirty = false;
+    *way_p = victim;
+    return SD_BLOCK_DEVICE_ERROR_NONE;
+}
+
+static inline void touch(uint set, int way) {
+    lines[set][way].used = ++stamp;
+}
+
+// ========================== Reading ==========================
+
+static int read_locked(sd_card_t *pSD, uint8_t *buffer, uint64_t sector, uint32_t count) {
+    if (count > 1) {
+        // Bulk read from the card; sectors only the cache has up to date win
+        stats.bypassed++;
+        int rc = pSD->read_blocks(pSD, buffer, sector, count);
+        if (SD_BLOCK_DEVICE_ERROR_NONE != rc) return rc;
+        for (uint32_t i = 0; i < count; i++) {
+            int way = lookup(pSD, sector + i);
+            if (way >= 0 && lines[set_of(sector + i)][way].dirty) {
+                memcpy(buffer + i * DISK_CACHE_SECTOR_SIZE, data[set_of(sector + i)][way],
+                       DISK_CACHE_SECTOR_SIZE);
+            }
+        }
+        return SD_BLOCK_DEVICE_ERROR_NONE;
+    }
+
+    uint set = set_of(sector);
+    int way = lookup(pSD, sector);
+    if (way >= 0) {
+        stats.read_hits++;
+    } else {
+        stats.read_misses++;
+        int rc = allocate(pSD, sector, &way);
+        if (SD_BLOCK_DEVICE_ERROR_NONE != rc) return rc;
+        rc = pSD->read_blocks(pSD, data[set][way], sector, 1);
+        if (SD_BLOCK_DEVICE_ERROR_NONE != rc) {
+            lines[set][way].pSD = NULL;
+            return rc;
+        }
+    }
+    touch(set, way);
+    memcpy(buffer, data[set][way], DISK_CACHE_SECTOR_SIZE);
+    return SD_BLOCK_DEVICE_ERROR_NONE;
+}
+
+int disk_cache_read(sd_card_t *pSD, uint8_t *buffer, uint64_t sector, uint32_t count) {
+    mutex_enter_blocking(&cache_lock);
+    int rc = read_locked(pSD, buffer, sector, count);
+    mutex_exit(&cache_lock);
+    return rc;
+}
+
+// ========================== Writing ==========================
+
+static int write_locked(sd_card_t *pSD, const uint8_t *buffer, uint64_t sector, uint32_t count) {
+    if (count > 1) {
+        // Bulk write to the card; cached copies take the new data, now clean
+        stats.bypassed++;
+        int rc = pSD->write_blocks(pSD, buffer, sector, count);
+        if (SD_BLOCK_DEVICE_ERROR_NONE != rc) return rc;
+        for (uint32_t i = 0; i < count; i++) {
+            int way = lookup(pSD, sector + i);
+            if (way >= 0) {
+                memcpy(data[set_of(sector + i)][way], buffer + i * DISK_CACHE_SECTOR_SIZE,
+                       DISK_CACHE_SECTOR_SIZE);
+                lines[set_of(sector + i)][way].dirty = false;
+            }
+        }
+        return SD_BLOCK_DEVICE_ERROR_NONE;
+    }
+
+    uint set = set_of(sector);
+    int way = lookup(pSD, sector);
+    if (way >= 0) {
+        stats.write_hits++;
+    } else {
+        stats.write_misses++;
+        int rc = allocate(pSD, sector, &way);
+        if (SD_BLOCK_DEVICE_ERROR_NONE != rc) return rc;
+    }
+    memcpy(data[set][way], buffer, DISK_CACHE_SECTOR_SIZE);
+    touch(set, way);
+    lines[set][way].dirty = true;
+    lines[set][way].dirtied = stamp;
+    return SD_BLOCK_DEVICE_ERROR_NONE;
+}
+
+int disk_cache_write(sd_card_t *pSD, const uint8_t *buffer, uint64_t sector, uint32_t count) {
+    mutex_enter_blocking(&cache_lock);
+    int rc = write_locked(pSD, buffer, sector, count);
+    mutex_exit(&cache_lock);
+    return rc;
+}
+
+// ========================== Maintenance ==========================
+
+int disk_cache_flush(sd_card_t *pSD) {
+    mutex_enter_blocking(&cache_lock);
+    stats.flushes++;
+    int rc = write_back_through(pSD, UINT32_MAX);
+    mutex_exit(&cache_lock);
+    return rc;
+}
+
+void disk_cache_discard(sd_card_t *pSD, uint64_t start, uint64_t end) {
+    mutex_enter_blocking(&cache_lock);
+    for (uint set = 0; set < DISK_CACHE_SETS; set++) {
+        for (int way = 0; way < DISK_CACHE_WAYS; way++) {
+            cache_line_t *line = &lines[set][way];
+            if (line->pSD == pSD && line->sector >= start && line->sector <= end) line->pSD = NULL;
+        }
+    }
+    mutex_exit(&cache_lock);
+}
+
+void disk_cache_get_stats(disk_cache_stats_t *stats_p) {
+    *stats_p = stats;
+}
+
+void disk_cache_reset_stats(void) {
+    memset(&stats, 0, sizeof(stats));
+}
+
+#else
+
+// No cache: straight to the card
+
+int disk_cache_read(sd_card_t *pSD, uint8_t *buffer, uint64_t sector, uint32_t count) {
+    return pSD->read_blocks(pSD, buffer, sector, count);
+}
+
+int disk_cache_write(sd_card_t *pSD, const uint8_t *buffer, uint64_t sector, uint32_t count) {
+    return pSD->write_blocks(pSD, buffer, sector, count);
+}
+
+int disk_cache_flush(sd_card_t *pSD) {
+    (void)pSD;
+    return SD_BLOCK_DEVICE_ERROR_NONE;
+}
+
+void disk_cache_discard(sd_card_t *pSD, uint64_t start, uint64_t end) {
+    (void)pSD;
+    (void)start;
+    (void)end;
+}
+
+void disk_cache_get_stats(disk_cache_stats_t *stats_p) {
+    memset(stats_p, 0, sizeof(*stats_p));
+}
+
+void disk_cache_reset_stats(void) {
+}
+
+#endif
+
+/* [] END OF FILE */
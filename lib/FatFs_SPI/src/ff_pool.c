@@ -0,0 +1,66 @@
+/* ff_pool.c
+Fixed-size block pools: see ff_pool.h.
+*/
+
+#include <stdlib.h>
+//
+#include "pico/mutex.h"
+//
+#include "ff_pool.h"
+
+// ff_fopen runs outside the FatFs volume lock: the free lists get their own
+auto_init_mutex(pool_lock);
+
+static bool owns(const ff_pool_t *pool, const void *block) {
+    const uint8_t *p = block;
+    return p >= pool->storage && p < pool->storage + pool->blocks * pool->stride;
+}
+
+void *ff_pool_alloc(ff_pool_t *pool, size_t size) {
+    void *block = NULL;
+    mutex_enter_blocking(&pool_lock);
+    if (size <= pool->block_size) {
+        if (pool->free_list) {
+            block = pool->free_list;
+            pool->free_list = *(void **)block;
+        } else if (pool->fresh < pool->blocks) {
+            // Blocks are carved off the storage the first time they are needed,
+            // so the pool needs no initialization
+            block = pool->storage + pool->fresh++ * pool->stride;
+        }
+    }
+    if (!block) {
+        pool->stats.failures++;
+#if FF_POOL_HEAP_FALLBACK
+        block = malloc(size);
+        if (block) pool->stats.heap_fallbacks++;
+#endif
+        mutex_exit(&pool_lock);
+        return block;
+    }
+    pool->stats.allocs++;
+    if (++pool->stats.in_use > pool->stats.high_water) pool->stats.high_water = pool->stats.in_use;
+    mutex_exit(&pool_lock);
+    return block;
+}
+
+void ff_pool_free(ff_pool_t *pool, void *block) {
+    if (!block) return;
+    if (!owns(pool, block)) {
+#if FF_POOL_HEAP_FALLBACK
+        free(block);
+#endif
+        return;
+    }
+    mutex_enter_blocking(&pool_lock);
+    *(void **)block = pool->free_list;
+    pool->free_list = block;
+    pool->stats.in_use--;
+    mutex_exit(&pool_lock);
+}
+
+void ff_pool_get_stats(const ff_pool_t *pool, ff_pool_stats_t *stats) {
+    *stats = pool->stats;
+}
+
+/* [] END OF FILE */
@@ -22,11 +22,41 @@ specific language governing permissions and limitations under the License.
 #include "my_debug.h"
 //
 #include "f_util.h"
+#include "ff_pool.h"
 #include "ff_stdio.h"
 
 #define TRACE_PRINTF(fmt, args...) {}
 //#define TRACE_PRINTF printf
 
+// Streams come from a fixed pool rather than the heap
+FF_POOL_DEFINE(ff_file_pool, sizeof(FF_FILE), FF_POOL_FILE_BLOCKS);
+
+static void init_buffering(FF_FILE *pxStream) {
+#if FF_STDIO_BUFFER_SIZE
+    pxStream->buffer = pxStream->own_buffer;
+    pxStream->size = sizeof(pxStream->own_buffer);
+    pxStream->mode = FF_IOFBF;
+#else
+    pxStream->buffer = NULL;
+    pxStream->size = 0;
+    pxStream->mode = FF_IONBF;
+#endif
+    pxStream->count = 0;
+}
+
+// Hands the pending bytes to f_write; whatever it did not take stays pending
+static FRESULT flush_buffer(FF_FILE *pxStream) {
+    if (!pxStream->count) return FR_OK;
+    UINT bw = 0;
+    FRESULT fr = f_write(&pxStream->fil, pxStream->buffer, pxStream->count, &bw);
+    if (FR_OK == fr && bw != pxStream->count) fr = FR_DENIED;  // Volume full
+    if (bw) memmove(pxStream->buffer, pxStream->buffer + bw, pxStream->count - bw);
+    pxStream->count -= bw;
+    if (FR_OK != fr)
+        TRACE_PRINTF("%s error: %s (%d)\n", __func__, FRESULT_str(fr), fr);
+    return fr;
+}
+
 static BYTE posix2mode(const char *pcMode) {
     if (0 == strcmp("r", pcMode)) return FA_READ;
     if (0 == strcmp("r+", pcMode)) return FA_READ | FA_WRITE;
@@ -94,16 +124,17 @@ FF_FILE *ff_fopen(const char *pcFile, const char *pcMode) {
     //  const TCHAR* path, /* [IN] File name */
     //  BYTE mode          /* [IN] Mode flags */
     //);
-    FIL *fp = malloc(sizeof(FIL));
+    FF_FILE *fp = ff_pool_alloc(&ff_file_pool, sizeof(FF_FILE));
     if (!fp) {
         errno = ENOMEM;
         return NULL;
     }
-    FRESULT fr = f_open(fp, pcFile, posix2mode(pcMode));
+    init_buffering(fp);
+    FRESULT fr = f_open(&fp->fil, pcFile, posix2mode(pcMode));
     errno = fresult2errno(fr);
     if (FR_OK != fr) {
         TRACE_PRINTF("%s error: %s (%d)\n", __func__, FRESULT_str(fr), fr);
-        free(fp);
+        ff_pool_free(&ff_file_pool, fp);
         fp = 0;
     }
     return fp;
@@ -113,11 +144,13 @@ int ff_fclose(FF_FILE *pxStream) {
     // FRESULT f_close (
     //  FIL* fp     /* [IN] Pointer to the file object */
     //);
-    FRESULT fr = f_close(pxStream);
+    FRESULT fr = flush_buffer(pxStream);
+    FRESULT fr_close = f_close(&pxStream->fil);
+    if (FR_OK == fr) fr = fr_close;
     if (FR_OK != fr)
         TRACE_PRINTF("%s error: %s (%d)\n", __func__, FRESULT_str(fr), fr);
     errno = fresult2errno(fr);
-    free(pxStream);
+    ff_pool_free(&ff_file_pool, pxStream);
     if (FR_OK == fr)
         return 0;
     else
@@ -152,12 +185,33 @@ size_t ff_fwrite(const void *pvBuffer, size_t xSize, size_t xItems,
     //  UINT* bw          /* [OUT] Pointer to the variable to return number of
     //  bytes written */
     //);
-    UINT bw = 0;
-    FRESULT fr = f_write(pxStream, pvBuffer, xSize * xItems, &bw);
+    size_t bytes = xSize * xItems;
+    if (!bytes) return 0;
+    const uint8_t *data = pvBuffer;
+    FRESULT fr = FR_OK;
+    size_t done = 0;
+    if (pxStream->mode == FF_IONBF || bytes >= pxStream->size) {
+        // No buffering, or more than a buffer: straight to FatFs after what
+        // is pending
+        fr = flush_buffer(pxStream);
+        if (FR_OK == fr) {
+            UINT bw = 0;
+            fr = f_write(&pxStream->fil, data, bytes, &bw);
+            done = bw;
+        }
+    } else {
+        if (pxStream->count + bytes > pxStream->size) fr = flush_buffer(pxStream);
+        if (FR_OK == fr) {
+            memcpy(pxStream->buffer + pxStream->count, data, bytes);
+            pxStream->count += bytes;
+            done = bytes;
+            if (pxStream->mode == FF_IOLBF && memchr(data, '\n', bytes)) fr = flush_buffer(pxStream);
+        }
+    }
     if (FR_OK != fr)
         TRACE_PRINTF("%s error: %s (%d)\n", __func__, FRESULT_str(fr), fr);
     errno = fresult2errno(fr);
-    return bw / xSize;
+    return done / xSize;
 }
 size_t ff_fread(void *pvBuffer, size_t xSize, size_t xItems,
                 FF_FILE *pxStream) {
@@ -169,7 +223,8 @@ size_t ff_fread(void *pvBuffer, size_t xSize, size_t xItems,
     //  UINT* br     /* [OUT] Number of bytes read */
     //);
     UINT br = 0;
-    FRESULT fr = f_read(pxStream, pvBuffer, xSize * xItems, &br);
+    FRESULT fr = flush_buffer(pxStream);
+    if (FR_OK == fr) fr = f_read(&pxStream->fil, pvBuffer, xSize * xItems, &br);
     if (FR_OK != fr)
         TRACE_PRINTF("%s error: %s (%d)\n", __func__, FRESULT_str(fr), fr);
     errno = fresult2errno(fr);
@@ -238,9 +293,20 @@ int ff_fputc(int iChar, FF_FILE *pxStream) {
     //  bytes written */
     //);
     UINT bw = 0;
-    uint8_t buff[1];
-    buff[0] = iChar;
-    FRESULT fr = f_write(pxStream, buff, 1, &bw);
+    FRESULT fr = FR_OK;
+    if (pxStream->mode != FF_IONBF) {
+        // Buffered: FatFs only sees the byte when the buffer (or line) is done
+        if (pxStream->count == pxStream->size) fr = flush_buffer(pxStream);
+        if (FR_OK == fr) {
+            pxStream->buffer[pxStream->count++] = (uint8_t)iChar;
+            bw = 1;
+            if (pxStream->mode == FF_IOLBF && '\n' == iChar) fr = flush_buffer(pxStream);
+        }
+    } else {
+        uint8_t buff[1];
+        buff[0] = iChar;
+        fr = f_write(&pxStream->fil, buff, 1, &bw);
+    }
     if (FR_OK != fr)
         TRACE_PRINTF("%s error: %s (%d)\n", __func__, FRESULT_str(fr), fr);
     errno = fresult2errno(fr);
@@ -262,8 +328,9 @@ int ff_fgetc(FF_FILE *pxStream) {
     //  UINT* br     /* [OUT] Number of bytes read */
     //);
     uint8_t buff[1] = {0};
-    UINT br;
-    FRESULT fr = f_read(pxStream, buff, 1, &br);
+    UINT br = 0;
+    FRESULT fr = flush_buffer(pxStream);
+    if (FR_OK == fr) fr = f_read(&pxStream->fil, buff, 1, &br);
     if (FR_OK != fr)
         TRACE_PRINTF("%s error: %s (%d)\n", __func__, FRESULT_str(fr), fr);
     errno = fresult2errno(fr);
@@ -304,25 +371,30 @@ long ff_ftell(FF_FILE *pxStream) {
     // FSIZE_t f_tell (
     //  FIL* fp   /* [IN] File object */
     //);
-    FSIZE_t pos = f_tell(pxStream);
+    FSIZE_t pos = f_tell(&pxStream->fil) + pxStream->count;
     myASSERT(pos < LONG_MAX);
     return pos;
 }
 int ff_fseek(FF_FILE *pxStream, int iOffset, int iWhence) {
     TRACE_PRINTF("%s\n", __func__);
-    FRESULT fr = -1;
+    FRESULT fr = flush_buffer(pxStream);
+    if (FR_OK != fr) {
+        errno = fresult2errno(fr);
+        return -1;
+    }
+    FIL *fp = &pxStream->fil;
     switch (iWhence) {
         case FF_SEEK_CUR:  // The current file position.
-            if ((int)f_tell(pxStream) + iOffset < 0) return -1;
-            fr = f_lseek(pxStream, f_tell(pxStream) + iOffset);
+            if ((int)f_tell(fp) + iOffset < 0) return -1;
+            fr = f_lseek(fp, f_tell(fp) + iOffset);
             break;
         case FF_SEEK_END:  // The end of the file.
-            if ((int)f_size(pxStream) + iOffset < 0) return -1;
-            fr = f_lseek(pxStream, f_size(pxStream) + iOffset);
+            if ((int)f_size(fp) + iOffset < 0) return -1;
+            fr = f_lseek(fp, f_size(fp) + iOffset);
             break;
         case FF_SEEK_SET:  // The beginning of the file.
             if (iOffset < 0) return -1;
-            fr = f_lseek(pxStream, iOffset);
+            fr = f_lseek(fp, iOffset);
             break;
         default:
             myASSERT(!"Bad iWhence");
@@ -389,16 +461,18 @@ int ff_findnext(FF_FindData_t *pxFindData) {
 }
 FF_FILE *ff_truncate(const char *pcFileName, long lTruncateSize) {
     TRACE_PRINTF("%s\n", __func__);
-    FIL *fp = malloc(sizeof(FIL));
-    if (!fp) {
+    FF_FILE *stream = ff_pool_alloc(&ff_file_pool, sizeof(FF_FILE));
+    if (!stream) {
         errno = ENOMEM;
         return NULL;
     }
+    init_buffering(stream);
+    FIL *fp = &stream->fil;
     FRESULT fr = f_open(fp, pcFileName, FA_OPEN_APPEND | FA_WRITE);
     if (FR_OK != fr)
         printf("%s: f_open error: %s (%d)\n", __func__, FRESULT_str(fr), fr);
     errno = fresult2errno(fr);
-    if (FR_OK != fr) return NULL;
+    if (FR_OK != fr) goto fail;
     while (f_tell(fp) < (FSIZE_t)lTruncateSize) {
         UINT bw = 0;
         char c = 0;
@@ -406,26 +480,30 @@ FF_FILE *ff_truncate(const char *pcFileName, long lTruncateSize) {
         if (FR_OK != fr)
             TRACE_PRINTF("%s error: %s (%d)\n", __func__, FRESULT_str(fr), fr);
         errno = fresult2errno(fr);
-        if (1 != bw) return NULL;
+        if (1 != bw) goto fail;
     }
     fr = f_lseek(fp, lTruncateSize);
     errno = fresult2errno(fr);
     if (FR_OK != fr)
         printf("%s: f_lseek error: %s (%d)\n", __func__, FRESULT_str(fr), fr);
-    if (FR_OK != fr) return NULL;
+    if (FR_OK != fr) goto fail;
     fr = f_truncate(fp);
     if (FR_OK != fr)
         printf("%s: f_truncate error: %s (%d)\n", __func__, FRESULT_str(fr),
                fr);
     errno = fresult2errno(fr);
     if (FR_OK == fr)
-        return fp;
-    else
-        return NULL;
+        return stream;
+fail:
+    // The stream goes back to the pool, open or not
+    f_close(fp);
+    ff_pool_free(&ff_file_pool, stream);
+    return NULL;
 }
 int ff_seteof(FF_FILE *pxStream) {
     TRACE_PRINTF("%s\n", __func__);
-    FRESULT fr = f_truncate(pxStream);
+    FRESULT fr = flush_buffer(pxStream);
+    if (FR_OK == fr) fr = f_truncate(&pxStream->fil);
     errno = fresult2errno(fr);
     if (FR_OK == fr)
         return 0;
@@ -451,7 +529,8 @@ int ff_rename(const char *pcOldName, const char *pcNewName,
 }
 char *ff_fgets(char *pcBuffer, size_t xCount, FF_FILE *pxStream) {
     TRACE_PRINTF("%s\n", __func__);
-    TCHAR *p = f_gets(pcBuffer, xCount, pxStream);
+    TCHAR *p = NULL;
+    if (FR_OK == flush_buffer(pxStream)) p = f_gets(pcBuffer, xCount, &pxStream->fil);
     // On success a pointer to pcBuffer is returned. If there is a read error
     // then NULL is returned and the task's errno is set to indicate the reason.
     if (p == pcBuffer)
@@ -460,4 +539,52 @@ char *ff_fgets(char *pcBuffer, size_t xCount, FF_FILE *pxStream) {
         errno = EIO;
         return NULL;
     }
-}
\ No newline at end of file
+}
+int ff_setvbuf(FF_FILE *pxStream, char *pcBuffer, int iMode, size_t xSize) {
+    TRACE_PRINTF("%s\n", __func__);
+    // Pending bytes were buffered under the old setting: write them first
+    FRESULT fr = flush_buffer(pxStream);
+    errno = fresult2errno(fr);
+    if (FR_OK != fr) return -1;
+    if (iMode != FF_IOFBF && iMode != FF_IOLBF && iMode != FF_IONBF) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (pcBuffer) {
+        pxStream->buffer = (uint8_t *)pcBuffer;
+        pxStream->size = xSize;
+    } else {
+#if FF_STDIO_BUFFER_SIZE
+        pxStream->buffer = pxStream->own_buffer;
+        pxStream->size = xSize && xSize < sizeof(pxStream->own_buffer) ? xSize : sizeof(pxStream->own_buffer);
+#else
+        pxStream->buffer = NULL;
+        pxStream->size = 0;
+#endif
+    }
+    // Nowhere to buffer into: unbuffered whatever was asked
+    pxStream->mode = pxStream->size ? iMode : FF_IONBF;
+    return 0;
+}
+int ff_fflush(FF_FILE *pxStream) {
+    TRACE_PRINTF("%s\n", __func__);
+    FRESULT fr = flush_buffer(pxStream);
+    if (FR_OK == fr) fr = f_sync(&pxStream->fil);
+    errno = fresult2errno(fr);
+    if (FR_OK == fr)
+        return 0;
+    else
+        return FF_EOF;
+}
+void ff_rewind(FF_FILE *pxStream) {
+    ff_fseek(pxStream, 0, FF_SEEK_SET);
+}
+long ff_filelength(FF_FILE *pxStream) {
+    // Pending bytes past the end of the file will make it longer
+    FSIZE_t end = f_tell(&pxStream->fil) + pxStream->count;
+    FSIZE_t size = f_size(&pxStream->fil);
+    return end > size ? end : size;
+}
+int ff_feof(FF_FILE *pxStream) {
+    return !pxStream->count && f_eof(&pxStream->fil);
+}
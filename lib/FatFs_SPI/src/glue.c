@@ -25,6 +25,7 @@ specific language governing permissions and limitations under the License.
 //
 #include "diskio.h" /* Declarations of disk functions */
 //
+#include "disk_cache.h"
 #include "hw_config.h"
 #include "my_debug.h"
 #include "sd_card.h"
@@ -59,6 +60,15 @@ DSTATUS disk_initialize(
 
     sd_card_t *p_sd = sd_get_by_num(pdrv);
     if (!p_sd) return RES_PARERR;
+    // FatFs only gets here for a new mount or a lost card. Sectors written
+    // but not synced go to the card first; the flush fails when the driver has
+    // lost it (STA_NOINIT), and then they cannot be saved: what is cached may
+    // belong to another medium.
+    int rc_flush = disk_cache_flush(p_sd);
+    if (SD_BLOCK_DEVICE_ERROR_NONE != rc_flush) {
+        printf("disk_initialize: unsynced cached sectors of drive %d lost (%d)\n", pdrv, rc_flush);
+    }
+    disk_cache_discard(p_sd, 0, UINT64_MAX);
     // See http://elm-chan.org/fsw/ff/doc/dstat.html
     return p_sd->init(p_sd);  
 }
@@ -98,7 +108,7 @@ DRESULT disk_read(BYTE pdrv,  /* Physical drive nmuber to identify the drive */
     TRACE_PRINTF(">>> %s\n", __FUNCTION__);
     sd_card_t *p_sd = sd_get_by_num(pdrv);
     if (!p_sd) return RES_PARERR;
-    int rc = p_sd->read_blocks(p_sd, buff, sector, count);
+    int rc = disk_cache_read(p_sd, buff, sector, count);
     return sdrc2dresult(rc);
 }
 
@@ -116,7 +126,7 @@ DRESULT disk_write(BYTE pdrv, /* Physical drive nmuber to identify the drive */
     TRACE_PRINTF(">>> %s\n", __FUNCTION__);
     sd_card_t *p_sd = sd_get_by_num(pdrv);
     if (!p_sd) return RES_PARERR;
-    int rc = p_sd->write_blocks(p_sd, buff, sector, count);
+    int rc = disk_cache_write(p_sd, buff, sector, count);
     return sdrc2dresult(rc);
 }
 
@@ -142,7 +152,7 @@ DRESULT disk_ioctl(BYTE pdrv, /* Physical drive nmuber (0..) */
                                   // volume/partition to be created. It is
                                   // required when FF_USE_MKFS == 1.
             static LBA_t n;
-            n = sd_sectors(p_sd);
+            n = p_sd->get_num_sectors(p_sd);
             *(LBA_t *)buff = n;
             if (!n) return RES_ERROR;
             return RES_OK;
@@ -156,12 +166,30 @@ DRESULT disk_ioctl(BYTE pdrv, /* Physical drive nmuber (0..) */
                                 // f_mkfs function and it attempts to align data
                                 // area on the erase block boundary. It is
                                 // required when FF_USE_MKFS == 1.
-            static DWORD bs = 1;
-            *(DWORD *)buff = bs;
+            // The card's allocation unit, rounded down to what f_mkfs takes
+            DWORD bs = p_sd->au_sectors;
+            if (bs > 32768) bs = 32768;
+            while (bs & (bs - 1)) bs &= bs - 1;
+            *(DWORD *)buff = bs ? bs : 1;
             return RES_OK;
         }
-        case CTRL_SYNC:
-            return RES_OK;
+        case CTRL_SYNC: {  // Makes sure that the device has finished pending
+                           // write process: the dirty sectors of the cache,
+                           // then the programming of the last block written
+            int rc = disk_cache_flush(p_sd);
+            if (SD_BLOCK_DEVICE_ERROR_NONE == rc && p_sd->sync) rc = p_sd->sync(p_sd);
+            return sdrc2dresult(rc);
+        }
+        case CTRL_TRIM: {  // Informs the device that the data on the block of
+                           // sectors from ((LBA_t *)buff)[0] to [1] is no
+                           // longer needed, so it may be erased. This command
+                           // is used by f_mkfs and by freeing clusters when
+                           // FF_USE_TRIM == 1.
+            if (!p_sd->trim) return RES_PARERR;
+            const LBA_t *range = buff;
+            disk_cache_discard(p_sd, range[0], range[1]);
+            return sdrc2dresult(p_sd->trim(p_sd, range[0], range[1]));
+        }
         default:
             return RES_PARERR;
     }
@@ -7,6 +7,7 @@
 #include "pico/stdlib.h"
 #include "pico/binary_info.h"
 #include "hardware/i2c.h"
+#include "hardware/sync.h"
 
 
 #if defined(SSD1306_USE_I2C) // Checks if the I2C protocol is enabled.
@@ -15,13 +16,25 @@
 const uint8_t I2C_SDA_PIN_OLED = 14;
 const uint8_t I2C_SCL_PIN_OLED = 15;
 
+// Transaction queue of the display bus; NULL keeps the blocking SDK writes
+static i2c_queue* SSD1306_Queue = NULL;
+
+// Sends a buffer to the display, through the queue when one is attached; false on a NACK
+static bool ssd1306_Write(const uint8_t* buffer, size_t size) {
+    if (SSD1306_Queue) {
+        return i2c_queue_transfer_blocking(SSD1306_Queue, SSD1306_I2C_ADDR, buffer, size, NULL, 0);
+    }
+    // Sends the buffer via I2C to the display address.
+    return i2c_write_blocking(SSD1306_I2C_PORT, SSD1306_I2C_ADDR, buffer, size, false) == (int)size;
+}
+
 // Send a byte to the command register
 void ssd1306_WriteCommand(uint8_t byte) {
     uint8_t buffer[2];           // Buffer containing the register and the data (Creates a 2-byte buffer.)
     buffer[0] = 0x00;            // Register address, sets the control byte to 0x00 (indicates that it is a command).
     buffer[1] = byte;            // Stores the command to be sent. Data to be sent. 
 
-    i2c_write_blocking(SSD1306_I2C_PORT, SSD1306_I2C_ADDR, buffer, sizeof(buffer), false); // Sends the buffer via I2C to the display address.
+    ssd1306_Write(buffer, sizeof(buffer));
 }
 
 // Send data
@@ -30,7 +43,7 @@ void ssd1306_WriteData(uint8_t* buffer, size_t buff_size) {
     temp_buffer[0] = 0x40;             // Sets the control byte to 0x40 (indicates that it is data).
     memcpy(&temp_buffer[1], buffer, buff_size); // Copies data to the temporary buffer
 
-    i2c_write_blocking(SSD1306_I2C_PORT, SSD1306_I2C_ADDR, temp_buffer, sizeof(temp_buffer), false); // Envia o buffer via I2C.
+    ssd1306_Write(temp_buffer, sizeof(temp_buffer)); // Envia o buffer via I2C.
 }
 
 #else
@@ -38,16 +51,208 @@ void ssd1306_WriteData(uint8_t* buffer, size_t buff_size) {
 #endif
 
 
-static uint8_t SSD1306_Buffer[SSD1306_BUFFER_SIZE]; // Creates a buffer to store the state of each pixel (1 bit per pixel). Size: 1024 bytes.
+#define SSD1306_PAGES (SSD1306_HEIGHT/8)
+
+// Screen buffer (1 bit per pixel, 1024 bytes), one row per page. Each page is preceded
+// by a slot holding the 0x40 data control byte, so pages go to the I2C peripheral
+// straight from here instead of through a copy.
+static uint8_t SSD1306_Frame[SSD1306_PAGES][SSD1306_WIDTH + 1];
+#define SSD1306_PIXELS(page) (&SSD1306_Frame[page][1])
 
 // Display object
 static SSD1306_t SSD1306;
+#define SSD1306_X_OFFSET_COLUMN (SSD1306_X_OFFSET_LOWER | (SSD1306_X_OFFSET_UPPER << 4))
+
+// Column range of each page touched since the last update (min > max = clean)
+static uint8_t SSD1306_DirtyMin[SSD1306_PAGES];
+static uint8_t SSD1306_DirtyMax[SSD1306_PAGES];
+// Display RAM as last sent; redrawn but unchanged columns are not sent again
+static uint8_t SSD1306_Shadow[SSD1306_BUFFER_SIZE];
+static uint8_t SSD1306_ShadowValid = 0;
+// I2C payload bytes (control bytes included) of the last update and since init
+static uint32_t SSD1306_FrameBytes = 0;
+static uint32_t SSD1306_TotalBytes = 0;
+
+// Marks columns x1..x2 of a page as changed
+static inline void ssd1306_MarkDirty(uint8_t page, uint8_t x1, uint8_t x2) {
+    if (x1 < SSD1306_DirtyMin[page]) SSD1306_DirtyMin[page] = x1;
+    if (x2 > SSD1306_DirtyMax[page]) SSD1306_DirtyMax[page] = x2;
+}
+
+// A span that did not reach the display: the shadow already holds it, so the
+// diff is switched off until the next update has resent the span
+static inline void ssd1306_MarkFailed(uint8_t page, uint8_t x1, uint8_t x2) {
+    ssd1306_MarkDirty(page, x1, x2);
+    SSD1306_ShadowValid = 0;
+}
+
+static void ssd1306_MarkAllDirty(void) {
+    for (uint8_t i = 0; i < SSD1306_PAGES; i++) {
+        SSD1306_DirtyMin[i] = 0;
+        SSD1306_DirtyMax[i] = SSD1306_WIDTH - 1;
+    }
+}
+
+// Narrows the dirty range of a page to the columns that differ from the display;
+// returns 0 when nothing has to be sent
+static uint8_t ssd1306_ChangedSpan(uint8_t page, uint8_t* start, uint8_t* end) {
+    uint8_t first = SSD1306_DirtyMin[page], last = SSD1306_DirtyMax[page];
+    SSD1306_DirtyMin[page] = 0xFF;
+    SSD1306_DirtyMax[page] = 0;
+    if (first > last) return 0;
+
+    if (SSD1306_ShadowValid) {
+        const uint8_t* now = SSD1306_PIXELS(page);
+        const uint8_t* sent = &SSD1306_Shadow[SSD1306_WIDTH*page];
+        while (first <= last && now[first] == sent[first]) first++;
+        if (first > last) return 0;
+        while (now[last] == sent[last]) last--;
+    }
+    memcpy(&SSD1306_Shadow[SSD1306_WIDTH*page + first], &SSD1306_PIXELS(page)[first], last - first + 1);
+    *start = first;
+    *end = last;
+    return 1;
+}
+
+// Command transaction selecting the window page/start..end (horizontal addressing mode)
+static void ssd1306_PageWindow(uint8_t* cmd, uint8_t page, uint8_t start, uint8_t end) {
+    cmd[0] = 0x00;                                  // Co = 0: the rest are commands
+    cmd[1] = 0x21;                                  // Column address
+    cmd[2] = start + SSD1306_X_OFFSET_COLUMN;
+    cmd[3] = end + SSD1306_X_OFFSET_COLUMN;
+    cmd[4] = 0x22;                                  // Page address
+    cmd[5] = page;
+    cmd[6] = page;
+}
+
+/* Bytes sent over I2C by the last ssd1306_UpdateScreen() */
+uint32_t ssd1306_GetFrameBytes(void) {
+    return SSD1306_FrameBytes;
+}
+
+/* Bytes sent over I2C by ssd1306_UpdateScreen() since ssd1306_Init() */
+uint32_t ssd1306_GetTotalBytes(void) {
+    return SSD1306_TotalBytes;
+}
+
+// Addressing commands of each page being sent through the queue
+static uint8_t SSD1306_TxCommands[SSD1306_PAGES][7];
+// Byte of each page temporarily replaced by the 0x40 control byte while it is sent
+static uint8_t SSD1306_TxStart[SSD1306_PAGES];
+static uint8_t SSD1306_TxEnd[SSD1306_PAGES];
+static uint8_t SSD1306_TxSaved[SSD1306_PAGES];
+// Queued and completed transactions; each counter has a single writer
+static uint32_t SSD1306_TxSubmitted = 0;
+static volatile uint32_t SSD1306_TxCompleted = 0;
+// Called when the last transaction of a queued update has completed
+static ssd1306_UpdateCallback SSD1306_UpdateDone = NULL;
+static void* SSD1306_UpdateContext = NULL;
+
+#define SSD1306_TX_LAST 0x100 // Context flag of the last data transaction of an update
+
+_Static_assert(SSD1306_WIDTH + 1 <= I2C_QUEUE_MAX_BYTES, "I2C_QUEUE_MAX_BYTES must hold one page");
+
+// Drawing waits here while a queued update still reads the screen buffer
+static inline void ssd1306_WaitTx(void) {
+    while (SSD1306_TxSubmitted != SSD1306_TxCompleted) __wfe();
+}
+
+/* Attach the display to a DMA transaction queue */
+void ssd1306_SetQueue(i2c_queue* queue) {
+    SSD1306_Queue = queue;
+}
+
+/* Set the function called when a queued update has been sent */
+void ssd1306_SetUpdateCallback(ssd1306_UpdateCallback callback, void* context) {
+    SSD1306_UpdateDone = callback;
+    SSD1306_UpdateContext = context;
+}
+
+/* Check whether a queued update is still being sent */
+uint8_t ssd1306_IsUpdating(void) {
+    return SSD1306_TxSubmitted != SSD1306_TxCompleted;
+}
+
+// Completion of a command transaction; without its window the page data is lost too
+static void ssd1306_TxCommandDone(bool ok, void* context) {
+    uint8_t page = (uintptr_t)context & 0xFF;
+    if (!ok) ssd1306_MarkFailed(page, SSD1306_TxStart[page], SSD1306_TxEnd[page]);
+    SSD1306_TxCompleted++;
+}
+
+// Completion of a data transaction: gives the page its pixel back and
+// leaves a failed span dirty for the next update
+static void ssd1306_TxDataDone(bool ok, void* context) {
+    uintptr_t tag = (uintptr_t)context;
+    uint8_t page = tag & 0xFF;
+    SSD1306_Frame[page][SSD1306_TxStart[page]] = SSD1306_TxSaved[page];
+    if (!ok) ssd1306_MarkFailed(page, SSD1306_TxStart[page], SSD1306_TxEnd[page]);
+    SSD1306_TxCompleted++;
+    if ((tag & SSD1306_TX_LAST) && SSD1306_UpdateDone) SSD1306_UpdateDone(SSD1306_UpdateContext);
+}
+
+// Queues one transaction, waiting for room if the queue is full
+static void ssd1306_Submit(const uint8_t* buffer, size_t size, i2c_queue_callback callback, uintptr_t tag) {
+    i2c_transfer transfer = {
+        .address = SSD1306_I2C_ADDR,
+        .write_data = buffer,
+        .write_length = size,
+        .callback = callback,
+        .context = (void*)tag,
+    };
+    SSD1306_TxSubmitted++;
+    while (!i2c_queue_submit(SSD1306_Queue, &transfer)) __wfe();
+}
 
-/* Fills SSD1306_Buffer with values ​​from a provided fixed-length buffer */
+/* Queue the changed spans straight from the screenbuffer and return without waiting for the bus */
+static void ssd1306_UpdateScreenQueued(void) {
+    uint8_t start[SSD1306_PAGES], end[SSD1306_PAGES], changed[SSD1306_PAGES];
+    int8_t last = -1;
+
+    // The previous update still has control bytes parked in the buffer
+    ssd1306_WaitTx();
+
+    for(uint8_t i = 0; i < SSD1306_PAGES; i++) {
+        changed[i] = ssd1306_ChangedSpan(i, &start[i], &end[i]);
+        if (changed[i]) last = i;
+    }
+    // Set before submitting: a failing transaction clears it from its callback
+    SSD1306_ShadowValid = 1;
+
+    SSD1306_FrameBytes = 0;
+    for(uint8_t i = 0; i < SSD1306_PAGES; i++) {
+        if (!changed[i]) continue;
+        size_t count = end[i] - start[i] + 1;
+
+        // The byte in front of the span (the page slot when it starts at column 0)
+        // carries the control byte until the data transaction completes
+        SSD1306_TxStart[i] = start[i];
+        SSD1306_TxEnd[i] = end[i];
+        SSD1306_TxSaved[i] = SSD1306_Frame[i][start[i]];
+        SSD1306_Frame[i][start[i]] = 0x40;
+
+        ssd1306_PageWindow(SSD1306_TxCommands[i], i, start[i], end[i]);
+        ssd1306_Submit(SSD1306_TxCommands[i], sizeof(SSD1306_TxCommands[i]), ssd1306_TxCommandDone, i);
+        ssd1306_Submit(&SSD1306_Frame[i][start[i]], count + 1, ssd1306_TxDataDone,
+                       i | (i == last ? SSD1306_TX_LAST : 0));
+        SSD1306_FrameBytes += sizeof(SSD1306_TxCommands[i]) + count + 1;
+    }
+    SSD1306_TotalBytes += SSD1306_FrameBytes;
+
+    if (last < 0 && SSD1306_UpdateDone) SSD1306_UpdateDone(SSD1306_UpdateContext);
+}
+
+/* Fills the screen buffer with values ​​from a provided fixed-length buffer */
 SSD1306_Error_t ssd1306_FillBuffer(uint8_t* buf, uint32_t len) {
     SSD1306_Error_t ret = SSD1306_ERR;
     if (len <= SSD1306_BUFFER_SIZE) { // Checks if the input buffer size is valid.
-        memcpy(SSD1306_Buffer,buf,len);
+        ssd1306_WaitTx();
+        // Page by page, skipping the control byte slots
+        for (uint32_t offset = 0; offset < len; offset += SSD1306_WIDTH) {
+            uint32_t chunk = (len - offset < SSD1306_WIDTH) ? len - offset : SSD1306_WIDTH;
+            memcpy(SSD1306_PIXELS(offset / SSD1306_WIDTH), &buf[offset], chunk);
+        }
+        ssd1306_MarkAllDirty();
         ret = SSD1306_OK;
     }
     return ret;
@@ -149,7 +354,9 @@ void ssd1306_Init(void) {
     ssd1306_WriteCommand(0x14); //
     ssd1306_SetDisplayOn(1); //--turn on SSD1306 panel
 
-    // Clear screen
+    // Clear screen; the display RAM content is unknown, so the first frame is sent whole
+    SSD1306_ShadowValid = 0;
+    SSD1306_TotalBytes = 0;
     ssd1306_Fill(Black);
     
     // Flush buffer to screen
@@ -164,23 +371,63 @@ void ssd1306_Init(void) {
 
 /* Fill the whole screen with the given color */
 void ssd1306_Fill(SSD1306_COLOR color) {
-    memset(SSD1306_Buffer, (color == Black) ? 0x00 : 0xFF, sizeof(SSD1306_Buffer)); //Preenche o buffer de tela com 0x00 (preto) ou 0xFF (branco), dependendo da cor especificada.
+    ssd1306_WaitTx();
+    ssd1306_MarkAllDirty();
+    for (uint8_t i = 0; i < SSD1306_PAGES; i++) {
+        SSD1306_Frame[i][0] = 0x40; // Control byte slot
+        memset(SSD1306_PIXELS(i), (color == Black) ? 0x00 : 0xFF, SSD1306_WIDTH); //Preenche o buffer de tela com 0x00 (preto) ou 0xFF (branco), dependendo da cor especificada.
+    }
 }
 
 /* Write the screenbuffer with changed to the screen */
 void ssd1306_UpdateScreen(void) {
-    // Write data to each page of RAM. Number of pages
+    if (SSD1306_Queue) {
+        ssd1306_UpdateScreenQueued();
+        return;
+    }
+
+    // Write the changed columns of each page of RAM. Number of pages
     // depends on the screen height:
     //
     //  * 32px   ==  4 pages
     //  * 64px   ==  8 pages
     //  * 128px  ==  16 pages
-    for(uint8_t i = 0; i < SSD1306_HEIGHT/8; i++) {  //Itera sobre cada página (bloco de 8 pixels de altura).
-        ssd1306_WriteCommand(0xB0 + i); // Define a página atual. (RAM page address).
-        ssd1306_WriteCommand(0x00 + SSD1306_X_OFFSET_LOWER); // Define a coluna inicial.
-        ssd1306_WriteCommand(0x10 + SSD1306_X_OFFSET_UPPER); // Define a coluna final.
-        ssd1306_WriteData(&SSD1306_Buffer[SSD1306_WIDTH*i],SSD1306_WIDTH); //Envia os dados da página atual para o display.
+    SSD1306_FrameBytes = 0;
+    bool failed = false;
+    for(uint8_t i = 0; i < SSD1306_PAGES; i++) {  //Itera sobre cada página (bloco de 8 pixels de altura).
+        uint8_t start, end, window[7];
+        if (!ssd1306_ChangedSpan(i, &start, &end)) continue; // Página sem alterações.
+
+        ssd1306_PageWindow(window, i, start, end); // Define a janela de colunas da página atual.
+        if (!ssd1306_Write(window, sizeof(window))) {
+            ssd1306_MarkFailed(i, start, end); // Sent again by the next update
+            failed = true;
+            continue;
+        }
+
+        // Sends the span straight from the buffer: the byte in front of it (the page
+        // slot when it starts at column 0) holds the control byte during the write
+        uint8_t* data = &SSD1306_Frame[i][start];
+        uint8_t saved = *data;
+        *data = 0x40;
+        bool sent = ssd1306_Write(data, end - start + 2); //Envia as colunas alteradas da página atual.
+        *data = saved;
+        if (!sent) {
+            ssd1306_MarkFailed(i, start, end);
+            failed = true;
+        }
+        SSD1306_FrameBytes += sizeof(window) + (end - start + 1) + 1;
     }
+    if (!failed) SSD1306_ShadowValid = 1;
+    SSD1306_TotalBytes += SSD1306_FrameBytes;
+}
+
+/* Resend the whole screenbuffer; with a queue this is one zero-copy DMA frame */
+void ssd1306_UpdateScreenFull(void) {
+    ssd1306_WaitTx();
+    SSD1306_ShadowValid = 0;
+    ssd1306_MarkAllDirty();
+    ssd1306_UpdateScreen();
 }
 
 /*
@@ -195,11 +442,49 @@ void ssd1306_DrawPixel(uint8_t x, uint8_t y, SSD1306_COLOR color) {
         return;
     }
    
+    ssd1306_WaitTx();
+    ssd1306_MarkDirty(y / 8, x, x);
+
     // Draw in the right color
     if(color == White) { // Se a cor for branca, liga o pixel.
-        SSD1306_Buffer[x + (y / 8) * SSD1306_WIDTH] |= 1 << (y % 8);
+        SSD1306_PIXELS(y / 8)[x] |= 1 << (y % 8);
     } else { //  Se a cor for preta, desliga o pixel.
-        SSD1306_Buffer[x + (y / 8) * SSD1306_WIDTH] &= ~(1 << (y % 8));
+        SSD1306_PIXELS(y / 8)[x] &= ~(1 << (y % 8));
+    }
+}
+
+/*
+ * Blit one glyph in page layout at the cursor, one read-modify-write per covered
+ * buffer byte. Same result as drawing every font pixel with ssd1306_DrawPixel:
+ * glyph pixels get color, the rest of the cell gets !color.
+ */
+static void ssd1306_BlitGlyph(const uint8_t* glyph, uint8_t width, uint8_t height, SSD1306_COLOR color) {
+    const uint8_t bands = (height + 7) / 8;
+    const uint8_t x = SSD1306.CurrentX;
+    const uint8_t shift = SSD1306.CurrentY % 8;
+    const uint8_t first_page = SSD1306.CurrentY / 8;
+    const uint8_t last_page = (SSD1306.CurrentY + height - 1) / 8;
+    // Rows of the character cell, as bits of consecutive pages (up to 26 + 7 bits)
+    const uint64_t cell = ((((uint64_t)1) << height) - 1) << shift;
+
+    ssd1306_WaitTx();
+    for (uint8_t j = 0; j < width; j++, glyph += bands) {
+        uint64_t bits = 0;
+        for (uint8_t k = 0; k < bands; k++) {
+            bits |= (uint64_t)glyph[k] << (8 * k);
+        }
+        if (color == Black) bits = ~bits;
+        bits = (bits << shift) & cell;
+
+        uint8_t* dst = &SSD1306_PIXELS(first_page)[x + j];
+        for (uint8_t p = 0; p <= last_page - first_page; p++, dst += SSD1306_WIDTH + 1) {
+            const uint8_t mask = (uint8_t)(cell >> (8 * p));
+            *dst = (*dst & ~mask) | (uint8_t)(bits >> (8 * p));
+        }
+    }
+
+    for (uint8_t p = first_page; p <= last_page; p++) {
+        ssd1306_MarkDirty(p, x, x + width - 1);
     }
 }
 
@@ -224,14 +509,20 @@ char ssd1306_WriteChar(char ch, SSD1306_Font_t Font, SSD1306_COLOR color) {
         return 0;
     }
     
-    // Use the font to write
-    for(i = 0; i < Font.height; i++) {
-        b = Font.data[(ch - 32) * Font.height + i];
-        for(j = 0; j < Font.width; j++) {
-            if((b << j) & 0x8000)  {
-                ssd1306_DrawPixel(SSD1306.CurrentX + j, (SSD1306.CurrentY + i), (SSD1306_COLOR) color);
-            } else {
-                ssd1306_DrawPixel(SSD1306.CurrentX + j, (SSD1306.CurrentY + i), (SSD1306_COLOR)!color);
+    if (Font.columns) {
+        // Fast path: pre-transposed glyph columns (tools/gen_font_columns.py)
+        ssd1306_BlitGlyph(&Font.columns[(ch - 32) * Font.width * ((Font.height + 7) / 8)],
+                          Font.width, Font.height, color);
+    } else {
+        // Use the font to write
+        for(i = 0; i < Font.height; i++) {
+            b = Font.data[(ch - 32) * Font.height + i];
+            for(j = 0; j < Font.width; j++) {
+                if((b << j) & 0x8000)  {
+                    ssd1306_DrawPixel(SSD1306.CurrentX + j, (SSD1306.CurrentY + i), (SSD1306_COLOR) color);
+                } else {
+                    ssd1306_DrawPixel(SSD1306.CurrentX + j, (SSD1306.CurrentY + i), (SSD1306_COLOR)!color);
+                }
             }
         }
     }
@@ -511,24 +802,25 @@ SSD1306_Error_t ssd1306_InvertRectangle(uint8_t x1, uint8_t y1, uint8_t x2, uint
   if ((x1 > x2) || (y1 > y2)) {
     return SSD1306_ERR;
   }
-  uint32_t i;
+  ssd1306_WaitTx();
+  for (uint8_t page = y1 / 8; page <= y2 / 8; page++) {
+    ssd1306_MarkDirty(page, x1, x2);
+  }
   if ((y1 / 8) != (y2 / 8)) {
     /* if rectangle doesn't lie on one 8px row */
     for (uint32_t x = x1; x <= x2; x++) {
-      i = x + (y1 / 8) * SSD1306_WIDTH;
-      SSD1306_Buffer[i] ^= 0xFF << (y1 % 8);
-      i += SSD1306_WIDTH;
-      for (; i < x + (y2 / 8) * SSD1306_WIDTH; i += SSD1306_WIDTH) {
-        SSD1306_Buffer[i] ^= 0xFF;
+      uint8_t page = y1 / 8;
+      SSD1306_PIXELS(page)[x] ^= 0xFF << (y1 % 8);
+      for (page++; page < y2 / 8; page++) {
+        SSD1306_PIXELS(page)[x] ^= 0xFF;
       }
-      SSD1306_Buffer[i] ^= 0xFF >> (7 - (y2 % 8));
+      SSD1306_PIXELS(page)[x] ^= 0xFF >> (7 - (y2 % 8));
     }
   } else {
     /* if rectangle lies on one 8px row */
     const uint8_t mask = (0xFF << (y1 % 8)) & (0xFF >> (7 - (y2 % 8)));
-    for (i = x1 + (y1 / 8) * SSD1306_WIDTH;
-         i <= (uint32_t)x2 + (y2 / 8) * SSD1306_WIDTH; i++) {
-      SSD1306_Buffer[i] ^= mask;
+    for (uint32_t x = x1; x <= x2; x++) {
+      SSD1306_PIXELS(y1 / 8)[x] ^= mask;
     }
   }
   return SSD1306_OK;
@@ -624,6 +916,9 @@ void ssd1306_StartScrollLeft(uint8_t startPage, uint8_t endPage, uint8_t scrollS
  */
 void ssd1306_StopScroll(void) {
     ssd1306_WriteCommand(0x2E); // Desativa o scroll
+    // Scrolling moved the display RAM, so the next update resends the whole frame
+    SSD1306_ShadowValid = 0;
+    ssd1306_MarkAllDirty();
 }
 
 /**
@@ -8,6 +8,7 @@
 _BEGIN_STD_C
 
 #include "ssd1306_conf.h"
+#include "i2c_queue.h"
 
 #define SSD1306_I2C_CLK 400
 
@@ -75,6 +76,7 @@ typedef struct {
 	const uint8_t height;               /**< Font height in pixels */
 	const uint16_t *const data;         /**< Pointer to font data array */
     const uint8_t *const char_width;    /**< Proportional character width in pixels (NULL for monospaced) */
+    const uint8_t *const columns;       /**< Same glyphs in page layout for the fast text path (NULL = per-pixel) */
 } SSD1306_Font_t;
 
 // Procedure definitions
@@ -133,6 +135,48 @@ void ssd1306_WriteCommand(uint8_t byte);
 void ssd1306_WriteData(uint8_t* buffer, size_t buff_size);
 SSD1306_Error_t ssd1306_FillBuffer(uint8_t* buf, uint32_t len);
 
+/**
+ * @brief Sends all display traffic through a DMA transaction queue.
+ * @param[in] queue queue attached to SSD1306_I2C_PORT, or NULL for blocking writes.
+ * @note With a queue, ssd1306_UpdateScreen() returns as soon as the frame is queued.
+ */
+void ssd1306_SetQueue(i2c_queue* queue);
+
+/** Function called when a queued screen update has been sent */
+typedef void (*ssd1306_UpdateCallback)(void* context);
+
+/**
+ * @brief Sets the function called (from the I2C interrupt) when a queued update completes.
+ * @note Drawing functions wait by themselves while an update still reads the buffer.
+ */
+void ssd1306_SetUpdateCallback(ssd1306_UpdateCallback callback, void* context);
+
+/**
+ * @brief Reads whether a queued update is still being sent.
+ * @return  0: idle.
+ *          1: transfer in progress.
+ */
+uint8_t ssd1306_IsUpdating(void);
+
+/**
+ * @brief Sends the whole screenbuffer, ignoring what the display already shows.
+ * @note With a queue this is a full-frame DMA transfer straight from the buffer
+ *       that returns immediately.
+ */
+void ssd1306_UpdateScreenFull(void);
+
+/**
+ * @brief Bytes sent over I2C by the last ssd1306_UpdateScreen().
+ * @note Only changed columns of changed pages are sent, plus 7 command bytes
+ *       and 1 control byte per page; a full frame is 1088 bytes.
+ */
+uint32_t ssd1306_GetFrameBytes(void);
+
+/**
+ * @brief Bytes sent over I2C by ssd1306_UpdateScreen() since ssd1306_Init().
+ */
+uint32_t ssd1306_GetTotalBytes(void);
+
 // ==================== JÁ COM COMENTÁRIOS DE DOCUMENTAÇÃO API (Estilo doxygen) em ssd1306.c ====================
 
 void ssd1306_StartScrollRight(uint8_t startPage, uint8_t endPage, uint8_t scrollSpeed);
@@ -1,5 +1,6 @@
 
 #include "ssd1306_fonts.h"
+#include "ssd1306_fonts_columns.h" // Generated by tools/gen_font_columns.py
 
 #ifdef SSD1306_INCLUDE_FONT_7x10
 static const uint16_t Font7x10 [] = {
@@ -895,21 +896,21 @@ static const uint8_t char_width[] = {
 #endif
 
 #ifdef SSD1306_INCLUDE_FONT_6x8
-const SSD1306_Font_t Font_6x8 = {6, 8, Font6x8, NULL};
+const SSD1306_Font_t Font_6x8 = {6, 8, Font6x8, NULL, Font6x8_columns};
 #endif
 #ifdef SSD1306_INCLUDE_FONT_7x10
-const SSD1306_Font_t Font_7x10 = {7, 10, Font7x10, NULL};
+const SSD1306_Font_t Font_7x10 = {7, 10, Font7x10, NULL, Font7x10_columns};
 #endif
 #ifdef SSD1306_INCLUDE_FONT_11x18
-const SSD1306_Font_t Font_11x18 = {11, 18, Font11x18, NULL};
+const SSD1306_Font_t Font_11x18 = {11, 18, Font11x18, NULL, Font11x18_columns};
 #endif
 #ifdef SSD1306_INCLUDE_FONT_16x26
-const SSD1306_Font_t Font_16x26 = {16, 26, Font16x26, NULL};
+const SSD1306_Font_t Font_16x26 = {16, 26, Font16x26, NULL, Font16x26_columns};
 #endif
 
 /* see ./examples/custom-fonts/ */
 #ifdef SSD1306_INCLUDE_FONT_16x24
-const SSD1306_Font_t Font_16x24 = {16, 24, Font16x24, NULL};
+const SSD1306_Font_t Font_16x24 = {16, 24, Font16x24, NULL, Font16x24_columns};
 #endif
 
 #ifdef SSD1306_INCLUDE_FONT_16x15
@@ -917,5 +918,5 @@ const SSD1306_Font_t Font_16x24 = {16, 24, Font16x24, NULL};
  * @copyright Google https://github.com/googlefonts/roboto
  * @license This font is licensed under the Apache License, Version 2.0.
 */
-const SSD1306_Font_t Font_16x15 = {16, 15, Font16x15, char_width};
+const SSD1306_Font_t Font_16x15 = {16, 15, Font16x15, char_width, Font16x15_columns};
 #endif
\ No newline at end of file
@@ -1,19 +1,43 @@
+#include <stddef.h>
 #include <stdio.h>
 #include <string.h>
+#include <time.h>
 #include "pico/stdlib.h"
 #include "hardware/i2c.h"
 #include "hardware/spi.h"
+#include "hardware/dma.h"
 #include "hardware/gpio.h"
 #include "hardware/pwm.h"
+#include "hardware/sync.h"
+#include "pico/multicore.h"
 #include "vl53l0x.h"
-#include "lib_ssd1306\ssd1306.h"
-#include "lib_ssd1306\ssd1306_fonts.h"
-#include "lib\FatFs_SPI\ff15\source\ff.h"  // FatFs for SD
+#include "sd_logger.h"
+#include "binlog.h"
+#include "distance_csv.h"
+#include "sample_pipeline.h"
+#include "i2c_queue.h"
+#include "lib_ssd1306/ssd1306.h"
+#include "lib_ssd1306/ssd1306_fonts.h"
+#include "lib/FatFs_SPI/ff15/source/ff.h"  // FatFs for SD
+#include "lib/FatFs_SPI/ff15/source/diskio.h"
+#include "lib/FatFs_SPI/sd_driver/hw_config.h"
+#include "lib/FatFs_SPI/sd_driver/sd_image.h"
+#include "lib/FatFs_SPI/sd_driver/crc.h"
+#include "lib/FatFs_SPI/include/disk_cache.h"
+#include "lib/FatFs_SPI/include/ff_pool.h"
+#include "lib/FatFs_SPI/include/ff_sync.h"
+#ifdef FF_STDIO_BENCHMARK_KB
+#include "lib/FatFs_SPI/include/ff_stdio.h"
+#endif
 
 // === Definitions for pins and peripherals ===
 #define PORT_I2C i2c0 // VL53L0X on I2C0 bus
 #define PINO_SDA_I2C 0
 #define PINO_SCL_I2C 1
+// Define VL53L0X_TIMING_BUDGET_US to trade accuracy for rate, e.g. 20000 (fast)
+// or 200000 (accurate); the driver default is 33000
+// Define VL53L0X_GPIO1_PIN to the Pico pin wired to the sensor GPIO1 output to
+// wait for samples on its interrupt instead of polling the sensor over I2C
 
 #define BUZZER_PIN 21    // BitDogLab internal buzzer pin
 #define BUZZER_DISTANCE_THRESHOLD 10  // Distance threshold in cm to trigger buzzer
@@ -28,53 +52,415 @@
 #define PIN_SCK  18
 #define PIN_MOSI 19
 
-#define INVALID_DISTANCE 2001 // Value to indicate invalid reading (>2m)
 #define MAX_DISTANCE_CM 999 // Limit to display in cm, above that it displays in meters
 #define DISTANCE_OFFSET_MM 30  // Calibration offset in millimeters
 
+// Log format: 0 = CSV text in distance.txt, 1 = packed binary records in distance.bin
+// (convert on the host with tools/binlog2csv)
+#ifndef LOG_FORMAT_BINARY
+#define LOG_FORMAT_BINARY 0
+#endif
+
+// Pipeline mode: 0 = single loop on core0, 1 = core0 acquires samples and core1
+// drains them into the SD log and the display
+#ifndef DUAL_CORE_PIPELINE
+#define DUAL_CORE_PIPELINE 0
+#endif
+
+// I2C access: 0 = blocking SDK calls, 1 = DMA transaction queues for the sensor
+// bus and the display bus (the OLED frame is then sent in the background)
+#ifndef I2C_DMA_QUEUE
+#define I2C_DMA_QUEUE 0
+#endif
+
+// Log file allocation: 0 = FatFs grows the file a cluster at a time; N = the
+// file is created as one contiguous extent of N KiB (f_expand) whose sectors
+// are written by LBA, with no FAT or directory updates while logging. The file
+// is only cut to its real size when it is closed, so after a power loss it
+// reads as the data followed by the rest of the extent. distance.txt is only
+// preallocated when it is new: a later boot cuts that padding and appends.
+#ifndef SD_LOG_EXTENT_KB
+#define SD_LOG_EXTENT_KB 0
+#endif
+
+// Define SD_READ_BENCHMARK_SECTORS (e.g. 2048) to time raw multi-sector reads
+// after the mount and print the read throughput of the SD driver
+// Define SD_WRITE_BENCHMARK_KB (e.g. 256) to time writing a scratch file of that
+// size after the mount and print the write throughput and the card busy time
+
+// Define SD_CRC_BENCHMARK_BLOCKS (e.g. 2000) to check after the mount that the
+// CRC16 engines (table, slice-by-4, DMA sniffer) agree on random blocks and to
+// print what each one costs per 512-byte block; on the board this checks the
+// real sniffer, while the crc16 host test checks the engines on every build
+
+// Define FF_STDIO_BENCHMARK_KB (e.g. 256) to time writing a scratch file of that
+// size through ff_stdio in 1-byte ff_fputc and 16-byte ff_fwrite calls, with
+// each buffering mode; with SD_IMAGE_BACKEND on the host the disk is in RAM,
+// so the numbers are the CPU cost of the stream layer and FatFs
+
+// SD backend: 0 = the card on spi0, 1 = a disk image that counts the sector I/O
+// of every log record (a memory-mapped file on the host build, a RAM disk on the chip)
+#ifndef SD_IMAGE_BACKEND
+#define SD_IMAGE_BACKEND 0
+#endif
+#define SD_IMAGE_PATH "bitdoglab_sd.img"
+#define SD_IMAGE_FILE_SECTORS (256 * 2048) // Size of a new image file (256 MiB)
+#define SD_IMAGE_RAM_SECTORS 160           // RAM disk on the chip (80 KiB, FAT12)
+#define SD_IMAGE_REPORT_RECORDS 25         // Records between two I/O reports
+
+#define SAMPLE_PERIOD_MS 200 // Interval between processed readings
+#define POLL_INTERVAL_MS 5   // Sleep between non-blocking sensor polls
+
+#define PIPELINE_REPORT_INTERVAL_MS 5000 // Period of the ring statistics report
+
 FATFS fs;
+sd_logger distance_log; // distance.txt, kept open while logging
+binlog_writer distance_bin; // Records of distance.bin on top of distance_log
+sample_pipeline pipeline; // Samples from core0 to core1 in pipeline mode
+i2c_queue sensor_bus;     // Transaction queue of i2c0 (VL53L0X)
+i2c_queue display_bus;    // Transaction queue of i2c1 (SSD1306)
+
+#if SD_IMAGE_BACKEND
+sd_image_t sd_image;      // Medium of drive 0 in place of the SPI card
+#if !SD_IMAGE_MMAP
+static uint8_t sd_image_ram[SD_IMAGE_RAM_SECTORS * SD_IMAGE_SECTOR_SIZE];
+#endif
+#endif
+
+// Buzzer PWM settings, computed once in main()
+static uint buzzer_slice;
+static uint buzzer_channel;
+static uint32_t buzzer_wrap;
 
 // === Function to record distance on SD card ===
 void record_distance(uint16_t distance_cm, const char* status, uint64_t time_ms) {
-    static bool first_write = true;
-    FIL file;
-    FRESULT fr;
+    // If it is the first time it is written, it opens the file, appending to
+    // what earlier boots logged, and a new file gets a header. The file then
+    // stays open; the logger batches lines into whole sectors.
+    if (!distance_log.is_open) {
+#if SD_LOG_EXTENT_KB
+        if (!sd_logger_append_extent(&distance_log, "distance.txt", SD_LOG_EXTENT_KB * 1024u)) return;
+#else
+        if (!sd_logger_open(&distance_log, "distance.txt", false)) return;
+#endif
+        // A new extent already has its full size, but nothing written in it
+        FSIZE_t logged = distance_log.extent_sectors ? distance_log.extent_written : f_size(&distance_log.file);
+        if (logged == 0) {
+            sd_logger_write(&distance_log, DISTANCE_CSV_HEADER, sizeof(DISTANCE_CSV_HEADER) - 1);
+        }
+    }
 
-    // If it is the first time it is written, it creates a header.
-    if (first_write) {
-        fr = f_open(&file, "distance.txt", FA_WRITE | FA_CREATE_ALWAYS);
-        if (fr == FR_OK) {
-            f_printf(&file, "Time,Distance,Unit,Status\n");
-            f_close(&file);
-            first_write = false;
+    char line[80];
+    int length = distance_csv_line(line, sizeof(line), distance_cm, status, time_ms);
+    if (length > 0) {
+        sd_logger_write(&distance_log, line, (size_t)length < sizeof(line) ? (size_t)length : sizeof(line) - 1);
+    }
+}
+
+// === Maps a device range status to the range_status of a binary record ===
+uint8_t binlog_range_status(uint8_t range_status) {
+    if (range_status == VL53L0X_RANGE_STATUS_VALID) return BINLOG_RANGE_VALID;
+    return range_status == VL53L0X_RANGE_STATUS_NONE ? BINLOG_RANGE_NO_SAMPLE : range_status;
+}
+
+// === Function to record distance on SD card as binary records ===
+void record_distance_binary(uint16_t distance_cm, uint8_t range_status, bool port_open, uint32_t time_ms) {
+    // Opens distance.bin on the first reading: the log of earlier boots is
+    // recovered and continued, else the file is created with its header
+    if (!distance_log.is_open) {
+        if (!binlog_open(&distance_bin, &distance_log, "distance.bin", time_ms, SD_LOG_EXTENT_KB * 1024u)) return;
+        if (distance_bin.resumed) {
+            printf("distance.bin resumed after block %lu (%lu blocks read in %lu us)\n",
+                   (unsigned long)distance_bin.recovered_blocks, (unsigned long)distance_bin.recovery_reads,
+                   (unsigned long)distance_bin.recovery_us);
         }
     }
 
-    fr = f_open(&file, "distance.txt", FA_OPEN_APPEND | FA_WRITE);
-    if (fr == FR_OK) {
-        char line[80];
-        unsigned long minutes = time_ms / 60000;
-        unsigned long seconds = (time_ms / 1000) % 60;
-
-        if (distance_cm >= 100 && distance_cm < INVALID_DISTANCE) {
-            f_printf(&file, "%02lu:%02lu,%.2f,m,%s\n", 
-                    minutes, seconds, distance_cm / 100.0f, status);
-        } else if (distance_cm == INVALID_DISTANCE) {
-            f_printf(&file, "%02lu:%02lu,ERROR,-,%s\n", 
-                    minutes, seconds, status);
-        } else {
-            f_printf(&file, "%02lu:%02lu,%d,cm,%s\n", 
-                    minutes, seconds, distance_cm, status);
+    uint16_t distance_mm = distance_cm == INVALID_DISTANCE ? BINLOG_DISTANCE_INVALID : distance_cm * 10;
+    binlog_append(&distance_bin, time_ms, distance_mm, binlog_range_status(range_status),
+                  port_open ? BINLOG_GATE_OPEN : BINLOG_GATE_CLOSED);
+}
+
+// === Runs the time based sync of the open log ===
+void poll_distance_log() {
+#if LOG_FORMAT_BINARY
+    binlog_poll(&distance_bin);     // Checkpoints the block being filled as well
+#else
+    sd_logger_poll(&distance_log);
+#endif
+}
+
+#if SD_IMAGE_BACKEND
+// === Accounts the sector I/O of one log record and reports it periodically ===
+void account_record_io(const sd_image_stats* before) {
+    static sd_image_stats last_report;
+    static uint32_t records;
+    static uint32_t max_record_sectors;
+
+    sd_image_stats now;
+    sd_image_get_stats(&sd_image, &now);
+    uint32_t sectors = (uint32_t)(now.read.sectors - before->read.sectors + now.write.sectors - before->write.sectors);
+    if (sectors > max_record_sectors) max_record_sectors = sectors;
+    if (++records < SD_IMAGE_REPORT_RECORDS) return;
+
+    // Totals since the last report also cover the syncs run outside the records
+    uint32_t write_calls = now.write.calls - last_report.write.calls;
+    uint64_t write_us = now.write.total_us - last_report.write.total_us;
+    printf("SD image: %lu records, %.2f sectors written and %.2f read per record (max %lu in one record), "
+           "%lu write calls (%lu sequential), write %lu us avg\n",
+           (unsigned long)records, (float)(now.write.sectors - last_report.write.sectors) / records,
+           (float)(now.read.sectors - last_report.read.sectors) / records, (unsigned long)max_record_sectors,
+           (unsigned long)write_calls, (unsigned long)(now.write.sequential - last_report.write.sequential),
+           (unsigned long)(write_calls ? write_us / write_calls : 0));
+#if DISK_CACHE_SECTORS
+    static disk_cache_stats_t last_cache;
+    disk_cache_stats_t cache;
+    disk_cache_get_stats(&cache);
+    printf("Disk cache: %lu/%lu read hits, %lu/%lu write hits, %lu evictions, %lu write-backs, %lu bypassed\n",
+           (unsigned long)(cache.read_hits - last_cache.read_hits),
+           (unsigned long)(cache.read_hits - last_cache.read_hits + cache.read_misses - last_cache.read_misses),
+           (unsigned long)(cache.write_hits - last_cache.write_hits),
+           (unsigned long)(cache.write_hits - last_cache.write_hits + cache.write_misses - last_cache.write_misses),
+           (unsigned long)(cache.evictions - last_cache.evictions),
+           (unsigned long)(cache.writebacks - last_cache.writebacks),
+           (unsigned long)(cache.bypassed - last_cache.bypassed));
+    last_cache = cache;
+#endif
+    ff_pool_stats_t lfn, file;
+    ff_pool_get_stats(&ff_lfn_pool, &lfn);
+    ff_pool_get_stats(&ff_file_pool, &file);
+    printf("FatFs pools: LFN %u/%u high water, %lu allocs, %lu misses (%lu to heap); "
+           "FIL %u/%u high water, %lu misses\n",
+           lfn.high_water, FF_POOL_LFN_BLOCKS, (unsigned long)lfn.allocs, (unsigned long)lfn.failures,
+           (unsigned long)lfn.heap_fallbacks, file.high_water, FF_POOL_FILE_BLOCKS, (unsigned long)file.failures);
+    last_report = now;
+    records = 0;
+    max_record_sectors = 0;
+}
+#endif
+
+#ifdef SD_READ_BENCHMARK_SECTORS
+// === Times reads of the first sectors straight through the disk layer ===
+void benchmark_sd_read() {
+    static BYTE buffer[32 * FF_MAX_SS];
+    const UINT chunks[] = {1, 8, 32};   // Sectors per disk_read call
+
+    for (size_t c = 0; c < count_of(chunks); c++) {
+        uint64_t start_us = time_us_64();
+        LBA_t sector;
+        for (sector = 0; sector + chunks[c] <= SD_READ_BENCHMARK_SECTORS; sector += chunks[c]) {
+            if (disk_read(0, buffer, sector, chunks[c]) != RES_OK) {
+                printf("SD read benchmark failed at sector %lu\n", (unsigned long)sector);
+                return;
+            }
+        }
+        uint64_t elapsed_us = time_us_64() - start_us;
+        printf("SD read: %lu sectors in %u-sector calls, %.3f MB/s\n", (unsigned long)sector, chunks[c],
+               elapsed_us ? (double)sector * FF_MAX_SS / elapsed_us : 0.0);
+    }
+}
+#endif
+
+#if defined(SD_CRC_BENCHMARK_BLOCKS) || defined(FF_STDIO_BENCHMARK_KB)
+#if BITDOGLAB_HOST
+// The virtual clock stands still while the CPU computes: CPU-bound benchmarks
+// are timed on the wall clock of the host
+static uint64_t cpu_clock_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+#else
+static uint64_t cpu_clock_ns() {
+    return time_us_64() * 1000;
+}
+#endif
+#endif
+
+#ifdef SD_CRC_BENCHMARK_BLOCKS
+
+// === Checks that the CRC16 engines agree and times them per block ===
+void benchmark_crc16() {
+    static uint8_t blocks[8][FF_MAX_SS];
+    static uint8_t sink;
+    uint32_t seed = 0x2545F491;
+    for (size_t i = 0; i < sizeof(blocks); i++) {
+        seed = seed * 1664525u + 1013904223u;
+        blocks[i / FF_MAX_SS][i % FF_MAX_SS] = (uint8_t)(seed >> 24);
+    }
+
+    // The sniffer watches a channel that pours each block into one byte, as
+    // the SPI driver's channels do with the data of the card
+    uint channel = dma_claim_unused_channel(true);
+    dma_channel_config config = dma_channel_get_default_config(channel);
+    channel_config_set_transfer_data_size(&config, DMA_SIZE_8);
+    channel_config_set_write_increment(&config, false);
+    channel_config_set_sniff_enable(&config, true);
+
+    uint64_t table_ns = 0, slice4_ns = 0, dma_us = 0;
+    uint32_t mismatches = 0;
+    for (uint32_t n = 0; n < SD_CRC_BENCHMARK_BLOCKS; n++) {
+        const char* block = (const char*)blocks[n % count_of(blocks)];
+        uint64_t start_ns = cpu_clock_ns();
+        uint16_t table = crc16_table(block, FF_MAX_SS);
+        uint64_t middle_ns = cpu_clock_ns();
+        uint16_t slice4 = crc16_slice4(block, FF_MAX_SS);
+        uint64_t end_ns = cpu_clock_ns();
+        table_ns += middle_ns - start_ns;
+        slice4_ns += end_ns - middle_ns;
+
+        uint64_t start_us = time_us_64();
+        dma_channel_configure(channel, &config, &sink, block, FF_MAX_SS, false);
+        dma_sniffer_enable(channel, DMA_SNIFF_CTRL_CALC_VALUE_CRC16, true);
+        dma_hw->sniff_data = 0;
+        dma_channel_start(channel);
+        dma_channel_wait_for_finish_blocking(channel);
+        uint16_t sniffed = (uint16_t)dma_hw->sniff_data;
+        dma_us += time_us_64() - start_us;
+
+        if (table != slice4 || table != sniffed) {
+            if (!mismatches) printf("CRC16 mismatch: table 0x%04x, slice-by-4 0x%04x, DMA 0x%04x\n",
+                                    table, slice4, sniffed);
+            mismatches++;
         }
-        
-        f_close(&file);
-    } else {
-        printf("File open failed: %d\n", fr);
     }
+    dma_sniffer_disable();
+    dma_channel_unclaim(channel);
+
+    printf("CRC16 of %u blocks: %s\n", SD_CRC_BENCHMARK_BLOCKS,
+           mismatches ? "engines DISAGREE" : "all engines agree");
+    printf("  table %.2f us, slice-by-4 %.2f us, DMA sniffer %.2f us per block (CPU free meanwhile)\n",
+           table_ns / 1000.0 / SD_CRC_BENCHMARK_BLOCKS, slice4_ns / 1000.0 / SD_CRC_BENCHMARK_BLOCKS,
+           (double)dma_us / SD_CRC_BENCHMARK_BLOCKS);
 }
+#endif
+
+// === Prints the card programming time seen by the SD driver's write engine ===
+void print_sd_write_stats(const sd_write_stats_t* stats) {
+    printf("SD writes: %lu calls, %lu blocks, busy waited %lu times (avg %lu us, max %lu us), "
+           "%lu hidden behind other work\n",
+           (unsigned long)stats->writes, (unsigned long)stats->blocks, (unsigned long)stats->busy_waits,
+           (unsigned long)(stats->busy_waits ? stats->busy_us / stats->busy_waits : 0),
+           (unsigned long)stats->max_busy_us, (unsigned long)stats->busy_hidden);
+}
+
+#ifdef SD_WRITE_BENCHMARK_KB
+// === Times f_write of a scratch file in 8 KiB pieces, then removes it ===
+void benchmark_sd_write() {
+    static BYTE buffer[16 * FF_MAX_SS];
+    memset(buffer, 0x5A, sizeof(buffer));
+    sd_card_t* sd = sd_get_by_num(0);
+    sd_write_stats_t before, after;
+    sd_get_write_stats(sd, &before);
+
+    FIL file;
+    if (f_open(&file, "bench.bin", FA_WRITE | FA_CREATE_ALWAYS) != FR_OK) {
+        printf("SD write benchmark: cannot create bench.bin\n");
+        return;
+    }
+    uint64_t start_us = time_us_64();
+    uint32_t bytes = 0;
+    while (bytes < SD_WRITE_BENCHMARK_KB * 1024u) {
+        UINT written;
+        if (f_write(&file, buffer, sizeof(buffer), &written) != FR_OK || written != sizeof(buffer)) break;
+        bytes += written;
+    }
+    f_sync(&file);
+    uint64_t elapsed_us = time_us_64() - start_us;
+    f_close(&file);
+    f_unlink("bench.bin");
+
+    sd_get_write_stats(sd, &after);
+    after.writes -= before.writes;
+    after.blocks -= before.blocks;
+    after.busy_waits -= before.busy_waits;
+    after.busy_hidden -= before.busy_hidden;
+    after.busy_us -= before.busy_us;
+    printf("SD write: %lu KiB in 8 KiB f_write calls, %.3f MB/s\n", (unsigned long)(bytes / 1024),
+           elapsed_us ? (double)bytes / elapsed_us : 0.0);
+    print_sd_write_stats(&after);
+}
+#endif
+
+#ifdef FF_STDIO_BENCHMARK_KB
+// === Times small writes through ff_stdio with each buffering mode ===
+void benchmark_ff_stdio() {
+    static const struct {
+        int mode;
+        const char* name;
+    } modes[] = {{FF_IONBF, "unbuffered"}, {FF_IOLBF, "line"}, {FF_IOFBF, "full"}};
+    static const char line[] = "123.45,cm,open\n";   // 16 bytes, like a log line
+
+    for (size_t m = 0; m < count_of(modes); m++) {
+        for (size_t chunk = 1; chunk <= 16; chunk += 15) {
+            FF_FILE* stream = ff_fopen("stdio.bin", "w");
+            if (!stream || ff_setvbuf(stream, NULL, modes[m].mode, FF_STDIO_BUFFER_SIZE) != 0) {
+                printf("ff_stdio benchmark: cannot create stdio.bin\n");
+                if (stream) ff_fclose(stream);
+                return;
+            }
+            uint64_t start_ns = cpu_clock_ns();
+            uint32_t bytes = 0;
+            while (bytes < FF_STDIO_BENCHMARK_KB * 1024u) {
+                if (chunk == 1) {
+                    if (ff_fputc(line[bytes % 16], stream) < 0) break;
+                } else if (ff_fwrite(line, 1, 16, stream) != 16) {
+                    break;
+                }
+                bytes += chunk;
+            }
+            ff_fclose(stream);
+            uint64_t elapsed_ns = cpu_clock_ns() - start_ns;
+            printf("ff_stdio %-10s %2u-byte writes: %lu KiB, %.0f ns per call, %.2f MB/s\n", modes[m].name,
+                   (unsigned)chunk, (unsigned long)(bytes / 1024), (double)elapsed_ns * chunk / bytes,
+                   elapsed_ns ? bytes * 1000.0 / elapsed_ns : 0.0);
+        }
+    }
+    ff_remove("stdio.bin");
+}
+#endif
+
+// === Creates a new file system on the SD card ===
+FRESULT format_sd() {
+#if SD_IMAGE_BACKEND && !SD_IMAGE_MMAP
+    MKFS_PARM opt = {FM_ANY, 0, 0, 0, 0};   // The RAM disk is too small for FAT32
+#else
+    MKFS_PARM opt = {FM_FAT32, 0, 0, 0, 0};
+#endif
+    BYTE work[FF_MAX_SS];
+    return f_mkfs("", &opt, work, sizeof(work));
+}
+
+#if SPI_STATS
+// === Prints the SPI transfers so far by size and path (PIO below SPI_PIO_THRESHOLD) ===
+void print_spi_stats() {
+    spi_stats_t stats;
+    spi_get_stats(spi_get_by_num(0), &stats);
+    printf("SPI transfers (PIO below %d bytes):\n", SPI_PIO_THRESHOLD);
+    for (int i = 0; i < SPI_STATS_BUCKETS; i++) {
+        const spi_size_stats_t* pio = &stats.pio[i];
+        const spi_size_stats_t* dma = &stats.dma[i];
+        if (!pio->count && !dma->count) continue;
+        printf("  %s%4u bytes: PIO %6lu x %7.2f us, DMA %6lu x %7.2f us\n",
+               i < SPI_STATS_BUCKETS - 1 ? "<=" : "> ", i < SPI_STATS_BUCKETS - 1 ? 1u << i : 1u << (i - 1),
+               (unsigned long)pio->count, pio->count ? (double)pio->us / pio->count : 0.0,
+               (unsigned long)dma->count, dma->count ? (double)dma->us / dma->count : 0.0);
+    }
+}
+#endif
 
 // === SD Card Initialization ===
 void initialize_sd() {
+#if SD_IMAGE_BACKEND
+    // The image replaces the card as drive 0 before FatFs first touches it
+#if SD_IMAGE_MMAP
+    bool attached = sd_image_attach_file(sd_get_by_num(0), &sd_image, SD_IMAGE_PATH, SD_IMAGE_FILE_SECTORS);
+#else
+    bool attached = sd_image_attach_ram(sd_get_by_num(0), &sd_image, sd_image_ram, SD_IMAGE_RAM_SECTORS);
+#endif
+    printf(attached ? "SD image backend attached\n" : "SD image backend failed, using the card\n");
+#endif
+
     // Reduces SPI speed for increased reliability
     spi_init(SPI_PORT, 400 * 1000); // Reduces to 400kHz
 
@@ -97,9 +483,7 @@ void initialize_sd() {
     
     if (fr == FR_NO_FILESYSTEM) {
         printf("No filesystem found. Formatting card...\n");
-        MKFS_PARM opt = {FM_FAT32, 0, 0, 0, 0};
-        BYTE work[FF_MAX_SS];
-        fr = f_mkfs("", &opt, work, sizeof(work));
+        fr = format_sd();
         if (fr == FR_OK) {
             printf("Format successful. Mounting...\n");
             fr = f_mount(NULL, "", 0);      // Unmount first
@@ -121,6 +505,25 @@ void initialize_sd() {
     } else {
         printf("File creation failed (%d)\n", fr);
     }
+#ifdef SD_CRC_BENCHMARK_BLOCKS
+    benchmark_crc16();
+#endif
+#ifdef SD_READ_BENCHMARK_SECTORS
+    benchmark_sd_read();
+#endif
+#ifdef SD_WRITE_BENCHMARK_KB
+    benchmark_sd_write();
+#endif
+#ifdef FF_STDIO_BENCHMARK_KB
+    benchmark_ff_stdio();
+#endif
+#if SPI_STATS
+    print_spi_stats();
+#endif
+#if SD_IMAGE_BACKEND
+    sd_image_reset_stats(&sd_image);    // Reports only cover the logging
+    disk_cache_reset_stats();
+#endif
 }
 
 // === Displays information on the OLED screen ===
@@ -149,6 +552,138 @@ void display_oled(uint16_t distance_cm, const char* port_status) {
     ssd1306_UpdateScreen();
 }
 
+// === Handles one reading: terminal, display, SD log, LEDs and buzzer ===
+void process_sample(uint16_t distance_cm, uint8_t range_status, uint64_t time_ms) {
+    char value_str[16], unit[4];
+    const char* port_status = "CLOSE";
+
+    // Decide unit for terminal and logic
+    if (distance_cm >= 100 && distance_cm < INVALID_DISTANCE) {
+        snprintf(value_str, sizeof(value_str), "%.2f", distance_cm / 100.0f);
+        strcpy(unit, "m");
+    } else if (distance_cm == INVALID_DISTANCE) {
+        strcpy(value_str, "ERROR");
+        strcpy(unit, "");
+    } else {
+        snprintf(value_str, sizeof(value_str), "%d", distance_cm);
+        strcpy(unit, "cm");
+    }
+
+    // Sets port state
+    if (distance_cm < 10) {
+        port_status = "OPEN";
+    }
+
+    // Displays status and distance on the terminal
+    printf("Status: %s | Distance: %s %s\n", port_status, value_str, unit);
+
+    // Updates OLED display
+    display_oled(distance_cm, port_status);
+
+    // Error handling and out-of-range logic
+    if (distance_cm == INVALID_DISTANCE) {
+        printf("Reading error.\n");
+        gpio_put(BUZZER_PIN, 0);
+        // Turns off both LEDs on error
+        gpio_put(LED_GREEN, 0);
+        gpio_put(LED_RED, 0);
+    } else if (distance_cm > MAX_DISTANCE_CM) {
+        printf("Out of reach.\n");
+        gpio_put(BUZZER_PIN, 0);
+        // Turns off both LEDs when out of range
+        gpio_put(LED_GREEN, 0);
+        gpio_put(LED_RED, 0);
+    } else {
+        // Register to SD card
+#if SD_IMAGE_BACKEND
+        sd_image_stats before;
+        sd_image_get_stats(&sd_image, &before);
+#endif
+#if LOG_FORMAT_BINARY
+        record_distance_binary(distance_cm, range_status, distance_cm < 10, time_ms);
+#else
+        (void)range_status;     // The CSV log only has the gate status
+        record_distance(distance_cm, port_status, time_ms);
+#endif
+#if SD_IMAGE_BACKEND
+        account_record_io(&before);
+#endif
+
+        // LED logic
+        if (distance_cm < 10) {  // Very close - Red alert
+            gpio_put(LED_GREEN, 0);
+            gpio_put(LED_RED, 1);
+        } else if (distance_cm < 50) {  // Object detected - green LED
+            gpio_put(LED_GREEN, 1);
+            gpio_put(LED_RED, 0);
+        } else {  // No objects nearby - LEDs off
+            gpio_put(LED_GREEN, 0);
+            gpio_put(LED_RED, 0);
+        }
+
+        // Buzzer control with soft beep pattern
+        static uint32_t last_buzzer_toggle = 0;
+        uint32_t current_time = to_ms_since_boot(get_absolute_time());
+        
+        if (distance_cm < BUZZER_DISTANCE_THRESHOLD) {
+            uint32_t elapsed_time = current_time - last_buzzer_toggle;
+            
+            if (elapsed_time >= 1100) { // Reset cycle after 1.1 seconds
+                last_buzzer_toggle = current_time;
+                // Set 50% duty cycle for clear beep
+                pwm_set_chan_level(buzzer_slice, buzzer_channel, buzzer_wrap / 2);
+            } else if (elapsed_time >= 100) { // Turn off after 100ms
+                // Set 0% duty cycle to turn off
+                pwm_set_chan_level(buzzer_slice, buzzer_channel, 0);
+            }
+        } else {
+            pwm_set_chan_level(buzzer_slice, buzzer_channel, 0);
+            last_buzzer_toggle = current_time;
+        }
+    }
+}
+
+// === Pipeline consumer: runs process_sample on core1 ===
+void process_sample_consumer(const distance_sample* sample, void* context) {
+    (void)context;
+    process_sample(sample->distance_cm, sample->range_status, sample->time_ms);
+}
+
+// === Core1 entry: drains the pipeline and keeps the SD log synced ===
+void core1_main() {
+    uint32_t last_report = to_ms_since_boot(get_absolute_time());
+
+    while (1) {
+        // Sleeps until core0 signals a new sample (or any other event)
+        if (sample_pipeline_drain(&pipeline, 0) == 0) {
+            __wfe();
+        }
+
+        // Time based f_sync of the buffered log lines
+        poll_distance_log();
+
+        uint32_t now = to_ms_since_boot(get_absolute_time());
+        if (now - last_report >= PIPELINE_REPORT_INTERVAL_MS) {
+            sample_pipeline_stats stats;
+            sample_pipeline_get_stats(&pipeline, &stats);
+            printf("Pipeline: %lu samples, %lu dropped, high-water %lu/%d\n",
+                   (unsigned long)stats.submitted, (unsigned long)stats.dropped,
+                   (unsigned long)stats.high_water, SAMPLE_PIPELINE_SLOTS);
+            // Whether the cores wait for each other on the SD card
+            ff_mutex_stats_t lock;
+            if (ff_mutex_get_stats(0, &lock)) {
+                printf("FatFs volume lock: %lu taken, %lu contended (avg %lu us, max %lu us), %lu timeouts, "
+                       "%lu refused in IRQs\n",
+                       (unsigned long)lock.takes, (unsigned long)lock.contended,
+                       (unsigned long)(lock.contended ? lock.wait_us / lock.contended : 0),
+                       (unsigned long)lock.max_wait_us, (unsigned long)lock.timeouts,
+                       (unsigned long)lock.irq_refusals);
+            }
+            last_report = now;
+        }
+    }
+}
+
 // === Main function ===
 int main() {
     stdio_init_all();
@@ -185,110 +720,97 @@ int main() {
         while (1);
     }
     printf("VL53L0X sensor initialized successfully.\n");
+#if I2C_DMA_QUEUE
+    // Both drivers switch to the queues once the devices are configured
+    if (i2c_queue_init(&sensor_bus, PORT_I2C)) {
+        if (i2c_queue_init(&display_bus, SSD1306_I2C_PORT)) {
+            vl53l0x_use_queue(&sensor, &sensor_bus);
+            ssd1306_SetQueue(&display_bus);
+            printf("I2C DMA queues enabled\n");
+        } else {
+            // The sensor bus goes back to blocking access with its interrupt off
+            i2c_queue_deinit(&sensor_bus);
+            printf("No DMA channels for the I2C queues, staying blocking\n");
+        }
+    } else {
+        printf("No DMA channels for the I2C queues, staying blocking\n");
+    }
+#endif
+#ifdef VL53L0X_TIMING_BUDGET_US
+    if (!vl53l0x_set_timing_budget_us(&sensor, VL53L0X_TIMING_BUDGET_US)) {
+        printf("Timing budget %d us rejected\n", VL53L0X_TIMING_BUDGET_US);
+    }
+#endif
+    printf("VL53L0X timing budget: %lu us\n", (unsigned long)vl53l0x_get_timing_budget_us(&sensor));
+#ifdef VL53L0X_GPIO1_PIN
+    if (vl53l0x_enable_gpio1_interrupt(&sensor, VL53L0X_GPIO1_PIN)) {
+        printf("VL53L0X data-ready interrupt on GPIO %d\n", VL53L0X_GPIO1_PIN);
+    }
+#endif
 
     // Initialize Buzzer with PWM
     gpio_set_function(BUZZER_PIN, GPIO_FUNC_PWM);
-    uint slice_num = pwm_gpio_to_slice_num(BUZZER_PIN);
-    uint channel = pwm_gpio_to_channel(BUZZER_PIN);
+    buzzer_slice = pwm_gpio_to_slice_num(BUZZER_PIN);
+    buzzer_channel = pwm_gpio_to_channel(BUZZER_PIN);
     
     // Set frequency (4kHz)
     uint32_t clock = 125000000;
     uint32_t divider16 = clock / BUZZER_FREQ / 4096 + (clock % (BUZZER_FREQ * 4096) != 0);
     if (divider16 / 16 == 0)
         divider16 = 16;
-    uint32_t wrap = clock * 16 / divider16 / BUZZER_FREQ - 1;
-    pwm_set_clkdiv_int_frac(slice_num, divider16/16, divider16 & 0xF);
-    pwm_set_wrap(slice_num, wrap);
-    pwm_set_enabled(slice_num, true);
+    buzzer_wrap = clock * 16 / divider16 / BUZZER_FREQ - 1;
+    pwm_set_clkdiv_int_frac(buzzer_slice, divider16/16, divider16 & 0xF);
+    pwm_set_wrap(buzzer_slice, buzzer_wrap);
+    pwm_set_enabled(buzzer_slice, true);
 
     vl53l0x_start_continuous(&sensor, 0);
     printf("Sensor in continuous mode. Collecting data...\n");
 
     uint8_t ultima_posicao = 255;
 
+#if DUAL_CORE_PIPELINE
+    // Core1 owns the display, the SD card, the LEDs and the buzzer from here on
+    sample_pipeline_init(&pipeline);
+    sample_pipeline_add_consumer(&pipeline, process_sample_consumer, NULL);
+    multicore_launch_core1(core1_main);
+#endif
+
     // === Main loop ===
+    // The sensor is polled without blocking, so the SD sync and the other work
+    // never wait for the ranging to complete
+    uint64_t last_sample_ms = 0;
     while (1) {
-        // Reads distance from sensor
-        uint16_t distance_cm = vl53l0x_reads_distance_from_sensor_cm(&sensor);
+        // Checks the sensor for a new sample
+        vl53l0x_sample reading;
+        vl53l0x_poll_result result = vl53l0x_poll_sample(&sensor, &reading);
         uint64_t time_ms = to_ms_since_boot(get_absolute_time());
 
-        char value_str[16], unit[4];
-        const char* port_status = "CLOSE";
-
-        // Decide unit for terminal and logic
-        if (distance_cm >= 100 && distance_cm < INVALID_DISTANCE) {
-            snprintf(value_str, sizeof(value_str), "%.2f", distance_cm / 100.0f);
-            strcpy(unit, "m");
-        } else if (distance_cm == INVALID_DISTANCE) {
-            strcpy(value_str, "ERROR");
-            strcpy(unit, "");
-        } else {
-            snprintf(value_str, sizeof(value_str), "%d", distance_cm);
-            strcpy(unit, "cm");
-        }
-
-        // Sets port state
-        if (distance_cm < 10) {
-            port_status = "OPEN";
-        }
-
-        // Displays status and distance on the terminal
-        printf("Status: %s | Distance: %s %s\n", port_status, value_str, unit);
-
-        // Updates OLED display
-        display_oled(distance_cm, port_status);
-
-        // Error handling and out-of-range logic
-        if (distance_cm == INVALID_DISTANCE) {
-            printf("Reading error.\n");
-            gpio_put(BUZZER_PIN, 0);
-            // Turns off both LEDs on error
-            gpio_put(LED_GREEN, 0);
-            gpio_put(LED_RED, 0);
-        } else if (distance_cm > MAX_DISTANCE_CM) {
-            printf("Out of reach.\n");
-            gpio_put(BUZZER_PIN, 0);
-            // Turns off both LEDs when out of range
-            gpio_put(LED_GREEN, 0);
-            gpio_put(LED_RED, 0);
-        } else {
-            // Register to SD card
-            record_distance(distance_cm, port_status, time_ms);
-
-            // LED logic
-            if (distance_cm < 10) {  // Very close - Red alert
-                gpio_put(LED_GREEN, 0);
-                gpio_put(LED_RED, 1);
-            } else if (distance_cm < 50) {  // Object detected - green LED
-                gpio_put(LED_GREEN, 1);
-                gpio_put(LED_RED, 0);
-            } else {  // No objects nearby - LEDs off
-                gpio_put(LED_GREEN, 0);
-                gpio_put(LED_RED, 0);
-            }
-
-            // Buzzer control with soft beep pattern
-            static uint32_t last_buzzer_toggle = 0;
-            uint32_t current_time = to_ms_since_boot(get_absolute_time());
-            
-            if (distance_cm < BUZZER_DISTANCE_THRESHOLD) {
-                uint32_t elapsed_time = current_time - last_buzzer_toggle;
-                
-                if (elapsed_time >= 1100) { // Reset cycle after 1.1 seconds
-                    last_buzzer_toggle = current_time;
-                    // Set 50% duty cycle for clear beep
-                    pwm_set_chan_level(slice_num, channel, wrap / 2);
-                } else if (elapsed_time >= 100) { // Turn off after 100ms
-                    // Set 0% duty cycle to turn off
-                    pwm_set_chan_level(slice_num, channel, 0);
-                }
-            } else {
-                pwm_set_chan_level(slice_num, channel, 0);
-                last_buzzer_toggle = current_time;
+        if (result != VL53L0X_NOT_READY && time_ms - last_sample_ms >= SAMPLE_PERIOD_MS) {
+            last_sample_ms = time_ms;
+            // A timeout reports INVALID_DISTANCE, just like the blocking read
+            uint16_t distance_cm = INVALID_DISTANCE;
+            uint8_t range_status = VL53L0X_RANGE_STATUS_NONE;
+            if (result == VL53L0X_SAMPLE) {
+                distance_cm = vl53l0x_sample_to_cm(&reading);
+                range_status = reading.range_status;
             }
+#if DUAL_CORE_PIPELINE
+            // Only timestamps and queues the reading; core1 does the slow work
+            distance_sample sample = {
+                .time_ms = (uint32_t)time_ms, .distance_cm = distance_cm, .range_status = range_status};
+            sample_pipeline_submit(&pipeline, &sample);
+            __sev();
+#else
+            process_sample(distance_cm, range_status, time_ms);
+#endif
         }
+
+#if !DUAL_CORE_PIPELINE
+        // Time based f_sync of the buffered log lines
+        poll_distance_log();
+#endif
         
-        sleep_ms(200);
+        sleep_ms(POLL_INTERVAL_MS);
     }
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,81 @@
+#include "sample_pipeline.h"
+#include <string.h>
+
+// Head and tail are free-running counters; the slot index is the counter masked
+#define SLOT_MASK (SAMPLE_PIPELINE_SLOTS - 1)
+
+// ========================== Setup ==========================
+
+void sample_pipeline_init(sample_pipeline* pipeline) {
+    memset(pipeline->slots, 0, sizeof(pipeline->slots));
+    atomic_init(&pipeline->head, 0);
+    atomic_init(&pipeline->tail, 0);
+    atomic_init(&pipeline->dropped, 0);
+    atomic_init(&pipeline->high_water, 0);
+    atomic_init(&pipeline->consumed, 0);
+    pipeline->consumer_count = 0;
+}
+
+bool sample_pipeline_add_consumer(sample_pipeline* pipeline, sample_consumer consumer, void* context) {
+    if (pipeline->consumer_count == SAMPLE_PIPELINE_MAX_CONSUMERS) return false;
+    pipeline->consumers[pipeline->consumer_count] = consumer;
+    pipeline->contexts[pipeline->consumer_count] = context;
+    pipeline->consumer_count++;
+    return true;
+}
+
+// ========================== Producer side ==========================
+
+bool sample_pipeline_submit(sample_pipeline* pipeline, const distance_sample* sample) {
+    uint32_t head = atomic_load_explicit(&pipeline->head, memory_order_relaxed);
+    uint32_t tail = atomic_load_explicit(&pipeline->tail, memory_order_acquire);
+    uint32_t used = head - tail;
+
+    if (used == SAMPLE_PIPELINE_SLOTS) {
+        // Full: the newest sample is dropped so the consumer never sees a torn slot
+        uint32_t dropped = atomic_load_explicit(&pipeline->dropped, memory_order_relaxed);
+        atomic_store_explicit(&pipeline->dropped, dropped + 1, memory_order_relaxed);
+        return false;
+    }
+
+    pipeline->slots[head & SLOT_MASK] = *sample;
+    // Release: the slot contents become visible before the new head
+    atomic_store_explicit(&pipeline->head, head + 1, memory_order_release);
+
+    if (used + 1 > atomic_load_explicit(&pipeline->high_water, memory_order_relaxed)) {
+        atomic_store_explicit(&pipeline->high_water, used + 1, memory_order_relaxed);
+    }
+    return true;
+}
+
+// ========================== Consumer side ==========================
+
+size_t sample_pipeline_drain(sample_pipeline* pipeline, size_t max_samples) {
+    uint32_t tail = atomic_load_explicit(&pipeline->tail, memory_order_relaxed);
+    uint32_t head = atomic_load_explicit(&pipeline->head, memory_order_acquire);
+    size_t count = 0;
+
+    while (tail != head && (max_samples == 0 || count < max_samples)) {
+        // Copies the slot out so the producer can reuse it while consumers run
+        distance_sample sample = pipeline->slots[tail & SLOT_MASK];
+        atomic_store_explicit(&pipeline->tail, ++tail, memory_order_release);
+
+        for (size_t i = 0; i < pipeline->consumer_count; i++) {
+            pipeline->consumers[i](&sample, pipeline->contexts[i]);
+        }
+        // Single writer: a plain increment, published atomically for get_stats
+        uint32_t consumed = atomic_load_explicit(&pipeline->consumed, memory_order_relaxed);
+        atomic_store_explicit(&pipeline->consumed, consumed + 1, memory_order_relaxed);
+        count++;
+    }
+    return count;
+}
+
+// ========================== Statistics ==========================
+
+void sample_pipeline_get_stats(sample_pipeline* pipeline, sample_pipeline_stats* stats) {
+    stats->submitted = atomic_load_explicit(&pipeline->head, memory_order_relaxed);
+    stats->dropped = atomic_load_explicit(&pipeline->dropped, memory_order_relaxed);
+    stats->consumed = atomic_load_explicit(&pipeline->consumed, memory_order_relaxed);
+    stats->high_water = atomic_load_explicit(&pipeline->high_water, memory_order_relaxed);
+}
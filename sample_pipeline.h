@@ -0,0 +1,70 @@
+#ifndef SAMPLE_PIPELINE_H
+#define SAMPLE_PIPELINE_H
+
+// Hand-off of sensor samples from the acquisition core to the storage/display core.
+// A single-producer single-consumer ring: core0 only calls sample_pipeline_submit,
+// core1 only calls sample_pipeline_drain. No locks and no Pico SDK dependencies,
+// so the same code runs with two pthreads on a Linux host.
+#include <stdatomic.h>   // Lock-free head/tail indexes shared between the cores
+#include <stdbool.h>     // Allows the use of the bool type (true/false)
+#include <stddef.h>      // Allows the use of size_t
+#include <stdint.h>      // Allows the use of types like uint16_t, uint32_t, etc.
+
+// Number of slots in the ring; must be a power of two
+#ifndef SAMPLE_PIPELINE_SLOTS
+#define SAMPLE_PIPELINE_SLOTS 32
+#endif
+
+// Maximum number of consumers called for each sample
+#define SAMPLE_PIPELINE_MAX_CONSUMERS 4
+
+_Static_assert((SAMPLE_PIPELINE_SLOTS & (SAMPLE_PIPELINE_SLOTS - 1)) == 0,
+               "SAMPLE_PIPELINE_SLOTS must be a power of two");
+
+// One timestamped reading
+typedef struct {
+    uint32_t time_ms;        // Time since boot when the reading completed
+    uint16_t distance_cm;    // Distance as returned by the sensor driver
+    uint8_t range_status;    // Device range status of the reading (vl53l0x_sample)
+} distance_sample;
+
+// Function called on the consumer side for every drained sample
+typedef void (*sample_consumer)(const distance_sample* sample, void* context);
+
+// Counters reported by sample_pipeline_get_stats
+typedef struct {
+    uint32_t submitted;      // Samples accepted by the ring
+    uint32_t dropped;        // Samples lost because the ring was full
+    uint32_t consumed;       // Samples handed to the consumers
+    uint32_t high_water;     // Highest ring occupancy seen by the producer
+} sample_pipeline_stats;
+
+// Structure representing the pipeline shared by both cores
+typedef struct {
+    distance_sample slots[SAMPLE_PIPELINE_SLOTS];
+    atomic_uint_least32_t head;        // Next slot to write; only the producer stores it
+    atomic_uint_least32_t tail;        // Next slot to read; only the consumer stores it
+    atomic_uint_least32_t dropped;     // Producer-owned counters, read by the consumer
+    atomic_uint_least32_t high_water;
+    sample_consumer consumers[SAMPLE_PIPELINE_MAX_CONSUMERS];
+    void* contexts[SAMPLE_PIPELINE_MAX_CONSUMERS];
+    size_t consumer_count;
+    atomic_uint_least32_t consumed;    // Consumer-owned counter, read by the producer
+} sample_pipeline;
+
+// Function to reset the ring and remove all consumers
+void sample_pipeline_init(sample_pipeline* pipeline);
+
+// Function to register a consumer; call before the consumer core starts draining
+bool sample_pipeline_add_consumer(sample_pipeline* pipeline, sample_consumer consumer, void* context);
+
+// Producer side: queues one sample, or counts a drop when the ring is full
+bool sample_pipeline_submit(sample_pipeline* pipeline, const distance_sample* sample);
+
+// Consumer side: passes up to max_samples queued samples to every consumer (0 = all)
+size_t sample_pipeline_drain(sample_pipeline* pipeline, size_t max_samples);
+
+// Function to read the counters; safe to call from either side
+void sample_pipeline_get_stats(sample_pipeline* pipeline, sample_pipeline_stats* stats);
+
+#endif // SAMPLE_PIPELINE_H
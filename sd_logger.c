@@ -0,0 +1,396 @@
+#include "sd_logger.h"
+#include "pico/stdlib.h"
+#include "diskio.h"
+#include <stdio.h>
+#include <string.h>
+
+// ========================== Auxiliary functions ==========================
+
+// Returns the current time in milliseconds since boot
+static inline uint32_t current_time_ms() {
+    return to_ms_since_boot(get_absolute_time());
+}
+
+// Drive of the open log file
+static inline BYTE log_drive(const sd_logger* logger) {
+    return logger->file.obj.fs->pdrv;
+}
+
+// Writes count whole sectors from the start of the buffer into the extent
+static bool write_extent(sd_logger* logger, const uint8_t* data, uint32_t count) {
+    LBA_t sector = logger->extent_lba + (LBA_t)(logger->extent_written / SD_LOGGER_SECTOR_SIZE);
+    DRESULT dr = disk_write(log_drive(logger), data, sector, count);
+    logger->writes++;
+    if (dr != RES_OK) {
+        printf("Log extent write failed: %d\n", dr);
+        return false;
+    }
+    return true;
+}
+
+// Extent mode: writes the whole sectors of the buffer by LBA. The buffer
+// always starts on a sector boundary of the file here. Once the extent is
+// full the file position moves to its end and FatFs appends from there.
+static bool flush_extent(sd_logger* logger) {
+    uint32_t count = (uint32_t)(logger->used / SD_LOGGER_SECTOR_SIZE);
+    uint32_t left = logger->extent_sectors - (uint32_t)(logger->extent_written / SD_LOGGER_SECTOR_SIZE);
+    if (count > left) count = left;
+    if (count == 0) return true;
+
+    if (!write_extent(logger, logger->buffer, count)) return false;
+    size_t length = (size_t)count * SD_LOGGER_SECTOR_SIZE;
+    logger->extent_written += length;
+    logger->used -= length;
+    memmove(logger->buffer, logger->buffer + length, logger->used);
+
+    if (count == left) {
+        FRESULT fr = f_lseek(&logger->file, logger->extent_written);
+        logger->extent_sectors = 0;
+        if (fr != FR_OK) {
+            printf("Log seek past the extent failed: %d\n", fr);
+            return false;
+        }
+    }
+    return true;
+}
+
+// Writes the longest prefix of the buffer that ends on a sector boundary of the file.
+// Appending a partial sector forces FatFs to read-modify-write it, so anything
+// past the last boundary stays in RAM until more data arrives or a sync is due.
+static bool flush_whole_sectors(sd_logger* logger) {
+    if (logger->extent_sectors) {
+        if (!flush_extent(logger)) return false;
+        if (logger->extent_sectors) return true;
+    }
+    FSIZE_t position = f_tell(&logger->file);
+    size_t head = (SD_LOGGER_SECTOR_SIZE - (size_t)(position % SD_LOGGER_SECTOR_SIZE)) % SD_LOGGER_SECTOR_SIZE;
+    if (logger->used < head) return true;
+
+    size_t length = head + ((logger->used - head) / SD_LOGGER_SECTOR_SIZE) * SD_LOGGER_SECTOR_SIZE;
+    if (length == 0) return true;
+
+    UINT written = 0;
+    FRESULT fr = f_write(&logger->file, logger->buffer, length, &written);
+    logger->writes++;
+    if (fr != FR_OK || written != length) {
+        printf("Log write failed: %d\n", fr);
+        return false;
+    }
+
+    // Keeps the tail that did not fill a sector at the start of the buffer
+    logger->used -= length;
+    memmove(logger->buffer, logger->buffer + length, logger->used);
+    return true;
+}
+
+// Clears the whole extent. Nothing else says where the data ends after a
+// power loss: f_expand does not clear clusters, and they can hold a trimmed
+// card's 0xFF or the stale data of earlier files. Done before the directory
+// entry gets the extent size, so a power loss meanwhile leaves an empty file.
+static bool zero_extent(sd_logger* logger) {
+    uint32_t step = SD_LOGGER_BUFFER_SECTORS;
+    memset(logger->buffer, 0, sizeof(logger->buffer)); // Nothing is buffered yet
+    for (uint32_t done = 0; done < logger->extent_sectors; done += step) {
+        uint32_t count = logger->extent_sectors - done < step ? logger->extent_sectors - done : step;
+        DRESULT dr = disk_write(log_drive(logger), logger->buffer, logger->extent_lba + done, count);
+        logger->writes++;
+        if (dr != RES_OK) {
+            printf("Log extent clear failed: %d\n", dr);
+            return false;
+        }
+    }
+    // On the medium before f_sync writes the directory entry
+    DRESULT dr = disk_ioctl(log_drive(logger), CTRL_SYNC, NULL);
+    logger->syncs++;
+    if (dr != RES_OK) {
+        printf("Log extent clear failed: %d\n", dr);
+        return false;
+    }
+    return true;
+}
+
+// Reads length bytes of the open file at offset
+static bool read_at(sd_logger* logger, FSIZE_t offset, uint8_t* data, UINT length) {
+    UINT got = 0;
+    FRESULT fr = f_lseek(&logger->file, offset);
+    if (fr == FR_OK) fr = f_read(&logger->file, data, length, &got);
+    if (fr != FR_OK || got != length) {
+        printf("Log read at %lu failed: %d\n", (unsigned long)offset, fr);
+        return false;
+    }
+    return true;
+}
+
+// Cuts the zeros an unclosed extent holds after the text, leaving the
+// position at the new end. The extent was cleared when it was created
+// (zero_extent), so its sectors are data up to the last one written and zeros
+// after it: the first byte of a sector tells them apart and a binary search
+// needs log2(sectors) reads.
+static bool cut_padding(sd_logger* logger) {
+    uint8_t* sector = logger->buffer; // Scratch: nothing is buffered yet
+    FSIZE_t size = f_size(&logger->file);
+    if (size == 0) return true;
+    if (!read_at(logger, size - 1, sector, 1)) return false;
+    if (sector[0] != 0) return true; // Closed cleanly: the file ends in text
+
+    uint32_t low = 0, high = (uint32_t)((size + SD_LOGGER_SECTOR_SIZE - 1) / SD_LOGGER_SECTOR_SIZE);
+    while (low < high) {
+        uint32_t middle = low + (high - low) / 2;
+        if (!read_at(logger, (FSIZE_t)middle * SD_LOGGER_SECTOR_SIZE, sector, 1)) return false;
+        if (sector[0] != 0) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+
+    // The last data sector was synced zero padded: the text ends at its last
+    // nonzero byte. A full sector written between two syncs can end inside a
+    // line, so the text is cut after the last newline of the sector.
+    FSIZE_t end = 0;
+    if (low > 0) {
+        FSIZE_t offset = (FSIZE_t)(low - 1) * SD_LOGGER_SECTOR_SIZE;
+        UINT length = size - offset < SD_LOGGER_SECTOR_SIZE ? (UINT)(size - offset) : SD_LOGGER_SECTOR_SIZE;
+        if (!read_at(logger, offset, sector, length)) return false;
+        while (length > 0 && sector[length - 1] == 0) length--;
+        UINT lines = length;
+        while (lines > 0 && sector[lines - 1] != '\n') lines--;
+        end = offset + (lines ? lines : length);
+    }
+
+    FRESULT fr = f_lseek(&logger->file, end);
+    if (fr == FR_OK) fr = f_truncate(&logger->file);
+    if (fr == FR_OK) fr = f_sync(&logger->file);
+    if (fr != FR_OK) {
+        printf("Log padding cut failed: %d\n", fr);
+        return false;
+    }
+    printf("Log padding cut: %lu -> %lu bytes\n", (unsigned long)size, (unsigned long)end);
+    return true;
+}
+
+// ========================== Opening and policy ==========================
+
+// Opens path with the FatFs mode flags and resets the logger state
+static bool open_file(sd_logger* logger, const char* path, BYTE mode) {
+    FRESULT fr = f_open(&logger->file, path, mode);
+    if (fr != FR_OK) {
+        printf("File open failed: %d\n", fr);
+        logger->is_open = false;
+        return false;
+    }
+
+    logger->is_open = true;
+    logger->extent_lba = 0;
+    logger->extent_sectors = 0;
+    logger->extent_written = 0;
+    logger->used = 0;
+    logger->sync_interval_ms = SD_LOGGER_SYNC_INTERVAL_MS;
+    logger->sync_bytes = SD_LOGGER_SYNC_BYTES;
+    logger->last_sync_ms = current_time_ms();
+    logger->bytes_since_sync = 0;
+    logger->writes = 0;
+    logger->syncs = 0;
+    return true;
+}
+
+bool sd_logger_open(sd_logger* logger, const char* path, bool truncate) {
+    return open_file(logger, path, FA_WRITE | (truncate ? FA_CREATE_ALWAYS : FA_OPEN_APPEND));
+}
+
+bool sd_logger_open_extent(sd_logger* logger, const char* path, uint32_t extent_bytes) {
+    if (!sd_logger_open(logger, path, true)) return false;
+
+    // Whole clusters, all in a row; the allocation reaches the FAT once, here
+    FATFS* fs = logger->file.obj.fs;
+    FSIZE_t cluster_bytes = (FSIZE_t)fs->csize * SD_LOGGER_SECTOR_SIZE;
+    FSIZE_t size = (extent_bytes + cluster_bytes - 1) / cluster_bytes * cluster_bytes;
+    FRESULT fr = size ? f_expand(&logger->file, size, 1) : FR_INVALID_PARAMETER;
+    if (fr != FR_OK) {
+        printf("Log extent of %lu bytes not available (%d), appending instead\n", (unsigned long)size, fr);
+        return true;
+    }
+    logger->extent_lba = fs->database + (LBA_t)fs->csize * (logger->file.obj.sclust - 2);
+    logger->extent_sectors = (uint32_t)(size / SD_LOGGER_SECTOR_SIZE);
+    if (!zero_extent(logger)) fr = FR_DISK_ERR;
+    if (fr == FR_OK) fr = f_sync(&logger->file);
+    if (fr != FR_OK) {
+        printf("Log extent setup failed: %d\n", fr);
+        f_close(&logger->file);
+        logger->is_open = false;
+        return false;
+    }
+    return true;
+}
+
+bool sd_logger_append_extent(sd_logger* logger, const char* path, uint32_t extent_bytes) {
+    FILINFO info;
+    if (f_stat(path, &info) == FR_NO_FILE) return sd_logger_open_extent(logger, path, extent_bytes);
+
+    // Read access for the padding scan
+    if (!open_file(logger, path, FA_READ | FA_WRITE | FA_OPEN_APPEND)) return false;
+    if (!cut_padding(logger)) {
+        f_close(&logger->file);
+        logger->is_open = false;
+        return false;
+    }
+    return true;
+}
+
+bool sd_logger_resume(sd_logger* logger, const char* path, FSIZE_t offset, LBA_t extent_lba,
+                      uint32_t extent_sectors) {
+    if (offset % SD_LOGGER_SECTOR_SIZE) return false;
+    if (!open_file(logger, path, FA_WRITE | FA_OPEN_EXISTING)) return false;
+
+    if (extent_sectors && offset < (FSIZE_t)extent_sectors * SD_LOGGER_SECTOR_SIZE) {
+        // Still the whole extent: carries on writing it by LBA
+        logger->extent_lba = extent_lba;
+        logger->extent_sectors = extent_sectors;
+        logger->extent_written = offset;
+        return true;
+    }
+    // Follows the cluster chain once, like FA_OPEN_APPEND does
+    FRESULT fr = f_lseek(&logger->file, offset);
+    if (fr != FR_OK) {
+        printf("Log seek to %lu failed: %d\n", (unsigned long)offset, fr);
+        f_close(&logger->file);
+        logger->is_open = false;
+        return false;
+    }
+    return true;
+}
+
+void sd_logger_set_sync_policy(sd_logger* logger, uint32_t interval_ms, uint32_t bytes) {
+    logger->sync_interval_ms = interval_ms;
+    logger->sync_bytes = bytes;
+}
+
+// ========================== Writing ==========================
+
+bool sd_logger_write(sd_logger* logger, const void* data, size_t length) {
+    if (!logger->is_open) return false;
+
+    const uint8_t* src = data;
+    while (length > 0) {
+        size_t space = sizeof(logger->buffer) - logger->used;
+        size_t chunk = length < space ? length : space;
+        memcpy(logger->buffer + logger->used, src, chunk);
+        logger->used += chunk;
+        logger->bytes_since_sync += chunk;
+        src += chunk;
+        length -= chunk;
+
+        // Buffer full: hands the completed sectors to FatFs
+        if (logger->used == sizeof(logger->buffer) && !flush_whole_sectors(logger)) {
+            return false;
+        }
+    }
+
+    // Byte based sync policy
+    if (logger->sync_bytes && logger->bytes_since_sync >= logger->sync_bytes) {
+        return sd_logger_sync(logger);
+    }
+    return true;
+}
+
+// Extent mode sync: the partial sector goes to its place zero padded and
+// stays buffered, to be written again once it fills up
+static bool sync_extent(sd_logger* logger) {
+    if (logger->used > 0) {
+        uint8_t sector[SD_LOGGER_SECTOR_SIZE] = {0};
+        memcpy(sector, logger->buffer, logger->used);
+        if (!write_extent(logger, sector, 1)) return false;
+    }
+    DRESULT dr = disk_ioctl(log_drive(logger), CTRL_SYNC, NULL);
+    logger->syncs++;
+    logger->last_sync_ms = current_time_ms();
+    logger->bytes_since_sync = 0;
+    if (dr != RES_OK) {
+        printf("Log sync failed: %d\n", dr);
+        return false;
+    }
+    return true;
+}
+
+bool sd_logger_sync(sd_logger* logger) {
+    if (!logger->is_open) return false;
+
+    // Writes whole sectors first, then whatever partial sector is left
+    if (!flush_whole_sectors(logger)) return false;
+    if (logger->extent_sectors) return sync_extent(logger);
+    if (logger->used > 0) {
+        UINT written = 0;
+        FRESULT fr = f_write(&logger->file, logger->buffer, logger->used, &written);
+        logger->writes++;
+        if (fr != FR_OK || written != logger->used) {
+            printf("Log write failed: %d\n", fr);
+            return false;
+        }
+        logger->used = 0;
+    }
+
+    FRESULT fr = f_sync(&logger->file);
+    logger->syncs++;
+    logger->last_sync_ms = current_time_ms();
+    logger->bytes_since_sync = 0;
+    if (fr != FR_OK) {
+        printf("Log sync failed: %d\n", fr);
+        return false;
+    }
+    return true;
+}
+
+bool sd_logger_poll(sd_logger* logger) {
+    if (!logger->is_open || logger->bytes_since_sync == 0 || logger->sync_interval_ms == 0) return true;
+
+    // Time based sync policy
+    if (current_time_ms() - logger->last_sync_ms >= logger->sync_interval_ms) {
+        return sd_logger_sync(logger);
+    }
+    return true;
+}
+
+bool sd_logger_rewind_sector(sd_logger* logger) {
+    if (!logger->is_open || logger->used > 0) return false;
+
+    if (logger->extent_sectors) {
+        if (logger->extent_written < SD_LOGGER_SECTOR_SIZE) return false;
+        logger->extent_written -= SD_LOGGER_SECTOR_SIZE;
+        return true;
+    }
+    // Stays in the current cluster, so FatFs does not walk the chain again
+    FSIZE_t position = f_tell(&logger->file);
+    if (position < SD_LOGGER_SECTOR_SIZE) return false;
+    FRESULT fr = f_lseek(&logger->file, position - SD_LOGGER_SECTOR_SIZE);
+    if (fr != FR_OK) {
+        printf("Log rewind failed: %d\n", fr);
+        return false;
+    }
+    return true;
+}
+
+// ========================== Closing ==========================
+
+bool sd_logger_close(sd_logger* logger) {
+    if (!logger->is_open) return false;
+
+    bool ok = sd_logger_sync(logger);
+    if (ok && logger->extent_sectors) {
+        // Gives the unused end of the extent back (trimmed with FF_USE_TRIM)
+        FRESULT fr = f_lseek(&logger->file, logger->extent_written + logger->used);
+        if (fr == FR_OK) fr = f_truncate(&logger->file);
+        if (fr != FR_OK) {
+            printf("Log truncate failed: %d\n", fr);
+            ok = false;
+        }
+        logger->used = 0;
+        logger->extent_sectors = 0;
+    }
+    FRESULT fr = f_close(&logger->file);
+    logger->is_open = false;
+    if (fr != FR_OK) {
+        printf("File close failed: %d\n", fr);
+        return false;
+    }
+    return ok;
+}
@@ -0,0 +1,92 @@
+#ifndef SD_LOGGER_H
+#define SD_LOGGER_H
+
+// Inclusion of standard libraries for boolean and fixed-length integer types
+#include <stdbool.h>     // Allows the use of the bool type (true/false)
+#include <stddef.h>      // Allows the use of size_t
+#include <stdint.h>      // Allows the use of types like uint8_t, uint32_t, etc.
+
+// FatFs file object
+#include "ff.h"
+
+// Size of one SD sector; data is only handed to f_write in multiples of it
+#define SD_LOGGER_SECTOR_SIZE 512
+
+// Number of sectors kept in RAM before they are written to the card
+#ifndef SD_LOGGER_BUFFER_SECTORS
+#define SD_LOGGER_BUFFER_SECTORS 2
+#endif
+
+// Default sync policy: f_sync at most every SD_LOGGER_SYNC_INTERVAL_MS
+// or after SD_LOGGER_SYNC_BYTES new bytes, whichever comes first
+#ifndef SD_LOGGER_SYNC_INTERVAL_MS
+#define SD_LOGGER_SYNC_INTERVAL_MS 5000
+#endif
+#ifndef SD_LOGGER_SYNC_BYTES
+#define SD_LOGGER_SYNC_BYTES 4096
+#endif
+
+// Structure representing a log file that stays open between writes
+typedef struct {
+    FIL file;                   // FatFs file object, kept open while logging
+    bool is_open;               // True between sd_logger_open and sd_logger_close
+    uint8_t buffer[SD_LOGGER_SECTOR_SIZE * SD_LOGGER_BUFFER_SECTORS]; // Pending data
+    size_t used;                // Number of bytes waiting in buffer
+    uint32_t sync_interval_ms;  // Maximum time between f_sync calls (0 disables)
+    uint32_t sync_bytes;        // Maximum bytes written between f_sync calls (0 disables)
+    uint32_t last_sync_ms;      // Time of the last f_sync
+    uint32_t bytes_since_sync;  // Bytes appended since the last f_sync
+    uint32_t writes;            // Number of f_write (or extent disk_write) calls issued
+    uint32_t syncs;             // Number of f_sync (or extent CTRL_SYNC) calls issued
+    LBA_t extent_lba;           // First sector of the preallocated extent
+    uint32_t extent_sectors;    // Sectors in the extent (0 = FatFs grows the file)
+    FSIZE_t extent_written;     // Bytes of the extent already written as whole sectors
+} sd_logger;
+
+// Function to open (or create) a log file; truncate discards existing content
+bool sd_logger_open(sd_logger* logger, const char* path, bool truncate);
+
+// Function to create a log file preallocated as one contiguous extent of
+// extent_bytes (f_expand). Sectors are then written by LBA with disk_write,
+// so appends never touch the FAT or the directory; the file is cut to its
+// real size on close. Until then its size is the extent: after a power loss
+// the data is followed by zeros, as the extent is cleared when it is created
+// (one pass of extent_bytes of writes). Past the extent, or when no contiguous
+// space is free, FatFs appends as usual.
+bool sd_logger_open_extent(sd_logger* logger, const char* path, uint32_t extent_bytes);
+
+// Function to continue a text log across boots in extent mode: a missing file
+// is created with sd_logger_open_extent, an existing one is appended to without
+// a new preallocation. If a power loss left it at its extent size, the NUL
+// padding after the data is cut first, with the line the loss tore (so the
+// data must be text lines without NUL bytes).
+bool sd_logger_append_extent(sd_logger* logger, const char* path, uint32_t extent_bytes);
+
+// Function to reopen an existing log file and go on writing it at offset, a
+// sector boundary, without truncating it: what follows offset is overwritten.
+// A nonzero extent_sectors says the file is still the whole extent starting at
+// extent_lba (sd_logger_open_extent), which is then written by LBA again.
+bool sd_logger_resume(sd_logger* logger, const char* path, FSIZE_t offset, LBA_t extent_lba,
+                      uint32_t extent_sectors);
+
+// Function to change when buffered data is made durable with f_sync
+void sd_logger_set_sync_policy(sd_logger* logger, uint32_t interval_ms, uint32_t bytes);
+
+// Function to append data; only whole sectors reach the card until a sync is due
+bool sd_logger_write(sd_logger* logger, const void* data, size_t length);
+
+// Function to write everything that is buffered and call f_sync
+bool sd_logger_sync(sd_logger* logger);
+
+// Function to run the time based sync policy; call it from the main loop
+bool sd_logger_poll(sd_logger* logger);
+
+// Function to move the write position back one sector, so the next sector
+// written replaces the last one; only when nothing is buffered (after a sync
+// that left no partial sector)
+bool sd_logger_rewind_sector(sd_logger* logger);
+
+// Function to sync and close the log file (cutting an extent to the data)
+bool sd_logger_close(sd_logger* logger);
+
+#endif // SD_LOGGER_H
@@ -0,0 +1,125 @@
+// Host tool: converts a binary distance log (distance.bin) into the CSV layout
+// written by record_distance() in main.c (distance_csv_line in distance_csv.c).
+//
+// Build:  cc -O2 -I.. -o binlog2csv binlog2csv.c
+//         (or the binlog2csv target of the host build, -DBITDOGLAB_HOST=ON)
+// Usage:  binlog2csv distance.bin [distance.csv]
+//
+// Blocks with a bad CRC or a foreign file tag are skipped with a warning on
+// stderr: between valid blocks they are torn sectors the firmware stepped over
+// when it resumed the log (see binlog_format.h), so the rest is still
+// converted. Invalid blocks after the last valid one are the end of the journal
+// (the unused rest of an extent, or a block torn by a power loss).
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "binlog_format.h"
+
+// CRC-16/XMODEM, bit by bit; matches crc16() in lib/FatFs_SPI/sd_driver/crc.c
+static uint16_t crc16_xmodem(const uint8_t* data, size_t length) {
+    uint16_t crc = 0;
+    for (size_t i = 0; i < length; i++) {
+        crc ^= (uint16_t)data[i] << 8;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+// Same text as distance_csv_line(): meters above 1 m, centimeters below
+static void print_record(FILE* out, uint32_t time_ms, const binlog_record* record) {
+    unsigned long minutes = time_ms / 60000;
+    unsigned long seconds = (time_ms / 1000) % 60;
+    const char* status = record->gate_state == BINLOG_GATE_OPEN ? "OPEN" : "CLOSE";
+
+    if (record->distance_mm == BINLOG_DISTANCE_INVALID) {
+        fprintf(out, "%02lu:%02lu,ERROR,-,%s\n", minutes, seconds, status);
+        return;
+    }
+    unsigned distance_cm = record->distance_mm / 10;
+    if (distance_cm >= 100) {
+        fprintf(out, "%02lu:%02lu,%.2f,m,%s\n", minutes, seconds, distance_cm / 100.0f, status);
+    } else {
+        fprintf(out, "%02lu:%02lu,%u,cm,%s\n", minutes, seconds, distance_cm, status);
+    }
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2 || argc > 3) {
+        fprintf(stderr, "usage: %s distance.bin [distance.csv]\n", argv[0]);
+        return 2;
+    }
+    FILE* in = fopen(argv[1], "rb");
+    if (!in) {
+        perror(argv[1]);
+        return 1;
+    }
+    FILE* out = argc == 3 ? fopen(argv[2], "w") : stdout;
+    if (!out) {
+        perror(argv[2]);
+        fclose(in);
+        return 1;
+    }
+
+    // File header
+    uint8_t sector[BINLOG_BLOCK_SIZE];
+    binlog_file_header header;
+    if (fread(sector, 1, sizeof(sector), in) != sizeof(sector)) {
+        fprintf(stderr, "%s: truncated file header\n", argv[1]);
+        return 1;
+    }
+    memcpy(&header, sector, sizeof(header));
+    uint16_t stored_crc = (uint16_t)(sector[sizeof(sector) - 2] | sector[sizeof(sector) - 1] << 8);
+    if (memcmp(header.magic, BINLOG_MAGIC, sizeof(header.magic)) != 0 ||
+        crc16_xmodem(sector, sizeof(sector) - 2) != stored_crc) {
+        fprintf(stderr, "%s: not a binary distance log\n", argv[1]);
+        return 1;
+    }
+    if (header.version != BINLOG_VERSION || header.block_size != BINLOG_BLOCK_SIZE ||
+        header.record_size != sizeof(binlog_record) ||
+        header.records_per_block != BINLOG_RECORDS_PER_BLOCK) {
+        fprintf(stderr, "%s: unsupported format version %u\n", argv[1], header.version);
+        return 1;
+    }
+
+    fprintf(out, "Time,Distance,Unit,Status\n");
+
+    // Data blocks
+    binlog_block block;
+    unsigned long index = 0, records = 0, bad = 0, tail = 0;
+    while (fread(&block, 1, sizeof(block), in) == sizeof(block)) {
+        if (crc16_xmodem((const uint8_t*)&block, offsetof(binlog_block, crc)) != block.crc ||
+            block.header.file_tag != header.file_tag ||
+            block.header.record_count > BINLOG_RECORDS_PER_BLOCK) {
+            // Only counted as bad once a valid block follows
+            tail++;
+            index++;
+            continue;
+        }
+        if (tail) {
+            fprintf(stderr, "warning: blocks %lu-%lu: bad CRC or tag, skipped\n", index - tail, index - 1);
+            bad += tail;
+            tail = 0;
+        }
+        if (block.header.sequence != index) {
+            fprintf(stderr, "block %lu: sequence %lu out of order\n", index,
+                    (unsigned long)block.header.sequence);
+        }
+        uint32_t time_ms = block.header.base_time_ms;
+        for (unsigned i = 0; i < block.header.record_count; i++) {
+            time_ms += block.records[i].delta_ms;
+            print_record(out, time_ms, &block.records[i]);
+        }
+        records += block.header.record_count;
+        index++;
+    }
+
+    fprintf(stderr, "%lu blocks, %lu records, %lu bad blocks, %lu blocks past the end of the journal\n",
+            index - tail, records, bad, tail);
+    if (out != stdout) fclose(out);
+    fclose(in);
+    return 0;
+}
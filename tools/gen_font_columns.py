@@ -0,0 +1,109 @@
+#!/usr/bin/env python3
+"""Transposes the row-major fonts of lib_ssd1306/ssd1306_fonts.c into the
+SSD1306 page layout used by the fast text path of ssd1306_WriteChar.
+
+Each glyph becomes `width` columns of `(height + 7) / 8` bytes; bit r of byte k
+of a column is glyph row 8*k + r, exactly as the controller stores pixels.
+
+Usage:  python3 tools/gen_font_columns.py [--source FONTS_C] [--output FILE]
+
+Without --output the header goes to stdout. To regenerate the one in the tree:
+
+    python3 tools/gen_font_columns.py --output lib_ssd1306/ssd1306_fonts_columns.h
+"""
+import argparse
+import os
+import re
+import sys
+
+ROOT = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..")
+SOURCE = os.path.join(ROOT, "lib_ssd1306", "ssd1306_fonts.c")
+REGENERATE = "python3 tools/gen_font_columns.py --output lib_ssd1306/ssd1306_fonts_columns.h"
+
+GLYPHS = 95  # ' ' (32) to '~' (126)
+
+
+def strip_comments(text):
+    text = re.sub(r"/\*.*?\*/", "", text, flags=re.S)
+    return re.sub(r"//[^\n]*", "", text)
+
+
+def parse_fonts(text):
+    """Returns [(array name, width, height, guard, rows)] in source order."""
+    descriptors = {
+        m.group(3): (int(m.group(1)), int(m.group(2)))
+        for m in re.finditer(r"SSD1306_Font_t\s+\w+\s*=\s*\{\s*(\d+)\s*,\s*(\d+)\s*,\s*(\w+)", text)
+    }
+    fonts = []
+    for m in re.finditer(r"#ifdef\s+(\w+)\s*static const uint16_t (\w+)\s*\[\]\s*=\s*\{(.*?)\};", text, flags=re.S):
+        guard, name, body = m.group(1), m.group(2), m.group(3)
+        width, height = descriptors[name]
+        rows = [int(v, 16) for v in re.findall(r"0x[0-9A-Fa-f]+", body)]
+        if len(rows) != GLYPHS * height:
+            sys.exit(f"{name}: expected {GLYPHS * height} rows, found {len(rows)}")
+        fonts.append((name, width, height, guard, rows))
+    return fonts
+
+
+def transpose(width, height, rows):
+    bands = (height + 7) // 8
+    out = []
+    for glyph in range(GLYPHS):
+        base = glyph * height
+        for column in range(width):
+            for band in range(bands):
+                byte = 0
+                for bit in range(8):
+                    row = band * 8 + bit
+                    if row < height and (rows[base + row] << column) & 0x8000:
+                        byte |= 1 << bit
+                out.append(byte)
+    return out
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="Generates the column tables of the SSD1306 fonts (ssd1306_fonts_columns.h).")
+    parser.add_argument("--source", default=SOURCE,
+                        help="font source to read (default: lib_ssd1306/ssd1306_fonts.c)")
+    parser.add_argument("--output", default="-",
+                        help="header to write, - for stdout (default: -)")
+    args = parser.parse_args()
+
+    with open(args.source) as f:
+        fonts = parse_fonts(strip_comments(f.read()))
+
+    lines = [
+        "// Generated by tools/gen_font_columns.py from ssd1306_fonts.c - do not edit.",
+        f"// Regenerate with: {REGENERATE}",
+        "// Glyphs in SSD1306 page layout: per glyph, per column, (height + 7) / 8 bytes",
+        "// with bit 0 on top. Included by ssd1306_fonts.c only.",
+        "#ifndef __SSD1306_FONTS_COLUMNS_H__",
+        "#define __SSD1306_FONTS_COLUMNS_H__",
+        "",
+    ]
+    for name, width, height, guard, rows in fonts:
+        data = transpose(width, height, rows)
+        lines.append(f"#ifdef {guard}")
+        lines.append(f"static const uint8_t {name}_columns [] = {{")
+        per_glyph = width * ((height + 7) // 8)
+        for glyph in range(GLYPHS):
+            chunk = data[glyph * per_glyph:(glyph + 1) * per_glyph]
+            char = {" ": "sp", "\\": "backslash"}.get(chr(32 + glyph), chr(32 + glyph))
+            lines.append(", ".join(f"0x{b:02X}" for b in chunk) + f",  // {char}")
+        lines.append("};")
+        lines.append("#endif")
+        lines.append("")
+    lines.append("#endif // __SSD1306_FONTS_COLUMNS_H__")
+
+    text = "\n".join(lines) + "\n"
+    if args.output == "-":
+        sys.stdout.write(text)
+        return
+    with open(args.output, "w") as f:
+        f.write(text)
+    print(f"wrote {args.output} ({len(fonts)} fonts)", file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
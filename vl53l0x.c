@@ -1,5 +1,6 @@
 #include "vl53l0x.h"
 #include "pico/stdlib.h"
+#include "hardware/gpio.h"
 #include <string.h>
 
 // Standard measurement time in microseconds
@@ -9,33 +10,67 @@
 // Calibration offset in millimeters
 #define DISTANCE_OFFSET_MM 50
 
+// Devices in interrupt mode, indexed by their GPIO1 pin
+static vl53l0x_device* interrupt_devices[NUM_BANK0_GPIOS];
+
+// Stages of the queued reads behind vl53l0x_poll_sample
+enum {
+    ASYNC_IDLE,                 // Nothing in flight
+    ASYNC_STATUS,               // RESULT_INTERRUPT_STATUS (0x13) being read
+    ASYNC_RESULT,               // Result block (0x14, 12 bytes) being read
+    ASYNC_CLEAR                 // Result block read, its interrupt clear not queued yet
+};
+
 // ========================== Auxiliary functions ==========================
 
+// Sends bytes to the sensor, through the transaction queue when one is attached
+static void write_bytes(vl53l0x_device* dev, const uint8_t* buf, size_t len) {
+    if (dev->queue) {
+        i2c_queue_transfer_blocking(dev->queue, dev->address, buf, len, NULL, 0);
+    } else {
+        i2c_write_blocking(dev->i2c, dev->address, buf, len, false);
+    }
+}
+
+// Reads consecutive registers in one I2C transaction (the sensor auto-increments the index)
+static void read_multi(vl53l0x_device* dev, uint8_t reg, uint8_t* buf, size_t len) {
+    if (dev->queue) {
+        i2c_queue_transfer_blocking(dev->queue, dev->address, &reg, 1, buf, len);
+    } else {
+        i2c_write_blocking(dev->i2c, dev->address, &reg, 1, true);
+        i2c_read_blocking(dev->i2c, dev->address, buf, len, false);
+    }
+}
+
 // Writes an 8-bit value to a sensor register
 static void write_reg(vl53l0x_device* dev, uint8_t reg, uint8_t val) {
     uint8_t buf[2] = {reg, val};
-    i2c_write_blocking(dev->i2c, dev->address, buf, 2, false);
+    write_bytes(dev, buf, 2);
 }
 
 // Writes a 16-bit value to a sensor register
 static void write_reg16(vl53l0x_device* dev, uint8_t reg, uint16_t val) {
     uint8_t buf[3] = {reg, (val >> 8), (val & 0xFF)};
-    i2c_write_blocking(dev->i2c, dev->address, buf, 3, false);
+    write_bytes(dev, buf, 3);
+}
+
+// Writes a 32-bit value to a sensor register
+static void write_reg32(vl53l0x_device* dev, uint8_t reg, uint32_t val) {
+    uint8_t buf[5] = {reg, (val >> 24), (val >> 16) & 0xFF, (val >> 8) & 0xFF, (val & 0xFF)};
+    write_bytes(dev, buf, 5);
 }
 
 // Reads an 8-bit value from a sensor register
 static uint8_t read_reg(vl53l0x_device* dev, uint8_t reg) {
     uint8_t val;
-    i2c_write_blocking(dev->i2c, dev->address, &reg, 1, true);
-    i2c_read_blocking(dev->i2c, dev->address, &val, 1, false);
+    read_multi(dev, reg, &val, 1);
     return val;
 }
 
 // Reads a 16-bit value from a sensor register
 static uint16_t read_reg16(vl53l0x_device* dev, uint8_t reg) {
     uint8_t buf[2];
-    i2c_write_blocking(dev->i2c, dev->address, &reg, 1, true);
-    i2c_read_blocking(dev->i2c, dev->address, buf, 2, false);
+    read_multi(dev, reg, buf, 2);
     return ((uint16_t)buf[0] << 8) | buf[1];
 }
 
@@ -44,13 +79,122 @@ static inline uint32_t current_time_ms() {
     return to_ms_since_boot(get_absolute_time());
 }
 
+// ========================== Timing budget math ==========================
+
+// Fixed costs of each sequence step, in microseconds (from the ST API)
+#define BUDGET_START_OVERHEAD      1910
+#define BUDGET_END_OVERHEAD        960
+#define BUDGET_MSRC_OVERHEAD       660
+#define BUDGET_TCC_OVERHEAD        590
+#define BUDGET_DSS_OVERHEAD        690
+#define BUDGET_PRE_RANGE_OVERHEAD  660
+#define BUDGET_FINAL_RANGE_OVERHEAD 550
+
+// Sequence steps enabled in SYSTEM_SEQUENCE_CONFIG (0x01)
+typedef struct {
+    bool tcc, msrc, dss, pre_range, final_range;
+} sequence_steps;
+
+// Step timeouts in VCSEL macro periods and in microseconds
+typedef struct {
+    uint16_t pre_range_vcsel_pclks, final_range_vcsel_pclks;
+    uint16_t msrc_dss_tcc_mclks, pre_range_mclks, final_range_mclks;
+    uint32_t msrc_dss_tcc_us, pre_range_us, final_range_us;
+} sequence_timeouts;
+
+// VCSEL period register value -> period in PCLKs
+static uint16_t decode_vcsel_period(uint8_t reg_val) {
+    return ((uint16_t)reg_val + 1) << 1;
+}
+
+// Macro period in nanoseconds for a VCSEL period in PCLKs
+static uint32_t macro_period_ns(uint16_t vcsel_pclks) {
+    return ((uint32_t)2304 * vcsel_pclks * 1655 + 500) / 1000;
+}
+
+// Timeout register format: (LSB * 2^MSB) + 1 macro periods
+static uint16_t decode_timeout(uint16_t reg_val) {
+    return (uint16_t)((reg_val & 0x00FF) << ((reg_val & 0xFF00) >> 8)) + 1;
+}
+
+static uint16_t encode_timeout(uint32_t timeout_mclks) {
+    if (timeout_mclks == 0) return 0;
+    uint32_t ls_byte = timeout_mclks - 1;
+    uint16_t ms_byte = 0;
+    while ((ls_byte & 0xFFFFFF00) > 0) {
+        ls_byte >>= 1;
+        ms_byte++;
+    }
+    return (ms_byte << 8) | (ls_byte & 0xFF);
+}
+
+static uint32_t timeout_mclks_to_us(uint16_t timeout_mclks, uint16_t vcsel_pclks) {
+    uint32_t period_ns = macro_period_ns(vcsel_pclks);
+    return ((uint32_t)timeout_mclks * period_ns + 500) / 1000;
+}
+
+static uint32_t timeout_us_to_mclks(uint32_t timeout_us, uint16_t vcsel_pclks) {
+    uint32_t period_ns = macro_period_ns(vcsel_pclks);
+    return (timeout_us * 1000 + period_ns / 2) / period_ns;
+}
+
+static void get_sequence_steps(vl53l0x_device* dev, sequence_steps* steps) {
+    uint8_t config = read_reg(dev, 0x01);
+    steps->tcc = (config >> 4) & 1;
+    steps->dss = (config >> 3) & 1;
+    steps->msrc = (config >> 2) & 1;
+    steps->pre_range = (config >> 6) & 1;
+    steps->final_range = (config >> 7) & 1;
+}
+
+static void get_sequence_timeouts(vl53l0x_device* dev, const sequence_steps* steps, sequence_timeouts* t) {
+    t->pre_range_vcsel_pclks = decode_vcsel_period(read_reg(dev, 0x50));
+    t->msrc_dss_tcc_mclks = read_reg(dev, 0x46) + 1;
+    t->msrc_dss_tcc_us = timeout_mclks_to_us(t->msrc_dss_tcc_mclks, t->pre_range_vcsel_pclks);
+    t->pre_range_mclks = decode_timeout(read_reg16(dev, 0x51));
+    t->pre_range_us = timeout_mclks_to_us(t->pre_range_mclks, t->pre_range_vcsel_pclks);
+
+    // The final range timeout register includes the pre-range time
+    t->final_range_vcsel_pclks = decode_vcsel_period(read_reg(dev, 0x70));
+    t->final_range_mclks = decode_timeout(read_reg16(dev, 0x71));
+    if (steps->pre_range) t->final_range_mclks -= t->pre_range_mclks;
+    t->final_range_us = timeout_mclks_to_us(t->final_range_mclks, t->final_range_vcsel_pclks);
+}
+
+// Budget used by every enabled step except the final range
+static uint32_t fixed_budget_us(const sequence_steps* steps, const sequence_timeouts* t) {
+    uint32_t budget_us = BUDGET_START_OVERHEAD + BUDGET_END_OVERHEAD;
+    if (steps->tcc) budget_us += t->msrc_dss_tcc_us + BUDGET_TCC_OVERHEAD;
+    if (steps->dss) {
+        budget_us += 2 * (t->msrc_dss_tcc_us + BUDGET_DSS_OVERHEAD);
+    } else if (steps->msrc) {
+        budget_us += t->msrc_dss_tcc_us + BUDGET_MSRC_OVERHEAD;
+    }
+    if (steps->pre_range) budget_us += t->pre_range_us + BUDGET_PRE_RANGE_OVERHEAD;
+    return budget_us;
+}
+
+// ========================== Interrupt handling ==========================
+
+// GPIO1 falling edge: marks the device as having a sample; the WFE in the reader wakes up
+static void gpio1_callback(uint gpio, uint32_t events) {
+    if (gpio < NUM_BANK0_GPIOS && interrupt_devices[gpio] && (events & GPIO_IRQ_EDGE_FALL)) {
+        interrupt_devices[gpio]->data_ready = true;
+    }
+}
+
 // ========================== Sensor initialization ==========================
 
 bool vl53l0x_boot(vl53l0x_device* dev, i2c_inst_t* port_i2c) {
     // Configures the I2C instance and sensor address
     dev->i2c = port_i2c;
+    dev->queue = NULL;
     dev->address = ADDRESS_VL53L0X;
     dev->time_timeout = 1000; // 1 second timeout
+    dev->use_interrupt = false;
+    dev->data_ready = false;
+    dev->waiting = false;
+    dev->async_stage = ASYNC_IDLE;
 
     // VL53L0X Boot Sequence (Internal Configuration)
     write_reg(dev, 0x80, 0x01);
@@ -100,15 +244,89 @@ bool vl53l0x_boot(vl53l0x_device* dev, i2c_inst_t* port_i2c) {
     write_reg(dev, 0x84, read_reg(dev, 0x84) & ~0x10);
     write_reg(dev, 0x0B, 0x01);
 
-    // Sets measurement time and starts the sensor
-    dev->measurement_time = STANDARD_TIME_MEASUREMENT;
+    // Enables DSS, pre-range and final range, then recomputes the final range
+    // timeout so the default budget holds with this step set
     write_reg(dev, 0x01, 0xE8);
-    write_reg16(dev, 0x04, STANDARD_TIME_MEASUREMENT / 1085);
+    if (!vl53l0x_set_timing_budget_us(dev, STANDARD_TIME_MEASUREMENT)) return false;
 
     write_reg(dev, 0x0B, 0x01);
     return true;
 }
 
+// ========================== I2C access ==========================
+
+void vl53l0x_use_queue(vl53l0x_device* dev, i2c_queue* queue) {
+    dev->queue = queue;
+    dev->async_stage = ASYNC_IDLE;
+}
+
+void vl53l0x_set_address(vl53l0x_device* dev, uint8_t new_address) {
+    // I2C_SLAVE_DEVICE_ADDRESS; the sensor answers on the new address right away
+    write_reg(dev, 0x8A, new_address & 0x7F);
+    dev->address = new_address & 0x7F;
+}
+
+// ========================== Timing budget ==========================
+
+bool vl53l0x_set_timing_budget_us(vl53l0x_device* dev, uint32_t budget_us) {
+    if (budget_us < VL53L0X_MIN_TIMING_BUDGET_US) return false;
+
+    sequence_steps steps;
+    sequence_timeouts timeouts;
+    get_sequence_steps(dev, &steps);
+    get_sequence_timeouts(dev, &steps, &timeouts);
+
+    // Only the final range timeout is adjustable; the other steps keep their timeouts
+    uint32_t used_us = fixed_budget_us(&steps, &timeouts);
+    if (steps.final_range) {
+        used_us += BUDGET_FINAL_RANGE_OVERHEAD;
+        if (used_us > budget_us) return false;
+
+        uint32_t final_range_mclks = timeout_us_to_mclks(budget_us - used_us, timeouts.final_range_vcsel_pclks);
+        if (steps.pre_range) final_range_mclks += timeouts.pre_range_mclks;
+        write_reg16(dev, 0x71, encode_timeout(final_range_mclks));
+    }
+
+    dev->measurement_time = budget_us;
+    return true;
+}
+
+uint32_t vl53l0x_get_timing_budget_us(vl53l0x_device* dev) {
+    sequence_steps steps;
+    sequence_timeouts timeouts;
+    get_sequence_steps(dev, &steps);
+    get_sequence_timeouts(dev, &steps, &timeouts);
+
+    uint32_t budget_us = fixed_budget_us(&steps, &timeouts);
+    if (steps.final_range) budget_us += timeouts.final_range_us + BUDGET_FINAL_RANGE_OVERHEAD;
+
+    dev->measurement_time = budget_us;
+    return budget_us;
+}
+
+// ========================== Interrupt mode ==========================
+
+bool vl53l0x_enable_gpio1_interrupt(vl53l0x_device* dev, uint8_t gpio1_pin) {
+    if (gpio1_pin >= NUM_BANK0_GPIOS) return false;
+
+    // SYSTEM_INTERRUPT_CONFIG_GPIO: new sample ready; GPIO_HV_MUX_ACTIVE_HIGH bit 4 clear = active low
+    write_reg(dev, 0x0A, 0x04);
+    write_reg(dev, 0x84, read_reg(dev, 0x84) & ~0x10);
+    write_reg(dev, 0x0B, 0x01);
+
+    // GPIO1 is open drain on the sensor side
+    gpio_init(gpio1_pin);
+    gpio_set_dir(gpio1_pin, GPIO_IN);
+    gpio_pull_up(gpio1_pin);
+
+    dev->gpio1_pin = gpio1_pin;
+    dev->data_ready = false;
+    dev->use_interrupt = true;
+    interrupt_devices[gpio1_pin] = dev;
+    gpio_set_irq_enabled_with_callback(gpio1_pin, GPIO_IRQ_EDGE_FALL, true, gpio1_callback);
+    return true;
+}
+
 // ========================== Continuous mode ==========================
 
 void vl53l0x_start_continuous(vl53l0x_device* dev, uint32_t period_ms) {
@@ -121,9 +339,12 @@ void vl53l0x_start_continuous(vl53l0x_device* dev, uint32_t period_ms) {
     write_reg(dev, 0xFF, 0x00);
     write_reg(dev, 0x80, 0x00);
 
-    // Sets the continuous measurement period
+    // Sets the continuous measurement period (SYSTEM_INTERMEASUREMENT_PERIOD is
+    // 32 bits, in internal oscillator ticks given by OSC_CALIBRATE_VAL)
     if (period_ms != 0) {
-        write_reg16(dev, 0x04, period_ms * 12 / 13);
+        uint16_t osc_calibrate = read_reg16(dev, 0xF8);
+        if (osc_calibrate != 0) period_ms *= osc_calibrate;
+        write_reg32(dev, 0x04, period_ms);
         write_reg(dev, 0x00, 0x04); // Continuous mode with interval
     } else {
         write_reg(dev, 0x00, 0x02); // Continuous mode without gap
@@ -132,16 +353,44 @@ void vl53l0x_start_continuous(vl53l0x_device* dev, uint32_t period_ms) {
 
 // ========================== Continuous reading ==========================
 
-uint16_t vl53l0x_reads_distance_from_sensor_cm(vl53l0x_device* dev) {
-    // Waiting for new measurement with timeout
-    uint32_t start = current_time_ms();
-    while ((read_reg(dev, 0x13) & 0x07) == 0) {
-        if (current_time_ms() - start > dev->time_timeout) return INVALID_DISTANCE;
-    }
+// Checks whether a sample is ready: the interrupt flag costs nothing, polling costs one I2C read.
+// GPIO1 held low counts too: after a missed edge or a lost clear no new edge would come.
+static bool sample_ready(vl53l0x_device* dev) {
+    if (dev->use_interrupt) return dev->data_ready || !gpio_get(dev->gpio1_pin);
+    return (read_reg(dev, 0x13) & 0x07) != 0;
+}
+
+// Clears the interrupt again after a timeout, in case the clear of the last
+// sample was NACKed and the sensor is still holding it
+static void rearm_interrupt(vl53l0x_device* dev) {
+    dev->data_ready = false;
+    write_reg(dev, 0x0B, 0x01);
+}
+
+// Decodes RESULT_RANGE_STATUS (0x14) through the final range result (0x1E)
+static void decode_result(const uint8_t* buf, vl53l0x_sample* sample) {
+    sample->range_status = (buf[0] & 0x78) >> 3;
+    sample->effective_spads = ((uint16_t)buf[2] << 8) | buf[3];
+    sample->signal_rate = ((uint16_t)buf[6] << 8) | buf[7];
+    sample->ambient_rate = ((uint16_t)buf[8] << 8) | buf[9];
+    sample->distance_mm = ((uint16_t)buf[10] << 8) | buf[11];
+}
+
+// Reads the whole result block in one burst and re-arms the interrupt
+static void read_result(vl53l0x_device* dev, vl53l0x_sample* sample) {
+    uint8_t buf[12];
+    dev->data_ready = false;
+
+    read_multi(dev, 0x14, buf, sizeof(buf));
+    decode_result(buf, sample);
+
+    // Clears the interrupt so the sensor can flag the next sample
+    write_reg(dev, 0x0B, 0x01);
+}
+
+uint16_t vl53l0x_sample_to_cm(const vl53l0x_sample* sample) {
+    uint16_t distance_mm = sample->distance_mm;
 
-    // Reads distance in millimeters
-    uint16_t distance_mm = read_reg16(dev, 0x1E);
-    
     // Aplica offset de calibração
     if (distance_mm > DISTANCE_OFFSET_MM) {
         distance_mm -= DISTANCE_OFFSET_MM;
@@ -151,4 +400,152 @@ uint16_t vl53l0x_reads_distance_from_sensor_cm(vl53l0x_device* dev) {
 
     // Convert to centimeters and return
     return distance_mm / 10;
-}
\ No newline at end of file
+}
+
+bool vl53l0x_read_sample(vl53l0x_device* dev, vl53l0x_sample* sample) {
+    dev->waiting = false;
+
+    if (dev->use_interrupt) {
+        // Sleeps until the GPIO1 interrupt flags a sample; the bus stays free meanwhile
+        absolute_time_t deadline = make_timeout_time_ms(dev->time_timeout);
+        while (!sample_ready(dev)) {
+            if (best_effort_wfe_or_timeout(deadline)) {
+                rearm_interrupt(dev);
+                return false;
+            }
+        }
+    } else {
+        // Waiting for new measurement with timeout
+        uint32_t start = current_time_ms();
+        while (!sample_ready(dev)) {
+            if (current_time_ms() - start > dev->time_timeout) return false;
+        }
+    }
+
+    read_result(dev, sample);
+    return true;
+}
+
+uint16_t vl53l0x_reads_distance_from_sensor_cm(vl53l0x_device* dev) {
+    vl53l0x_sample sample;
+    if (!vl53l0x_read_sample(dev, &sample)) return INVALID_DISTANCE;
+    return vl53l0x_sample_to_cm(&sample);
+}
+
+// ========================== Non-blocking reading ==========================
+
+// Register indexes sent by the queued reads; they must outlive the transaction
+static const uint8_t status_register = 0x13;
+static const uint8_t result_register = 0x14;
+static const uint8_t clear_interrupt[2] = {0x0B, 0x01};
+
+// Runs from the I2C interrupt when a queued read completes
+static void async_callback(bool ok, void* context) {
+    vl53l0x_device* dev = context;
+    dev->async_ok = ok;
+    dev->async_done = true;
+}
+
+// Queues a register read into async_data; false when the queue is full (retried on the next poll)
+static bool async_read(vl53l0x_device* dev, uint8_t stage, const uint8_t* reg, size_t len) {
+    i2c_transfer transfer = {
+        .address = dev->address,
+        .write_data = reg,
+        .write_length = 1,
+        .read_data = dev->async_data,
+        .read_length = len,
+        .callback = async_callback,
+        .context = dev,
+    };
+    dev->async_done = false;
+    dev->async_stage = stage;
+    if (i2c_queue_submit(dev->queue, &transfer)) return true;
+    dev->async_stage = ASYNC_IDLE;
+    return false;
+}
+
+// Queues the interrupt clear of the result block in async_data and decodes it
+// into sample. With the queue full the sample is held back and the clear is
+// retried on the next poll: without it the sensor would not flag another sample.
+static bool async_clear(vl53l0x_device* dev, vl53l0x_sample* sample) {
+    // The queue runs the clear before any later read, so nobody waits for it
+    i2c_transfer clear = {.address = dev->address, .write_data = clear_interrupt, .write_length = 2};
+    if (!i2c_queue_submit(dev->queue, &clear)) {
+        dev->async_stage = ASYNC_CLEAR;
+        return false;
+    }
+    dev->async_stage = ASYNC_IDLE;
+    dev->data_ready = false;
+    decode_result(dev->async_data, sample);
+    return true;
+}
+
+// Queue mode: advances the status poll / result burst without waiting on the bus.
+// Returns true once a result block has been decoded into sample.
+static bool async_step(vl53l0x_device* dev, vl53l0x_sample* sample) {
+    if (dev->async_stage == ASYNC_CLEAR) return async_clear(dev, sample);
+    if (dev->async_stage != ASYNC_IDLE) {
+        if (!dev->async_done) return false;
+        uint8_t stage = dev->async_stage;
+        dev->async_stage = ASYNC_IDLE;
+
+        if (stage == ASYNC_RESULT) {
+            if (!dev->async_ok) return false; // The next poll starts over
+            return async_clear(dev, sample);
+        }
+
+        // Status read done: a ready sample goes straight on to the burst
+        if (dev->async_ok && (dev->async_data[0] & 0x07) != 0) {
+            async_read(dev, ASYNC_RESULT, &result_register, 12);
+        }
+        return false;
+    }
+
+    if (dev->use_interrupt) {
+        if (sample_ready(dev)) async_read(dev, ASYNC_RESULT, &result_register, 12);
+    } else {
+        async_read(dev, ASYNC_STATUS, &status_register, 1);
+    }
+    return false;
+}
+
+vl53l0x_poll_result vl53l0x_poll_sample(vl53l0x_device* dev, vl53l0x_sample* sample) {
+    uint32_t now = current_time_ms();
+
+    // Idle -> waiting: the timeout counts from the first poll after the last sample
+    if (!dev->waiting) {
+        dev->waiting = true;
+        dev->wait_start = now;
+    }
+
+    bool ready;
+    if (dev->queue) {
+        ready = async_step(dev, sample);
+    } else {
+        ready = sample_ready(dev);
+        if (ready) read_result(dev, sample);
+    }
+    if (ready) {
+        dev->waiting = false;
+        return VL53L0X_SAMPLE;
+    }
+
+    if (now - dev->wait_start > dev->time_timeout) {
+        dev->waiting = false;
+        if (dev->use_interrupt) rearm_interrupt(dev);
+        return VL53L0X_TIMEOUT;
+    }
+    return VL53L0X_NOT_READY;
+}
+
+vl53l0x_poll_result vl53l0x_poll(vl53l0x_device* dev, uint16_t* distance_cm) {
+    vl53l0x_sample sample;
+    vl53l0x_poll_result result = vl53l0x_poll_sample(dev, &sample);
+
+    if (result == VL53L0X_SAMPLE) {
+        *distance_cm = vl53l0x_sample_to_cm(&sample);
+    } else if (result == VL53L0X_TIMEOUT) {
+        *distance_cm = INVALID_DISTANCE;
+    }
+    return result;
+}
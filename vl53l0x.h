@@ -8,6 +8,7 @@
 
 // Inclusion of the Raspberry Pi Pico-specific I2C communication library
 #include "hardware/i2c.h"
+#include "i2c_queue.h"
 
 // Sets the default I2C address of the VL53L0X sensor
 #define ADDRESS_VL53L0X 0x29 // VL53L0X default hexadecimal address
@@ -15,19 +16,81 @@
 // Structure representing a VL53L0X device
 typedef struct {
     i2c_inst_t* i2c;             // Pointer to the instance of the I2C interface used
+    i2c_queue* queue;            // DMA transaction queue of that interface, or NULL for direct access
     uint8_t address;            // Sensor I2C address
     uint16_t time_timeout;      // Timeout for operations (in milliseconds)
     uint8_t stop_variable;     // Flag used to control the stopping of continuous measurements
-    uint32_t measurement_time;   // Measurement time in microseconds
+    uint32_t measurement_time;   // Measurement timing budget in microseconds
+    bool use_interrupt;          // True when GPIO1 signals new samples instead of register polling
+    uint8_t gpio1_pin;           // Pico pin wired to the sensor GPIO1 output (interrupt mode)
+    volatile bool data_ready;    // Set by the GPIO1 interrupt, cleared when the sample is read
+    bool waiting;                // True while vl53l0x_poll is waiting for a sample
+    uint32_t wait_start;         // Time in milliseconds when the current wait started
+    uint8_t async_stage;         // Queued read in flight for vl53l0x_poll_sample (queue mode)
+    volatile bool async_done;    // Set by the queue callback when that read completes
+    volatile bool async_ok;      // False when the read was NACKed
+    uint8_t async_data[12];      // Destination of the queued read (status byte or result block)
 } vl53l0x_device;
 
+// Shortest timing budget the sensor accepts, in microseconds
+#define VL53L0X_MIN_TIMING_BUDGET_US 20000
+
+// Device range status reported for a valid measurement
+#define VL53L0X_RANGE_STATUS_VALID 11
+
+// Device range status "none": no measurement (used for a poll timeout too)
+#define VL53L0X_RANGE_STATUS_NONE 0
+
+// Decoded RESULT_RANGE_STATUS block (12 bytes from register 0x14)
+typedef struct {
+    uint8_t range_status;       // Device range status, VL53L0X_RANGE_STATUS_VALID when usable
+    uint16_t effective_spads;   // Effective SPAD return count, 8.8 fixed point
+    uint16_t signal_rate;       // Return signal rate in MCPS, 9.7 fixed point
+    uint16_t ambient_rate;      // Ambient rate in MCPS, 9.7 fixed point
+    uint16_t distance_mm;       // Measured distance without the calibration offset
+} vl53l0x_sample;
+
+// Result of a non-blocking poll
+typedef enum {
+    VL53L0X_NOT_READY,          // No new sample yet, call again later
+    VL53L0X_SAMPLE,             // A new distance was read
+    VL53L0X_TIMEOUT             // No sample within time_timeout; the wait restarts
+} vl53l0x_poll_result;
+
 // Function to initialize the VL53L0X sensor with the specified I2C interface
 bool vl53l0x_boot(vl53l0x_device* device, i2c_inst_t* port_i2c);
 
+// Function to route register accesses through a DMA transaction queue shared with other devices
+void vl53l0x_use_queue(vl53l0x_device* device, i2c_queue* queue);
+
+// Function to move the sensor to a new 7-bit I2C address (lost on power-down or XSHUT)
+void vl53l0x_set_address(vl53l0x_device* device, uint8_t new_address);
+
+// Function to set the time allowed for one measurement (e.g. 20000 fast, 200000 accurate)
+bool vl53l0x_set_timing_budget_us(vl53l0x_device* device, uint32_t budget_us);
+
+// Function to read back the timing budget from the sensor sequence configuration
+uint32_t vl53l0x_get_timing_budget_us(vl53l0x_device* device);
+
+// Function to switch the device to interrupt mode: GPIO1 goes low when a new sample is ready
+bool vl53l0x_enable_gpio1_interrupt(vl53l0x_device* device, uint8_t gpio1_pin);
+
 // Function to start continuous measurements with interval defined in milliseconds
 void vl53l0x_start_continuous(vl53l0x_device* device, uint32_t period_ms);
 
 // Function to read the distance measured in continuous mode, returning the value in centimeters
 uint16_t vl53l0x_reads_distance_from_sensor_cm(vl53l0x_device* device);
 
+// Function to read the next full sample in continuous mode; false on timeout
+bool vl53l0x_read_sample(vl53l0x_device* device, vl53l0x_sample* sample);
+
+// Function to check for a new full sample in continuous mode without blocking
+vl53l0x_poll_result vl53l0x_poll_sample(vl53l0x_device* device, vl53l0x_sample* sample);
+
+// Function to check for a new sample in continuous mode without blocking; stores it in centimeters
+vl53l0x_poll_result vl53l0x_poll(vl53l0x_device* device, uint16_t* distance_cm);
+
+// Function to convert a sample to centimeters, applying the calibration offset
+uint16_t vl53l0x_sample_to_cm(const vl53l0x_sample* sample);
+
 #endif // VL53L0X_H
@@ -0,0 +1,116 @@
+#include "vl53l0x_array.h"
+#include "pico/stdlib.h"
+#include "hardware/gpio.h"
+#include <stdio.h>
+#include <string.h>
+
+// Time the sensor needs after XSHUT is released before it answers on I2C (datasheet: 1.2 ms)
+#define XSHUT_BOOT_TIME_MS 2
+// Time XSHUT is held low so every sensor is surely in reset
+#define XSHUT_RESET_TIME_MS 10
+
+// ========================== Setup ==========================
+
+void vl53l0x_array_init(vl53l0x_array* array, i2c_inst_t* port_i2c) {
+    memset(array, 0, sizeof(*array));
+    array->i2c = port_i2c;
+}
+
+bool vl53l0x_array_add(vl53l0x_array* array, uint8_t xshut_pin, uint8_t address) {
+    if (array->count == VL53L0X_ARRAY_MAX_SENSORS) return false;
+    // Every sensor boots at the default address, so that one cannot be kept
+    if (address == ADDRESS_VL53L0X) return false;
+
+    vl53l0x_array_sensor* sensor = &array->sensors[array->count++];
+    sensor->xshut_pin = xshut_pin;
+    sensor->address = address;
+    sensor->active = false;
+    return true;
+}
+
+// ========================== Bring-up ==========================
+
+size_t vl53l0x_array_boot(vl53l0x_array* array) {
+    // Holds every sensor in reset so none answers on the default address
+    for (size_t i = 0; i < array->count; i++) {
+        gpio_init(array->sensors[i].xshut_pin);
+        gpio_set_dir(array->sensors[i].xshut_pin, GPIO_OUT);
+        gpio_put(array->sensors[i].xshut_pin, 0);
+    }
+    sleep_ms(XSHUT_RESET_TIME_MS);
+
+    // Releases them one at a time; each is moved away from 0x29 before the next boots
+    size_t booted = 0;
+    for (size_t i = 0; i < array->count; i++) {
+        vl53l0x_array_sensor* sensor = &array->sensors[i];
+        gpio_put(sensor->xshut_pin, 1);
+        sleep_ms(XSHUT_BOOT_TIME_MS);
+
+        if (!vl53l0x_boot(&sensor->device, array->i2c)) {
+            // Keeps a failed sensor in reset so it cannot collide with the next one
+            printf("VL53L0X on XSHUT %d did not boot\n", sensor->xshut_pin);
+            gpio_put(sensor->xshut_pin, 0);
+            sensor->active = false;
+            continue;
+        }
+        vl53l0x_set_address(&sensor->device, sensor->address);
+        sensor->active = true;
+        booted++;
+    }
+    return booted;
+}
+
+// ========================== Scheduling ==========================
+
+void vl53l0x_array_start(vl53l0x_array* array, uint32_t period_ms) {
+    size_t active = 0;
+    for (size_t i = 0; i < array->count; i++) {
+        if (array->sensors[i].active) active++;
+    }
+    if (active == 0) return;
+
+    // Offsets the starts by period/N so the sensors finish ranging at different
+    // times and their result reads interleave on the shared bus
+    uint32_t stagger_ms = period_ms / active;
+    bool first = true;
+    for (size_t i = 0; i < array->count; i++) {
+        vl53l0x_array_sensor* sensor = &array->sensors[i];
+        if (!sensor->active) continue;
+        if (!first) sleep_ms(stagger_ms);
+        vl53l0x_start_continuous(&sensor->device, period_ms);
+        sensor->samples = 0;
+        sensor->timeouts = 0;
+        first = false;
+    }
+    array->next = 0;
+    array->start_time = to_ms_since_boot(get_absolute_time());
+}
+
+bool vl53l0x_array_poll(vl53l0x_array* array, size_t* index, vl53l0x_sample* sample) {
+    // Starts after the sensor served last, so a fast sensor cannot starve the others
+    for (size_t n = 0; n < array->count; n++) {
+        size_t i = (array->next + n) % array->count;
+        vl53l0x_array_sensor* sensor = &array->sensors[i];
+        if (!sensor->active) continue;
+
+        vl53l0x_poll_result result = vl53l0x_poll_sample(&sensor->device, sample);
+        if (result == VL53L0X_TIMEOUT) {
+            sensor->timeouts++;
+        } else if (result == VL53L0X_SAMPLE) {
+            sensor->samples++;
+            array->next = (i + 1) % array->count;
+            *index = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+// ========================== Statistics ==========================
+
+float vl53l0x_array_rate_hz(const vl53l0x_array* array, size_t index) {
+    if (index >= array->count) return 0.0f;
+    uint32_t elapsed_ms = to_ms_since_boot(get_absolute_time()) - array->start_time;
+    if (elapsed_ms == 0) return 0.0f;
+    return array->sensors[index].samples * 1000.0f / elapsed_ms;
+}
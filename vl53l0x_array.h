@@ -0,0 +1,52 @@
+#ifndef VL53L0X_ARRAY_H
+#define VL53L0X_ARRAY_H
+
+// Several VL53L0X sensors sharing one I2C bus. Each sensor has its XSHUT pin on
+// a GPIO; they are brought up one at a time and moved off the default address.
+#include <stdbool.h>     // Allows the use of the bool type (true/false)
+#include <stddef.h>      // Allows the use of size_t
+#include <stdint.h>      // Allows the use of types like uint8_t, uint32_t, etc.
+
+#include "vl53l0x.h"
+
+// Maximum number of sensors in one array
+#define VL53L0X_ARRAY_MAX_SENSORS 4
+
+// One sensor of the array and its counters
+typedef struct {
+    vl53l0x_device device;
+    uint8_t xshut_pin;          // GPIO wired to the sensor XSHUT input
+    uint8_t address;            // I2C address assigned during bring-up
+    bool active;                // True once the sensor booted at its new address
+    uint32_t samples;           // Samples read since vl53l0x_array_start
+    uint32_t timeouts;          // Polls that ran into the sensor timeout
+} vl53l0x_array_sensor;
+
+// Structure representing the sensor array
+typedef struct {
+    i2c_inst_t* i2c;
+    vl53l0x_array_sensor sensors[VL53L0X_ARRAY_MAX_SENSORS];
+    size_t count;
+    size_t next;                // Round-robin cursor for vl53l0x_array_poll
+    uint32_t start_time;        // Time in milliseconds when continuous mode started
+} vl53l0x_array;
+
+// Function to prepare an empty array on the given I2C bus
+void vl53l0x_array_init(vl53l0x_array* array, i2c_inst_t* port_i2c);
+
+// Function to declare a sensor by its XSHUT pin and the address it should get
+bool vl53l0x_array_add(vl53l0x_array* array, uint8_t xshut_pin, uint8_t address);
+
+// Function to hold all sensors in reset, then boot and readdress them one by one; returns how many came up
+size_t vl53l0x_array_boot(vl53l0x_array* array);
+
+// Function to start continuous mode on all sensors, staggered evenly over one period
+void vl53l0x_array_start(vl53l0x_array* array, uint32_t period_ms);
+
+// Function to poll the sensors round-robin without blocking; true when a sample was read
+bool vl53l0x_array_poll(vl53l0x_array* array, size_t* index, vl53l0x_sample* sample);
+
+// Function to get the average sample rate of one sensor since start, in samples per second
+float vl53l0x_array_rate_hz(const vl53l0x_array* array, size_t index);
+
+#endif // VL53L0X_ARRAY_H